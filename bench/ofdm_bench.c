@@ -0,0 +1,687 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <fftw3.h>
+
+#include "ofdm_utils.h"
+#include "bit_utils.h"
+#include "mac_utils.h"
+#include "utils.h"
+#include "detector_utils.h"
+#include "viterbi_utils.h"
+#include "soft_utils.h"
+#include "channel_utils.h"
+#include "cfo_utils.h"
+#include "receiver_utils.h"
+#include "conditioning_utils.h"
+
+//default psdu sizes (bytes)
+static const int default_sizes[] = {64, 256, 1500, 4095};
+//number of repetitions of each measurement. the median is reported
+#define REPETITIONS 5
+
+/**
+ * Buffers for a given data rate and psdu size, prepared once and shared by
+ * all the kernels, so that each kernel only measures its own work
+ */
+struct BENCH_CONTEXT {
+	struct OFDM_PARAMETERS params;
+	struct TX_PARAMETERS tx_params;
+	char *psdu;
+	int psdu_size;
+	char *data;
+	int len;
+	char *scrambled_data;
+	char *encoded_data;
+	char *punctured_data;
+	char *interleaved_data;
+	fftw_complex *mod;
+	fftw_complex *pil;
+	fftw_complex *ifft;
+	fftw_complex *time;
+	fftw_complex *ext;
+	fftw_complex *mod_samples;
+	//noise-only samples, where the detectors scan the whole buffer
+	fftw_complex *noise;
+	//single precision copy of the noise samples
+	sample_cf32_t *noise_f;
+	sample_sc16_t *noise_s16;
+	//output of the conditioner
+	sample_cf32_t *conditioned_f;
+	//long training correlator, with plans created once
+	struct LONG_TRAINING_CORRELATOR correlator;
+	//channel gain of the data subcarriers, and soft bits of a symbol
+	double gain[N_DATA_SUBCARRIERS];
+	signed char demapped[N_DATA_SUBCARRIERS * 6];
+	//soft version of the punctured data, and output of the decoder
+	signed char *soft;
+	char *decoded;
+	//long training sequence, demodulator with its plan, channel estimate and
+	//subcarriers of a received symbol
+	fftw_complex *lts;
+	struct OFDM_DEMODULATOR demodulator;
+	struct CHANNEL_ESTIMATE channel;
+	fftw_complex received[N_TOTAL_SUBCARRIERS];
+	//time samples of the SIGNAL field, and parameters decoded from it
+	fftw_complex signal[EXT_SIGNAL_SIZE];
+	struct TX_PARAMETERS decoded_params;
+	//NCO removing a frequency offset, and its output
+	struct NCO nco;
+	fftw_complex *derotated;
+	//output of the soft deinterleaver and of the soft depuncturer
+	signed char *deinterleaved;
+	signed char *depunctured;
+	//the same soft bits for each frame of a batch, and outputs of the batch
+	const signed char *batch_soft[VITERBI_LANES];
+	char *batch_decoded[VITERBI_LANES];
+	//whole frame generated by the framer, and receiver decoding it
+	fftw_complex *frame;
+	int frame_size;
+	struct OFDM_FRAME_DECODER receiver;
+	char rx_psdu[RX_MAX_PSDU_SIZE];
+	//address filter that the random psdu does not match
+	struct RX_ADDRESS_FILTER filter;
+	int n_samples;
+};
+
+/**
+ * A kernel to be benchmarked
+ */
+struct BENCH_KERNEL {
+	const char *name;
+	void (*run)(struct BENCH_CONTEXT *ctx);
+	//number of frames processed by a call, if more than one
+	int frames;
+};
+
+//volatile sink, so that the compiler does not drop unused results
+static volatile double sink;
+
+static void run_scramble(struct BENCH_CONTEXT *c) {
+	scramble_with_initial_state(c->data, c->scrambled_data, c->len, 0x5D);
+	reset_tail_bits(c->scrambled_data, c->len, c->tx_params.n_pad + c->len * 8 - c->tx_params.n_data);
+}
+
+static void run_encode(struct BENCH_CONTEXT *c) {
+	convolutional_encoding(c->scrambled_data, c->encoded_data, c->len);
+}
+
+static void run_puncture(struct BENCH_CONTEXT *c) {
+	puncturing(c->encoded_data, c->punctured_data, c->tx_params.n_data / 4, c->params.coding_rate);
+}
+
+static void run_interleave(struct BENCH_CONTEXT *c) {
+	interleave(c->punctured_data, c->interleaved_data, c->tx_params.n_encoded_data_bytes, c->params.n_cbps, c->params.n_bpsc);
+}
+
+static void run_modulate(struct BENCH_CONTEXT *c) {
+	int symbol;
+	for (symbol = 0; symbol < c->tx_params.n_sym; symbol++) {
+		modulate(&c->interleaved_data[symbol * c->params.n_cbps / 8], c->params.n_cbps / 8, c->params.data_rate, c->mod);
+	}
+}
+
+static void run_pilots(struct BENCH_CONTEXT *c) {
+	int symbol;
+	for (symbol = 0; symbol < c->tx_params.n_sym; symbol++) {
+		insert_pilots(c->mod, c->pil, symbol + 1);
+	}
+}
+
+static void run_ifft(struct BENCH_CONTEXT *c) {
+	int symbol;
+	for (symbol = 0; symbol < c->tx_params.n_sym; symbol++) {
+		map_ofdm_to_ifft(c->pil, c->ifft);
+		perform_ifft(c->ifft, c->time);
+		normalize_ifft_output(c->time, FFT_SIZE, FFT_SIZE);
+	}
+}
+
+static void run_cp_window(struct BENCH_CONTEXT *c) {
+	int symbol;
+	for (symbol = 0; symbol < c->tx_params.n_sym; symbol++) {
+		add_cyclic_prefix(c->time, FFT_SIZE, c->ext, EXT_OFDM_SYMBOL_SIZE, CYCLIC_PREFIX_SIZE);
+		apply_window_function(c->ext, EXT_OFDM_SYMBOL_SIZE);
+		sum_samples(c->mod_samples, c->ext, EXT_OFDM_SYMBOL_SIZE, (5 + symbol) * OFDM_SYMBOL_SIZE);
+	}
+}
+
+static void run_crc(struct BENCH_CONTEXT *c) {
+	sink = crc32(c->psdu, c->psdu_size);
+}
+
+static void run_autocorrelation(struct BENCH_CONTEXT *c) {
+	sink = compute_autocorrelation(c->noise, c->n_samples);
+}
+
+static void run_short_detector(struct BENCH_CONTEXT *c) {
+	sink = detect_short_training_start(c->noise, c->n_samples, 1.2);
+}
+
+static void run_long_detector(struct BENCH_CONTEXT *c) {
+	sink = detect_long_training_start(c->noise, c->n_samples);
+}
+
+static void run_streaming_detector(struct BENCH_CONTEXT *c) {
+	struct SHORT_TRAINING_DETECTOR d;
+	init_short_training_detector(&d);
+	sink = update_short_training_detector(&d, c->noise, c->n_samples, 0.8, 0);
+}
+
+static void run_streaming_detector_f(struct BENCH_CONTEXT *c) {
+	struct SHORT_TRAINING_DETECTOR_F d;
+	init_short_training_detector_f(&d);
+	sink = update_short_training_detector_f(&d, c->noise_f, c->n_samples, 0.8f, 0);
+}
+
+static void run_gated_detector_f(struct BENCH_CONTEXT *c) {
+	struct ENERGY_GATE g;
+	struct SHORT_TRAINING_DETECTOR_F d;
+	struct DETECTION_EVENT events[16];
+	init_energy_gate(&g);
+	init_short_training_detector_f(&d);
+	sink = detect_short_training_events_gated_f(&g, &d, c->noise_f, c->n_samples, 0.8f, events, 16);
+}
+
+static void run_condition(struct BENCH_CONTEXT *c) {
+	struct SIGNAL_CONDITIONER cond;
+	init_signal_conditioner(&cond);
+	condition_samples(&cond, c->noise_f, c->conditioned_f, c->n_samples);
+}
+
+static void run_streaming_detector_s16(struct BENCH_CONTEXT *c) {
+	struct SHORT_TRAINING_DETECTOR_S16 d;
+	struct DETECTION_EVENT events[16];
+	init_short_training_detector_s16(&d);
+	sink = detect_short_training_events_s16(&d, c->noise_s16, c->n_samples, 0.8, events, 16);
+}
+
+static void run_long_detector_s16(struct BENCH_CONTEXT *c) {
+	struct LONG_TRAINING_DETECTOR_S16 d;
+	struct DETECTION_EVENT events[16];
+	init_long_training_detector_s16(&d);
+	sink = detect_long_training_events_s16(&d, c->noise_s16, c->n_samples, 0.5, events, 16);
+}
+
+static void run_lts_correlator(struct BENCH_CONTEXT *c) {
+	struct DETECTION_EVENT events[16];
+	//the correlator keeps running on the stream made by the repeated noise buffer
+	sink = correlate_long_training(&c->correlator, c->noise, c->n_samples, 0.5, events, 16);
+}
+
+static void run_demap(struct BENCH_CONTEXT *c) {
+	int symbol;
+	for (symbol = 0; symbol < c->tx_params.n_sym; symbol++) {
+		demap_soft(c->mod, c->gain, N_DATA_SUBCARRIERS, c->params.modulation, DEMAP_DEFAULT_SCALE, c->demapped);
+	}
+}
+
+static void run_cfo_estimate(struct BENCH_CONTEXT *c) {
+	double coarse = estimate_coarse_cfo(c->mod_samples, SHORT_TRAINING_SIZE);
+	double fine = estimate_fine_cfo(&c->mod_samples[SHORT_TRAINING_SIZE + 2 * CYCLIC_PREFIX_SIZE]);
+	sink = coarse + fine;
+}
+
+static void run_derotate(struct BENCH_CONTEXT *c) {
+	derotate(&c->nco, c->mod_samples, c->derotated, c->n_samples);
+}
+
+static void run_channel_estimate(struct BENCH_CONTEXT *c) {
+	estimate_channel(&c->demodulator, &c->lts[2 * CYCLIC_PREFIX_SIZE], 1, &c->channel);
+}
+
+static void run_equalize(struct BENCH_CONTEXT *c) {
+	int symbol;
+	for (symbol = 0; symbol < c->tx_params.n_sym; symbol++) {
+		demodulate_symbol(&c->demodulator, c->time, c->received);
+		equalize_symbol(&c->channel, c->received, c->received);
+	}
+}
+
+static void run_equalize_pilots(struct BENCH_CONTEXT *c) {
+	int symbol;
+	for (symbol = 0; symbol < c->tx_params.n_sym; symbol++) {
+		demodulate_symbol(&c->demodulator, c->time, c->received);
+		equalize_symbol_with_pilots(&c->channel, c->received, symbol + 1, 1, c->received, NULL, NULL);
+	}
+}
+
+static void run_signal_decode(struct BENCH_CONTEXT *c) {
+	fftw_complex data[N_DATA_SUBCARRIERS];
+	demodulate_symbol(&c->demodulator, &c->signal[CYCLIC_PREFIX_SIZE], c->received);
+	equalize_symbol_with_pilots(&c->channel, c->received, 0, 0, c->received, NULL, NULL);
+	extract_data_subcarriers(c->received, data, NULL);
+	sink = decode_signal_field(data, c->channel.data_gain, 0, &c->decoded_params);
+}
+
+static void run_deinterleave(struct BENCH_CONTEXT *c) {
+	deinterleave_soft(c->soft, c->deinterleaved, c->tx_params.n_encoded_data_bytes * 8, c->params.n_cbps,
+	                  c->params.n_bpsc);
+}
+
+static void run_depuncture(struct BENCH_CONTEXT *c) {
+	sink = depuncture_soft(c->soft, c->tx_params.n_encoded_data_bytes * 8, c->params.coding_rate, c->depunctured);
+}
+
+static void run_viterbi(struct BENCH_CONTEXT *c) {
+	sink = viterbi_decode(c->soft, c->tx_params.n_encoded_data_bytes * 8, c->params.coding_rate, 0, c->decoded);
+}
+
+static void run_viterbi_batch(struct BENCH_CONTEXT *c) {
+	sink = viterbi_decode_batch(c->batch_soft, VITERBI_LANES, c->tx_params.n_encoded_data_bytes * 8,
+	                            c->params.coding_rate, 0, c->batch_decoded);
+}
+
+static void run_decode_frame(struct BENCH_CONTEXT *c) {
+	int length;
+	//the random psdu has no valid FCS, but the whole frame is decoded anyway
+	sink = ofdm_decode_frame(&c->receiver, c->frame, c->frame_size, c->rx_psdu, &length, NULL);
+}
+
+static void run_decode_filtered(struct BENCH_CONTEXT *c) {
+	int length;
+	c->receiver.filter = &c->filter;
+	sink = ofdm_decode_frame(&c->receiver, c->frame, c->frame_size, c->rx_psdu, &length, NULL);
+	c->receiver.filter = NULL;
+}
+
+static const struct BENCH_KERNEL kernels[] = {
+	{"scramble", run_scramble},
+	{"encode", run_encode},
+	{"puncture", run_puncture},
+	{"interleave", run_interleave},
+	{"modulate", run_modulate},
+	{"pilots", run_pilots},
+	{"ifft", run_ifft},
+	{"cp_window", run_cp_window},
+	{"crc", run_crc},
+	{"autocorrelation", run_autocorrelation},
+	{"short_detector", run_short_detector},
+	{"long_detector", run_long_detector},
+	{"stream_detector", run_streaming_detector},
+	{"stream_detector_f", run_streaming_detector_f},
+	{"gated_detector_f", run_gated_detector_f},
+	{"condition", run_condition},
+	{"stream_detector_s16", run_streaming_detector_s16},
+	{"long_detector_s16", run_long_detector_s16},
+	{"lts_correlator", run_lts_correlator},
+	{"cfo_estimate", run_cfo_estimate},
+	{"derotate", run_derotate},
+	{"channel_estimate", run_channel_estimate},
+	{"equalize", run_equalize},
+	{"equalize_pilots", run_equalize_pilots},
+	{"signal_decode", run_signal_decode},
+	{"demap", run_demap},
+	{"deinterleave", run_deinterleave},
+	{"depuncture", run_depuncture},
+	{"viterbi", run_viterbi},
+	{"viterbi_batch", run_viterbi_batch, VITERBI_LANES},
+	{"decode_frame", run_decode_frame},
+	{"decode_filtered", run_decode_filtered}
+};
+#define N_KERNELS (sizeof(kernels) / sizeof(struct BENCH_KERNEL))
+
+/**
+ * Fill the benchmark context for the given data rate and psdu size, running
+ * the encoding chain once so that every kernel finds valid inputs
+ */
+static void init_context(struct BENCH_CONTEXT *c, enum DATA_RATE data_rate, int psdu_size) {
+
+	int i;
+	//state of a simple linear congruential generator, for reproducible inputs
+	unsigned int lcg = 12345;
+	//framer generating the whole frame
+	struct OFDM_FRAME_ENCODER enc;
+
+	c->params = get_ofdm_parameter(data_rate);
+	c->tx_params = get_tx_parameters(data_rate, psdu_size);
+	c->psdu_size = psdu_size;
+	c->psdu = (char *)malloc(psdu_size);
+	for (i = 0; i < psdu_size; i++) {
+		lcg = lcg * 1103515245 + 12345;
+		c->psdu[i] = (char)(lcg >> 16);
+	}
+
+	generate_data_field(c->psdu, psdu_size, data_rate, &c->data, &c->len);
+
+	c->scrambled_data = (char *)calloc(c->len, sizeof(char));
+	c->encoded_data = (char *)calloc(c->len * 2, sizeof(char));
+	c->punctured_data = (char *)calloc(c->tx_params.n_encoded_data_bytes, sizeof(char));
+	c->interleaved_data = (char *)calloc(c->tx_params.n_encoded_data_bytes, sizeof(char));
+	c->mod = fftw_alloc_complex(N_DATA_SUBCARRIERS);
+	c->pil = fftw_alloc_complex(N_TOTAL_SUBCARRIERS);
+	c->ifft = fftw_alloc_complex(FFT_SIZE);
+	c->time = fftw_alloc_complex(FFT_SIZE);
+	c->ext = fftw_alloc_complex(EXT_OFDM_SYMBOL_SIZE);
+	c->n_samples = FRAME_SIZE(c->tx_params.n_sym);
+	c->mod_samples = fftw_alloc_complex(c->n_samples);
+	zero_samples(c->mod_samples, c->n_samples);
+	c->noise = fftw_alloc_complex(c->n_samples);
+	for (i = 0; i < c->n_samples; i++) {
+		lcg = lcg * 1103515245 + 12345;
+		c->noise[i][0] = ((int)(lcg >> 16) % 2001 - 1000) / 10000.0;
+		lcg = lcg * 1103515245 + 12345;
+		c->noise[i][1] = ((int)(lcg >> 16) % 2001 - 1000) / 10000.0;
+	}
+	c->noise_f = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * c->n_samples);
+	for (i = 0; i < c->n_samples; i++) {
+		c->noise_f[i][0] = (float)c->noise[i][0];
+		c->noise_f[i][1] = (float)c->noise[i][1];
+	}
+	c->conditioned_f = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * c->n_samples);
+	c->noise_s16 = (sample_sc16_t *)malloc(sizeof(sample_sc16_t) * c->n_samples);
+	for (i = 0; i < c->n_samples; i++) {
+		c->noise_s16[i][0] = (short)(c->noise[i][0] * 32767);
+		c->noise_s16[i][1] = (short)(c->noise[i][1] * 32767);
+	}
+	init_long_training_correlator(&c->correlator);
+
+	run_scramble(c);
+	run_encode(c);
+	run_puncture(c);
+	run_interleave(c);
+	run_modulate(c);
+	run_pilots(c);
+	run_ifft(c);
+
+	c->soft = (signed char *)malloc(c->tx_params.n_encoded_data_bytes * 8);
+	for (i = 0; i < c->tx_params.n_encoded_data_bytes * 8; i++) {
+		c->soft[i] = get_ith_bit(c->punctured_data, i) ? 64 : -64;
+	}
+	c->decoded = (char *)calloc(c->len, sizeof(char));
+	c->lts = fftw_alloc_complex(EXT_LONG_TRAINING_SIZE);
+	generate_long_training_sequence(c->lts);
+	init_ofdm_demodulator(&c->demodulator);
+	estimate_channel(&c->demodulator, &c->lts[2 * CYCLIC_PREFIX_SIZE], 1, &c->channel);
+	generate_signal_field(c->signal, data_rate, psdu_size);
+	init_nco(&c->nco, 0.01);
+	c->derotated = fftw_alloc_complex(c->n_samples);
+	c->deinterleaved = (signed char *)malloc(c->tx_params.n_encoded_data_bytes * 8);
+	//at most twice the data bits, at rate 1/2
+	c->depunctured = (signed char *)malloc(c->tx_params.n_encoded_data_bytes * 16);
+	for (i = 0; i < N_DATA_SUBCARRIERS; i++) {
+		c->gain[i] = 0.5 + (i % 4) * 0.25;
+	}
+	for (i = 0; i < VITERBI_LANES; i++) {
+		c->batch_soft[i] = c->soft;
+		c->batch_decoded[i] = (char *)calloc(c->len, sizeof(char));
+	}
+	init_ofdm_frame_encoder(&enc);
+	generate_ofdm_frame(&enc, c->psdu, psdu_size, data_rate, &c->frame, &c->frame_size);
+	free_ofdm_frame_encoder(&enc);
+	init_ofdm_frame_decoder(&c->receiver);
+	init_address_filter(&c->filter, 0);
+	add_watched_address(&c->filter, "00:60:08:cd:37:a6");
+
+}
+
+static void free_context(struct BENCH_CONTEXT *c) {
+	int i;
+	free(c->psdu);
+	free(c->data);
+	free(c->scrambled_data);
+	free(c->encoded_data);
+	free(c->punctured_data);
+	free(c->interleaved_data);
+	fftw_free(c->mod);
+	fftw_free(c->pil);
+	fftw_free(c->ifft);
+	fftw_free(c->time);
+	fftw_free(c->ext);
+	fftw_free(c->mod_samples);
+	fftw_free(c->noise);
+	free(c->noise_f);
+	free(c->noise_s16);
+	free(c->conditioned_f);
+	free_long_training_correlator(&c->correlator);
+	free(c->soft);
+	free(c->decoded);
+	fftw_free(c->lts);
+	free_ofdm_demodulator(&c->demodulator);
+	fftw_free(c->derotated);
+	free(c->deinterleaved);
+	free(c->depunctured);
+	for (i = 0; i < VITERBI_LANES; i++) {
+		free(c->batch_decoded[i]);
+	}
+	fftw_free(c->frame);
+	free_ofdm_frame_decoder(&c->receiver);
+}
+
+static int compare_double(const void *a, const void *b) {
+	double da = *(const double *)a, db = *(const double *)b;
+	return da < db ? -1 : da > db ? 1 : 0;
+}
+
+/**
+ * Measure a kernel. The number of iterations is doubled until a batch
+ * lasts at least min_time nanoseconds, then REPETITIONS batches are run
+ * and the median time per iteration is returned
+ */
+static double measure(const struct BENCH_KERNEL *k, struct BENCH_CONTEXT *c, nanotimer_t min_time, long *iterations) {
+
+	long n = 1, i;
+	int r;
+	nanotimer_t t, elapsed;
+	double times[REPETITIONS];
+
+	//warm up caches and lazily initialized tables
+	k->run(c);
+
+	while (1) {
+		t = start_timer();
+		for (i = 0; i < n; i++) {
+			k->run(c);
+		}
+		elapsed = elapsed_nanosecond(t);
+		if (elapsed >= min_time) {
+			break;
+		}
+		n *= 2;
+	}
+
+	for (r = 0; r < REPETITIONS; r++) {
+		t = start_timer();
+		for (i = 0; i < n; i++) {
+			k->run(c);
+		}
+		times[r] = (double)elapsed_nanosecond(t) / n;
+	}
+
+	qsort(times, REPETITIONS, sizeof(double), compare_double);
+	*iterations = n;
+	return times[REPETITIONS / 2];
+
+}
+
+/**
+ * Parse a comma separated list of psdu sizes
+ */
+static int parse_sizes(const char *list, int **sizes) {
+
+	int n = 1, i;
+	const char *c;
+	char *end;
+
+	for (c = list; *c; c++) {
+		if (*c == ',') {
+			n++;
+		}
+	}
+
+	*sizes = (int *)calloc(n, sizeof(int));
+
+	c = list;
+	for (i = 0; i < n; i++) {
+		(*sizes)[i] = (int)strtol(c, &end, 10);
+		if (end == c || (*sizes)[i] < 1 || (*sizes)[i] > 4095 || (*end != ',' && *end != '\0')) {
+			return -1;
+		}
+		c = end + 1;
+	}
+
+	return n;
+
+}
+
+void usage(const char *argv0) {
+	printf("Usage %s: [-h] [-t time] [-s sizes] [-k kernel] [-j json file]\n\n"
+	       "\t-h\tPrint this help and exit\n\n"
+	       "\t-t\tMinimum duration of a measurement batch in milliseconds. Each measurement\n"
+	       "\t\tis repeated %d times and the median is reported. Default is 10 ms\n\n"
+	       "\t-s\tComma separated list of PSDU sizes in bytes. Default is 64,256,1500,4095\n\n"
+	       "\t-k\tRun only the given kernel. Available kernels are scramble, encode, puncture,\n"
+	       "\t\tinterleave, modulate, pilots, ifft, cp_window, crc, autocorrelation,\n"
+	       "\t\tshort_detector, long_detector, stream_detector, stream_detector_f,\n"
+	       "\t\tgated_detector_f, condition, stream_detector_s16, long_detector_s16,\n"
+	       "\t\tlts_correlator, cfo_estimate, derotate, channel_estimate, equalize,\n"
+	       "\t\tequalize_pilots, signal_decode, demap, deinterleave, depuncture, viterbi,\n"
+	       "\t\tviterbi_batch, decode_frame and decode_filtered. Batched kernels report the\n"
+	       "\t\ttime per frame\n\n"
+	       "\t-j\tWrite the results in JSON format to the given file\n", argv0, REPETITIONS);
+}
+
+/**
+ * Runs every kernel at every data rate and for a range of psdu sizes, and
+ * reports the throughput in ns/byte, Mbit/s (of PSDU) and Msamples/s (of
+ * time samples of the frame the PSDU is encoded into)
+ */
+int main(int argc, char **argv) {
+
+	int c;
+	//minimum batch duration in ms
+	int min_ms = 10;
+	//psdu sizes
+	int *sizes = 0;
+	int n_sizes = sizeof(default_sizes) / sizeof(int);
+	//kernel filter
+	char *only = 0;
+	//json output
+	char *jsonfile = 0;
+	FILE *json = 0;
+	//indexes
+	int r, s;
+	unsigned int k;
+	//number of results written to the json file
+	int n_results = 0;
+
+	while ((c = getopt(argc, argv, "ht:s:k:j:")) != -1) {
+
+		switch (c) {
+
+			case 'h':
+				usage(argv[0]);
+				return 0;
+
+			case 't':
+				if (sscanf(optarg, "%d", &min_ms) != 1 || min_ms < 1) {
+					printf("Invalid time %s\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 's':
+				free(sizes);
+				n_sizes = parse_sizes(optarg, &sizes);
+				if (n_sizes == -1) {
+					printf("Invalid PSDU sizes %s\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 'k':
+				only = optarg;
+				break;
+
+			case 'j':
+				jsonfile = optarg;
+				break;
+
+			default:
+				return 1;
+
+		}
+
+	}
+
+	if (!sizes) {
+		sizes = (int *)malloc(sizeof(default_sizes));
+		memcpy(sizes, default_sizes, sizeof(default_sizes));
+	}
+
+	if (jsonfile) {
+		json = fopen(jsonfile, "w");
+		if (!json) {
+			printf("Cannot open \"%s\" for write. Permission denied?\n", jsonfile);
+			return 1;
+		}
+	}
+
+	//use the cheapest timer, if available
+	set_timer_backend(TIMER_TSC);
+
+	printf("timer backend: %s, overhead: %.1f ns\n\n", get_timer_backend() == TIMER_TSC ? "tsc" : "monotonic_raw",
+	       measure_timer_overhead(100000));
+	printf("%-20s %-18s %6s %10s %14s %12s %12s %12s\n", "kernel", "data rate", "psdu", "iterations", "ns/call",
+	       "ns/byte", "Mbit/s", "Msamples/s");
+
+	if (json) {
+		fprintf(json, "{\n\"timer\": \"%s\",\n\"results\": [\n", get_timer_backend() == TIMER_TSC ? "tsc" : "monotonic_raw");
+	}
+
+	for (k = 0; k < N_KERNELS; k++) {
+
+		if (only && strcmp(only, kernels[k].name) != 0) {
+			continue;
+		}
+
+		for (r = 0; r < N_DATA_RATES; r++) {
+
+			for (s = 0; s < n_sizes; s++) {
+
+				struct BENCH_CONTEXT ctx;
+				long iterations;
+				double ns, ns_byte, mbps, msps;
+
+				init_context(&ctx, (enum DATA_RATE)r, sizes[s]);
+
+				ns = measure(&kernels[k], &ctx, (nanotimer_t)min_ms * 1000000, &iterations);
+				if (kernels[k].frames > 1) {
+					ns /= kernels[k].frames;
+				}
+				ns_byte = ns / sizes[s];
+				mbps = sizes[s] * 8 / ns * 1e3;
+				msps = ctx.n_samples / ns * 1e3;
+
+				printf("%-20s %-18s %6d %10ld %14.1f %12.3f %12.3f %12.3f\n", kernels[k].name, STR_DATA_RATE[r], sizes[s],
+				       iterations, ns, ns_byte, mbps, msps);
+				fflush(stdout);
+
+				if (json) {
+					fprintf(json, "%s{\"kernel\": \"%s\", \"data_rate\": \"%s\", \"psdu_size\": %d, \"iterations\": %ld, "
+					        "\"ns_per_call\": %.3f, \"ns_per_byte\": %.4f, \"mbit_s\": %.4f, \"msamples_s\": %.4f}",
+					        n_results ? ",\n" : "", kernels[k].name, STR_DATA_RATE[r], sizes[s], iterations, ns, ns_byte,
+					        mbps, msps);
+					n_results++;
+				}
+
+				free_context(&ctx);
+
+			}
+
+		}
+
+	}
+
+	if (json) {
+		fprintf(json, "\n]\n}\n");
+		fclose(json);
+	}
+
+	free(sizes);
+
+	return 0;
+
+}
@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <fftw3.h>
+
+#include "ofdm_utils.h"
+#include "bit_utils.h"
+#include "mac_utils.h"
+#include "utils.h"
+
+/**
+ * An entry of the traffic mix: msdu size and data rate
+ */
+struct MIX_ENTRY {
+	int msdu_size;
+	enum DATA_RATE data_rate;
+};
+
+//fixed traffic mix, cycled over during the benchmark. small control-like frames
+//and full size frames, at robust and at fast data rates
+static const struct MIX_ENTRY default_mix[] = {
+	{  64, BW_20_DR_6_MBPS},
+	{  64, BW_20_DR_24_MBPS},
+	{ 256, BW_20_DR_12_MBPS},
+	{ 576, BW_20_DR_24_MBPS},
+	{1500, BW_20_DR_6_MBPS},
+	{1500, BW_20_DR_36_MBPS},
+	{1500, BW_20_DR_54_MBPS},
+};
+#define N_MIX (sizeof(default_mix) / sizeof(struct MIX_ENTRY))
+
+//largest msdu in the mix, used to size the payload buffer
+#define MAX_MSDU_SIZE 1500
+
+/**
+ * Results of a benchmark run
+ */
+struct FRAME_BENCH_RESULT {
+	int frames;
+	double frames_per_second;
+	double p50_ns;
+	double p99_ns;
+	double mean_ns;
+};
+
+static int compare_double(const void *a, const void *b) {
+	double da = *(const double *)a, db = *(const double *)b;
+	return da < db ? -1 : da > db ? 1 : 0;
+}
+
+/**
+ * Writes the frame to the sink in the binary format of mac_ofdm_framer, i.e.,
+ * interleaved 32 bit floats
+ */
+static void write_frame(FILE *sink, float *buffer, fftw_complex *samples, int n_samples) {
+
+	int i;
+	for (i = 0; i < n_samples; i++) {
+		buffer[2 * i] = samples[i][0];
+		buffer[2 * i + 1] = samples[i][1];
+	}
+	fwrite(buffer, sizeof(float), 2 * n_samples, sink);
+
+}
+
+/**
+ * Generates n frames cycling over the mix, going through the same steps of
+ * mac_ofdm_framer (MAC header, FCS, OFDM encoding and output), and measures
+ * the latency of each frame
+ */
+static void run_benchmark(const struct MIX_ENTRY *mix, int n_mix, int warmup, int n, FILE *sink, struct FRAME_BENCH_RESULT *res) {
+
+	struct OFDM_FRAME_ENCODER encoder;
+	char msdu[MAX_MSDU_SIZE];
+	char *psdu;
+	int psdu_length;
+	fftw_complex *samples;
+	int n_samples;
+	float *buffer;
+	dbyte frame_control, duration;
+	struct MAC_DATAFRAME_HEADER header;
+	double *latencies;
+	double total = 0;
+	nanotimer_t t, start = 0;
+	unsigned int seed = 12345;
+	int i;
+
+	//pseudo random, but reproducible, payload
+	for (i = 0; i < MAX_MSDU_SIZE; i++) {
+		seed = seed * 1103515245 + 12345;
+		msdu[i] = (char)(seed >> 16);
+	}
+
+	//the largest frame is given by the largest msdu at the lowest rate
+	buffer = (float *)malloc(sizeof(float) * 2 * FRAME_SIZE(get_tx_parameters(BW_20_DR_6_MBPS, MAX_MSDU_SIZE + 28).n_sym));
+	latencies = (double *)malloc(sizeof(double) * n);
+
+	construct_dbyte(0x04, 0x02, &frame_control);
+	construct_dbyte(0xFF, 0xFF, &duration);
+
+	init_ofdm_frame_encoder(&encoder);
+
+	for (i = -warmup; i < n; i++) {
+
+		const struct MIX_ENTRY *e = &mix[(i + warmup) % n_mix];
+
+		if (i == 0) {
+			start = start_timer();
+		}
+
+		t = start_timer();
+
+		header = generate_mac_header(frame_control, duration, 0, 0, 0, (byte)i);
+		generate_mac_data_frame(msdu, e->msdu_size, header, &psdu, &psdu_length);
+		generate_ofdm_frame(&encoder, psdu, psdu_length, e->data_rate, &samples, &n_samples);
+		write_frame(sink, buffer, samples, n_samples);
+
+		free(psdu);
+		fftw_free(samples);
+
+		if (i >= 0) {
+			latencies[i] = (double)elapsed_nanosecond(t);
+			total += latencies[i];
+		}
+
+	}
+
+	res->frames = n;
+	res->frames_per_second = n / (elapsed_nanosecond(start) / 1e9);
+	res->mean_ns = total / n;
+
+	qsort(latencies, n, sizeof(double), compare_double);
+	res->p50_ns = latencies[n / 2];
+	res->p99_ns = latencies[(int)(n * 0.99) < n ? (int)(n * 0.99) : n - 1];
+
+	free_ofdm_frame_encoder(&encoder);
+	free(latencies);
+	free(buffer);
+
+}
+
+/**
+ * Converts a 20 MHz data rate in Mbps into the corresponding DATA_RATE
+ *
+ * \return the data rate, or -1 if the rate is invalid
+ */
+static int rate_from_mbps(int mbps) {
+
+	switch (mbps) {
+		case 6:
+			return BW_20_DR_6_MBPS;
+		case 9:
+			return BW_20_DR_9_MBPS;
+		case 12:
+			return BW_20_DR_12_MBPS;
+		case 18:
+			return BW_20_DR_18_MBPS;
+		case 24:
+			return BW_20_DR_24_MBPS;
+		case 36:
+			return BW_20_DR_36_MBPS;
+		case 48:
+			return BW_20_DR_48_MBPS;
+		case 54:
+			return BW_20_DR_54_MBPS;
+		default:
+			return -1;
+	}
+
+}
+
+/**
+ * Looks for "key": value in a JSON text and parses the number
+ *
+ * \return 1 if the key has been found, 0 otherwise
+ */
+static int read_json_number(const char *text, const char *key, double *value) {
+
+	char pattern[64];
+	const char *c;
+	char *end;
+
+	snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+	c = strstr(text, pattern);
+	if (!c) {
+		return 0;
+	}
+	c = strchr(c + strlen(pattern), ':');
+	if (!c) {
+		return 0;
+	}
+	*value = strtod(c + 1, &end);
+	return end != c + 1;
+
+}
+
+/**
+ * Compares the results against a baseline. Frames/s must not decrease, and
+ * the median latency must not increase, by more than threshold percent. The
+ * p99 latency is only reported, as it is too sensitive to system noise
+ *
+ * \return 0 if no regression has been found, 1 otherwise
+ */
+static int check_regression(const char *baselinefile, double threshold, const struct FRAME_BENCH_RESULT *res) {
+
+	FILE *f;
+	char text[4096];
+	size_t n;
+	double fps, p50, p99;
+	int failed = 0;
+
+	f = fopen(baselinefile, "r");
+	if (!f) {
+		printf("Cannot open baseline file \"%s\"\n", baselinefile);
+		return 1;
+	}
+	n = fread(text, 1, sizeof(text) - 1, f);
+	text[n] = 0;
+	fclose(f);
+
+	if (!read_json_number(text, "frames_per_second", &fps) || !read_json_number(text, "p50_ns", &p50) ||
+	    !read_json_number(text, "p99_ns", &p99)) {
+		printf("Invalid baseline file \"%s\"\n", baselinefile);
+		return 1;
+	}
+
+	printf("\n%-18s %14s %14s %9s\n", "metric", "baseline", "current", "change");
+	printf("%-18s %14.1f %14.1f %+8.1f%%\n", "frames/s", fps, res->frames_per_second, 100 * (res->frames_per_second / fps - 1));
+	printf("%-18s %14.1f %14.1f %+8.1f%%\n", "p50 latency (ns)", p50, res->p50_ns, 100 * (res->p50_ns / p50 - 1));
+	printf("%-18s %14.1f %14.1f %+8.1f%%\n", "p99 latency (ns)", p99, res->p99_ns, 100 * (res->p99_ns / p99 - 1));
+
+	if (res->frames_per_second < fps * (1 - threshold / 100)) {
+		printf("REGRESSION: frames/s dropped by more than %.1f%%\n", threshold);
+		failed = 1;
+	}
+	if (res->p50_ns > p50 * (1 + threshold / 100)) {
+		printf("REGRESSION: p50 latency increased by more than %.1f%%\n", threshold);
+		failed = 1;
+	}
+	if (!failed) {
+		printf("no regression beyond %.1f%%\n", threshold);
+	}
+
+	return failed;
+
+}
+
+void usage(const char *argv0) {
+	printf("Usage %s: [-h] [-n frames] [-w warmup frames] [-s msdu size] [-d data rate] [-j json file] "
+	       "[-b baseline file] [-m max regression]\n\n"
+	       "\t-h\tPrint this help and exit\n\n"
+	       "\t-n\tNumber of measured frames. Default is 1400, i.e., 200 times the traffic mix\n\n"
+	       "\t-w\tNumber of frames generated before starting the measurement. Default is 70\n\n"
+	       "\t-s\tUse a fixed MSDU size instead of the default traffic mix\n\n"
+	       "\t-d\tUse a fixed data rate in Mbps (6, 9, 12, 18, 24, 36, 48 or 54) instead of\n"
+	       "\t\tthe default traffic mix\n\n"
+	       "\t-j\tWrite the results in JSON format to the given file. The file can be\n"
+	       "\t\tused as baseline for later runs\n\n"
+	       "\t-b\tCompare the results against the given baseline JSON file, and exit with\n"
+	       "\t\tan error if a regression is found\n\n"
+	       "\t-m\tMaximum tolerated regression in percent, for frames/s and p50 latency.\n"
+	       "\t\tDefault is 50\n", argv0);
+}
+
+/**
+ * Measures the end-to-end performance of the framer, i.e., generation of the
+ * MAC header and FCS, OFDM encoding, and output of binary samples to a sink
+ * (/dev/null), reporting frames/s and the p50 and p99 per-frame latency
+ */
+int main(int argc, char **argv) {
+
+	int c;
+	//number of measured and warm up frames
+	int n_frames = 1400, warmup = 70;
+	//fixed msdu size and data rate, overriding the mix
+	int msdu_size = 0, data_rate = 0;
+	//json output and baseline
+	char *jsonfile = 0, *baselinefile = 0;
+	//maximum tolerated regression (percent)
+	double threshold = 50;
+	//traffic mix
+	struct MIX_ENTRY mix[N_MIX];
+	int n_mix = N_MIX;
+	struct FRAME_BENCH_RESULT res;
+	FILE *sink;
+	int i, failed = 0;
+
+	while ((c = getopt(argc, argv, "hn:w:s:d:j:b:m:")) != -1) {
+
+		switch (c) {
+
+			case 'h':
+				usage(argv[0]);
+				return 0;
+
+			case 'n':
+				if (sscanf(optarg, "%d", &n_frames) != 1 || n_frames < 1) {
+					printf("Invalid number of frames %s\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 'w':
+				if (sscanf(optarg, "%d", &warmup) != 1 || warmup < 0) {
+					printf("Invalid number of warm up frames %s\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 's':
+				if (sscanf(optarg, "%d", &msdu_size) != 1 || msdu_size < 1 || msdu_size > MAX_MSDU_SIZE) {
+					printf("Invalid MSDU size %s\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 'd':
+				if (sscanf(optarg, "%d", &data_rate) != 1 || rate_from_mbps(data_rate) == -1) {
+					printf("Invalid data rate %s\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 'j':
+				jsonfile = optarg;
+				break;
+
+			case 'b':
+				baselinefile = optarg;
+				break;
+
+			case 'm':
+				if (sscanf(optarg, "%lf", &threshold) != 1 || threshold < 0) {
+					printf("Invalid regression threshold %s\n", optarg);
+					return 1;
+				}
+				break;
+
+			default:
+				return 1;
+
+		}
+
+	}
+
+	memcpy(mix, default_mix, sizeof(default_mix));
+	if (msdu_size || data_rate) {
+		//a single entry, taking from the first entry of the mix what is not specified
+		n_mix = 1;
+		if (msdu_size) {
+			mix[0].msdu_size = msdu_size;
+		}
+		if (data_rate) {
+			mix[0].data_rate = (enum DATA_RATE)rate_from_mbps(data_rate);
+		}
+	}
+
+	sink = fopen("/dev/null", "wb");
+	if (!sink) {
+		printf("Cannot open /dev/null\n");
+		return 1;
+	}
+
+	//use the cheapest timer, if available
+	set_timer_backend(TIMER_TSC);
+
+	printf("traffic mix:");
+	for (i = 0; i < n_mix; i++) {
+		printf(" %d@%s", mix[i].msdu_size, STR_DATA_RATE[mix[i].data_rate]);
+	}
+	printf("\n");
+
+	run_benchmark(mix, n_mix, warmup, n_frames, sink, &res);
+	fclose(sink);
+
+	printf("frames:            %d\n", res.frames);
+	printf("frames/s:          %.1f\n", res.frames_per_second);
+	printf("mean latency (ns): %.1f\n", res.mean_ns);
+	printf("p50 latency (ns):  %.1f\n", res.p50_ns);
+	printf("p99 latency (ns):  %.1f\n", res.p99_ns);
+
+	if (jsonfile) {
+		FILE *json = fopen(jsonfile, "w");
+		if (!json) {
+			printf("Cannot open \"%s\" for write. Permission denied?\n", jsonfile);
+			return 1;
+		}
+		fprintf(json, "{\n\"frames\": %d,\n\"frames_per_second\": %.1f,\n\"mean_ns\": %.1f,\n\"p50_ns\": %.1f,\n\"p99_ns\": %.1f\n}\n",
+		        res.frames, res.frames_per_second, res.mean_ns, res.p50_ns, res.p99_ns);
+		fclose(json);
+	}
+
+	if (baselinefile) {
+		failed = check_regression(baselinefile, threshold, &res);
+	}
+
+	return failed;
+
+}
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "capture_utils.h"
+#include "index_utils.h"
+#include "bit_utils.h"
+
+/**
+ * Decodes the frames of the capture with a pool of decoding threads, and
+ * appends the record of each frame to the index as it is delivered
+ *
+ * \param capture the capture
+ * \param n_threads number of decoding threads
+ * \param indexfile path of the index file
+ * \return the number of frames in the index, ERR_INDEX_CANNOT_WRITE or
+ * ERR_POOL_THREADS
+ */
+long long index_frames(const struct CAPTURE *capture, int n_threads, const char *indexfile) {
+
+	struct FRAME_INDEX_WRITER writer;
+	struct DECODER_POOL pool;
+
+	if (create_frame_index(&writer, indexfile, capture->format) != 0) {
+		return ERR_INDEX_CANNOT_WRITE;
+	}
+	if (init_decoder_pool(&pool, n_threads) != 0) {
+		close_frame_index_writer(&writer);
+		return ERR_POOL_THREADS;
+	}
+	decode_capture(&pool, capture, index_decoded_frame, &writer);
+	free_decoder_pool(&pool);
+	close_frame_index_writer(&writer);
+
+	return writer.err == 0 ? writer.n_records : writer.err;
+
+}
+
+void usage(const char *argv0) {
+
+	/**
+	 * h help
+	 * f format (cf32/sc16)
+	 * t threads
+	 * c chunk size
+	 * T threshold
+	 * q quiet
+	 * i index file
+	 */
+	printf("Usage %s: [-h] [-f format] [-t threads] [-c chunk size] [-T threshold] [-q] [-i index file] capture\n\n"
+	       "\t-h\tPrint this help and exit\n\n"
+	       "\t-f\tFormat of the samples of the capture, i.e., \"cf32\" (single precision\n"
+	       "\t\tcomplex, as written by mac_ofdm_framer in binary mode or by GNURadio) or\n"
+	       "\t\t\"sc16\" (complex 16 bit integers). By default, cf32 is used\n\n"
+	       "\t-t\tNumber of threads scanning the capture, and decoding its frames with\n"
+	       "\t\t-i. By default, 4 threads are used\n\n"
+	       "\t-c\tNumber of samples of the chunks scanned by each thread. By default,\n"
+	       "\t\t%d samples\n\n"
+	       "\t-T\tThreshold of the short training detector, between 0 and 1. By default,\n"
+	       "\t\t0.8 is used\n\n"
+	       "\t-q\tDo not print the detections, only the summary\n\n"
+	       "\t-i\tDecode the frames of the capture, and write the frame index\n"
+	       "\t\tof the capture, i.e., position, data rate, length, SNR, frequency offset\n"
+	       "\t\tand FCS status of each frame, to the given file. By convention, the index\n"
+	       "\t\tis stored next to the capture, with the \"" FRAME_INDEX_EXTENSION "\" extension\n\n"
+	       "The capture is memory mapped, so files of any size can be scanned. For each\n"
+	       "detected preamble, the index of its first sample and the value of the timing\n"
+	       "metric are printed on stdout. A summary with the scanning speed is printed on\n"
+	       "stderr\n", argv0, CAPTURE_CHUNK_SIZE);
+
+}
+
+int main(int argc, char **argv) {
+
+	//the capture file
+	struct CAPTURE capture;
+	enum CAPTURE_FORMAT format = CAPTURE_CF32;
+	//detected preambles
+	struct DETECTION_EVENT *events;
+	long long n_events, n_frames, i;
+	//index file
+	const char *indexfile = NULL;
+	int n_threads = 4, chunk_size = CAPTURE_CHUNK_SIZE, quiet = 0, err, c;
+	double threshold = 0.8, elapsed;
+	struct timespec start, end;
+
+	while ((c = getopt(argc, argv, "hf:t:c:T:qi:")) != -1) {
+
+		switch (c) {
+
+			case 'h':
+				usage(argv[0]);
+				return 0;
+
+			case 'f':
+				if (strcmp(optarg, STR_CAPTURE_FORMAT[CAPTURE_CF32]) == 0) {
+					format = CAPTURE_CF32;
+				}
+				else if (strcmp(optarg, STR_CAPTURE_FORMAT[CAPTURE_SC16]) == 0) {
+					format = CAPTURE_SC16;
+				}
+				else {
+					fprintf(stderr, "Invalid format \"%s\"\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 't':
+				n_threads = atoi(optarg);
+				if (n_threads < 1 || n_threads > CAPTURE_MAX_THREADS) {
+					fprintf(stderr, "The number of threads must be between 1 and %d\n", CAPTURE_MAX_THREADS);
+					return 1;
+				}
+				break;
+
+			case 'c':
+				chunk_size = atoi(optarg);
+				if (chunk_size <= 0 || chunk_size > CAPTURE_CHUNK_SIZE_MAX) {
+					fprintf(stderr, "Invalid chunk size \"%s\"\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 'T':
+				threshold = atof(optarg);
+				break;
+
+			case 'q':
+				quiet = 1;
+				break;
+
+			case 'i':
+				indexfile = optarg;
+				break;
+
+			default:
+				usage(argv[0]);
+				return 1;
+
+		}
+
+	}
+
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	err = open_capture(&capture, argv[optind], format);
+	if (err == ERR_CANNOT_READ_FILE) {
+		fprintf(stderr, "Cannot read file \"%s\"\n", argv[optind]);
+		return 1;
+	}
+	if (err == ERR_INVALID_FORMAT) {
+		fprintf(stderr, "The size of \"%s\" is not a multiple of the size of a %s sample\n", argv[optind],
+		        STR_CAPTURE_FORMAT[format]);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	n_events = scan_capture(&capture, n_threads, chunk_size, threshold, &events);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	if (!quiet) {
+		for (i = 0; i < n_events; i++) {
+			printf("%lld %f\n", events[i].sample, events[i].metric);
+		}
+	}
+	fprintf(stderr, "%lld samples, %lld preambles, %.3f s (%.1f Msamples/s)\n", capture.n_samples, n_events,
+	        elapsed, elapsed > 0 ? capture.n_samples / elapsed / 1e6 : 0);
+
+	if (indexfile) {
+		n_frames = index_frames(&capture, n_threads, indexfile);
+		if (n_frames == ERR_INDEX_CANNOT_WRITE) {
+			fprintf(stderr, "Cannot write \"%s\". Permission denied?\n", indexfile);
+		}
+		else if (n_frames == ERR_POOL_THREADS) {
+			fprintf(stderr, "Cannot start the decoding threads\n");
+		}
+		else {
+			fprintf(stderr, "%lld frames written to \"%s\"\n", n_frames, indexfile);
+		}
+	}
+
+	free(events);
+	close_capture(&capture);
+
+	return 0;
+
+}
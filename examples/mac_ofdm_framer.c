@@ -8,6 +8,7 @@
 #include "ofdm_utils.h"
 #include "bit_utils.h"
 #include "mac_utils.h"
+#include "profiler.h"
 
 #define TEXT    0
 #define BIN     1
@@ -17,6 +18,101 @@ void copy_argument(char **to, const char *from) {
 	strcpy(*to, from);
 }
 
+/**
+ * Write a set of complex time samples to the output file
+ *
+ * \param f output file
+ * \param format output format (TEXT or BIN)
+ * \param samples samples to be written
+ * \param size number of samples to write
+ * \param base_index index of the first sample, printed in textual mode
+ */
+void write_samples(FILE *f, int format, fftw_complex *samples, int size, long long base_index) {
+
+	int i;
+	for (i = 0; i < size; i++) {
+
+		if (format == BIN) {
+			float val;
+			val = samples[i][0];
+			fwrite(&val, sizeof(float), 1, f);
+			val = samples[i][1];
+			fwrite(&val, sizeof(float), 1, f);
+		}
+		else {
+			fprintf(f, "%lld %f %f\n", base_index + i, samples[i][0], samples[i][1]);
+		}
+	}
+
+}
+
+/**
+ * Write a run of zero samples (i.e., an inter-frame gap) to the output file.
+ * When the output is a seekable binary file, the gap is not written but simply
+ * skipped, so that the file system can store it as a hole. The zeros are written
+ * explicitly for textual output or for non seekable outputs, such as pipes
+ *
+ * \param f output file
+ * \param format output format (TEXT or BIN)
+ * \param seekable whether the output file supports seeking
+ * \param size number of zero samples in the gap
+ * \param base_index index of the first sample of the gap, printed in textual mode
+ */
+void write_gap(FILE *f, int format, int seekable, long long size, long long base_index) {
+
+	//block of zero samples used when the gap must be written explicitly
+	static fftw_complex zeros[256];
+	//number of samples still to be written
+	long long left = size;
+
+	if (format == BIN && seekable) {
+		if (fseeko(f, (off_t)(size * 2 * sizeof(float)), SEEK_CUR) == 0) {
+			return;
+		}
+	}
+
+	while (left > 0) {
+		int n = left > 256 ? 256 : (int)left;
+		write_samples(f, format, zeros, n, base_index + size - left);
+		left -= n;
+	}
+
+}
+
+/**
+ * Parse a comma separated list of inter-frame gaps
+ *
+ * \param list the list given on the command line
+ * \param gaps pointer to a non-alloced array where the gaps will be stored
+ * \return the number of gaps in the list, or -1 if the list is invalid
+ */
+int parse_gaps(const char *list, long long **gaps) {
+
+	int n = 1, i;
+	const char *c;
+	char *end;
+
+	for (c = list; *c; c++) {
+		if (*c == ',') {
+			n++;
+		}
+	}
+
+	*gaps = (long long *)calloc(n, sizeof(long long));
+
+	c = list;
+	for (i = 0; i < n; i++) {
+		(*gaps)[i] = strtoll(c, &end, 10);
+		if (end == c || (*gaps)[i] < 0 || (*end != ',' && *end != '\0')) {
+			return -1;
+		}
+		c = end + 1;
+	}
+
+	return n;
+
+}
+
 void usage(const char *argv0) {
 
 	/**
@@ -31,9 +127,13 @@ void usage(const char *argv0) {
 	 * p payload
 	 * r repeat
 	 * d data rate
+	 * g inter-frame gaps
+	 * i frame index
+	 * P profiling summary
+	 * T profiling trace
 	 */
 	printf("Usage %s: [-h] [-s sender mac address] [-r receiver mac address] [-b bssid] [-n sequence number] [-c control field] "
-	       "[-f format] [-o output] [-p payload] [-r]\n\n"
+	       "[-f format] [-o output] [-p payload] [-r] [-g gaps] [-i index file] [-P] [-T trace file]\n\n"
 	       "\t-h\tPrint this help and exit\n\n"
 	       "\t-b\tSet address1 field. If not specified, 00:60:08:cd:37:a6 is used\n\n"
 	       "\t\tThe format of any MAC address must be colon separated hexadecimal values\n\n"
@@ -60,7 +160,18 @@ void usage(const char *argv0) {
 	       "\t\tyou just need to change the sampling frequency before sending the frame with\n"
 	       "\t\tyour software defined radio. For example, by encoding a frame with a datarate\n"
 	       "\t\tof 6 Mbps and sending it out using a sampling frequency of 10 MHz, you will\n"
-	       "\t\tobtain a 3 Mbps frame. The default datarate is set to 36 Mbps\n", argv0);
+	       "\t\tobtain a 3 Mbps frame. The default datarate is set to 36 Mbps\n\n"
+	       "\t-g\tBurst mode. Frames are laid out on a single continuous sample timeline,\n"
+	       "\t\tseparated by the given number of zero samples (e.g., SIFS, DIFS or backoff\n"
+	       "\t\ttimes expressed in samples). A comma separated list can be specified, in\n"
+	       "\t\twhich case the gaps are used cyclically. In textual mode, sample indexes\n"
+	       "\t\tare absolute. In binary mode, gaps are skipped without being written if\n"
+	       "\t\tthe output file is seekable. Should be used together with -r\n\n"
+	       "\t-i\tWrite an index file with the start sample and the number of samples of\n"
+	       "\t\teach generated frame\n\n"
+	       "\t-P\tProfile the encoding stages and print a summary on stderr at exit\n\n"
+	       "\t-T\tProfile the encoding stages and write a Chrome trace-event JSON file,\n"
+	       "\t\twhich can be loaded in chrome://tracing\n", argv0);
 
 }
 
@@ -76,40 +187,12 @@ int main(int argc, char **argv) {
 	int psdu_length;
 	//ofdm encoding parameters
 	struct OFDM_PARAMETERS params = get_ofdm_parameter(BW_20_DR_36_MBPS);
-	//transmission parameters
-	struct TX_PARAMETERS tx_params;
-	//OFDM DATA field, and auxiliary storage
-	char *data = 0;
-	//length of the DATA field
-	int len;
-	//scrambled data field
-	char *scrambled_data = 0;
-	//encoded data field
-	char *encoded_data = 0;
-	//punctured data field
-	char *punctured_data = 0;
-	//interleaved data field
-	char *interleaved_data = 0;
-	//OFDM modulated symbol
-	fftw_complex *mod = 0;
-	//symbol with pilot carriers
-	fftw_complex *pil = 0;
-	//ifft inputs
-	fftw_complex *ifft = 0;
-	//symbol time samples (after ifft)
-	fftw_complex *time = 0;
-	//cyclically extended symbol
-	fftw_complex *ext = 0;
-	//signal header
-	fftw_complex *signal = 0;
-	//short training sequence
-	fftw_complex *short_sequence = 0;
-	//long training sequence
-	fftw_complex *long_sequence = 0;
+	//frame encoder, with buffers reused across frames
+	struct OFDM_FRAME_ENCODER encoder;
 	//final OFDM frame
 	fftw_complex *mod_samples = 0;
-	//index of data symbol under processing
-	int symbol;
+	//number of samples in the frame
+	int n_samples;
 	//fields for the mac header
 	dbyte frame_control, duration;
 	//mac header
@@ -129,6 +212,10 @@ int main(int argc, char **argv) {
 	 * p payload
 	 * r repeat
 	 * d data
+	 * g gaps
+	 * i index
+	 * P profiling summary
+	 * T profiling trace
 	 */
 
 	//sender, receiver and bssid addresses
@@ -147,6 +234,18 @@ int main(int argc, char **argv) {
 	int repeat = 0;
 	//data rate
 	int data_rate = 36;
+	//inter-frame gaps for burst mode
+	long long *gaps = 0;
+	//number of inter-frame gaps
+	int n_gaps = 0;
+	//index file
+	char *indexfile = 0;
+	//print profiling summary
+	int profile_summary = 0;
+	//profiling trace file
+	char *tracefile = 0;
+	//profiler timer
+	nanotimer_t pt;
 
 	//s r b n
 	int c;
@@ -155,7 +254,7 @@ int main(int argc, char **argv) {
 	unsigned int v1, v2;
 	//parse command line arguments
 	//TODO: fix free of resources when invalid argument is specified
-	while ((c = getopt(argc, argv, "ha:s:b:n:c:f:o:p:rd:")) != -1) {
+	while ((c = getopt(argc, argv, "ha:s:b:n:c:f:o:p:rd:g:i:PT:")) != -1) {
 
 		switch (c) {
 
@@ -270,6 +369,31 @@ int main(int argc, char **argv) {
 
 				break;
 
+			case 'g':
+				//set inter-frame gaps and enable burst mode
+				free(gaps);
+				n_gaps = parse_gaps(optarg, &gaps);
+				if (n_gaps == -1) {
+					printf("Invalid inter-frame gaps %s\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 'i':
+				//set index file
+				copy_argument(&indexfile, optarg);
+				break;
+
+			case 'P':
+				//enable profiling summary
+				profile_summary = 1;
+				break;
+
+			case 'T':
+				//set profiling trace file
+				copy_argument(&tracefile, optarg);
+				break;
+
 			default:
 
 				return 0;
@@ -295,20 +419,35 @@ int main(int argc, char **argv) {
 		f = stdout;
 	}
 
-	//the size of these buffers does not depend on frame size. allocate them once
-	mod = fftw_alloc_complex(N_DATA_SUBCARRIERS);
-	pil = fftw_alloc_complex(N_TOTAL_SUBCARRIERS);
-	ifft = fftw_alloc_complex(FFT_SIZE);
-	time = fftw_alloc_complex(FFT_SIZE);
-	ext = fftw_alloc_complex(EXT_OFDM_SYMBOL_SIZE);
-	signal = fftw_alloc_complex(EXT_SIGNAL_SIZE);
-	short_sequence = fftw_alloc_complex(EXT_SHORT_TRAINING_SIZE);
-	long_sequence = fftw_alloc_complex(EXT_LONG_TRAINING_SIZE);
-
-	//moreover, preamble is always the same for every frame
-	//generate short and long training sequences
-	generate_short_training_sequence(short_sequence);
-	generate_long_training_sequence(long_sequence);
+	//gaps can be skipped instead of written only if we can seek on the output
+	int seekable = fseeko(f, 0, SEEK_CUR) == 0;
+
+	//init index file
+	FILE *index = 0;
+
+	if (indexfile) {
+		index = fopen(indexfile, "w");
+		if (!index) {
+			printf("Cannot open \"%s\" for write. Permission denied?\n", indexfile);
+			return 1;
+		}
+		fprintf(index, "#frame start_sample samples\n");
+	}
+
+	//first sample of the next frame on the output timeline
+	long long frame_start = 0;
+	//number of frames written so far
+	int n_frames = 0;
+
+	if (profile_summary || tracefile) {
+		//use the cheapest timer, if available. otherwise stay on CLOCK_MONOTONIC_RAW
+		set_timer_backend(TIMER_TSC);
+		profiler_enable(PROFILER_SUMMARY | (tracefile ? PROFILER_TRACE : 0));
+	}
+
+	//the size of encoding buffers does not depend on frame size, and the preamble
+	//is always the same for every frame. prepare them once
+	init_ofdm_frame_encoder(&encoder);
 
 	//set the fields for the mac frame that won't change
 	//data field
@@ -331,7 +470,7 @@ int main(int argc, char **argv) {
 	 * d data
 	 */
 	header = generate_mac_header(frame_control, duration, address1, address2, address3, sequence);
-	char to_from_ds;
+	char to_from_ds = 0;
 	set_bit(&to_from_ds, 0, get_frame_control_from_ds(header.frame_control, 0));
 	set_bit(&to_from_ds, 1, get_frame_control_to_ds(header.frame_control, 0));
 	fprintf(stderr, "Address1:\t\t");
@@ -350,6 +489,8 @@ int main(int argc, char **argv) {
 	fprintf(stderr, "Output file:\t\t%s\n", outfile ? outfile : "stdout");
 	fprintf(stderr, "Output format:\t\t%s\n", format == TEXT ? "textual" : "binary");
 	fprintf(stderr, "Repeat:\t\t\t%s\n", repeat ? "yes" : "no");
+	fprintf(stderr, "Burst mode:\t\t%s\n", n_gaps ? "yes" : "no");
+	fprintf(stderr, "Index file:\t\t%s\n", indexfile ? indexfile : "none");
 	fprintf(stderr, "Payload:\t\t%s\n", repeat || !payload ? "read from stdin" : payload);
 
 	//read the psdu from stdin
@@ -376,6 +517,8 @@ int main(int argc, char **argv) {
 
 		int rb = strlen(msdu);
 
+		profiler_frame_begin();
+
 		//generate custom mac header
 
 		header = generate_mac_header(frame_control, duration, address1, address2, address3, sequence);
@@ -383,86 +526,39 @@ int main(int argc, char **argv) {
 		//then generate the PSDU
 		generate_mac_data_frame(msdu, rb, header, &psdu, &psdu_length);
 
-		//swap the endianness of the psdu
-		change_array_endianness(psdu, psdu_length, psdu);
-		//generate the OFDM data field, adding service field and pad bits
-		generate_data_field(psdu, psdu_length, params.data_rate, &data, &len);
-
-		//get transmission params for the psdu
-		tx_params = get_tx_parameters(params.data_rate, psdu_length);
-
-		//alloc memory for modulation steps
-		scrambled_data = calloc(len, sizeof(char));
-		encoded_data = calloc(len * 2, sizeof(char));
-		punctured_data = calloc(tx_params.n_encoded_data_bytes, sizeof(char));
-		interleaved_data = calloc(tx_params.n_encoded_data_bytes, sizeof(char));
-
-		mod_samples = fftw_alloc_complex(FRAME_SIZE(tx_params.n_sym));
-		zero_samples(mod_samples, FRAME_SIZE(tx_params.n_sym));
+		//perform OFDM encoding
+		generate_ofdm_frame(&encoder, psdu, psdu_length, params.data_rate, &mod_samples, &n_samples);
 
-		//first step, scrambling
-		scramble_with_initial_state(data, scrambled_data, len, 0x5D);
-		//reset tail bits
-		reset_tail_bits(scrambled_data, len, tx_params.n_pad);
-		//encoding
-		convolutional_encoding(scrambled_data, encoded_data, len);
-		//puncturing
-		puncturing(encoded_data, punctured_data, len * 2, params.coding_rate);
-		//interleaving
-		interleave(punctured_data, interleaved_data, tx_params.n_encoded_data_bytes, params.n_cbps, params.n_bpsc);
+		pt = profiler_begin(STAGE_OUTPUT);
 
-		//now perform modulation for each symbol
-		for (symbol = 0; symbol < tx_params.n_sym; symbol++) {
-
-			modulate(&interleaved_data[symbol * params.n_cbps / 8], params.n_cbps / 8, params.data_rate, mod);
-
-			insert_pilots(mod, pil, symbol + 1);
-
-			map_ofdm_to_ifft(pil, ifft);
-
-			perform_ifft(ifft, time);
-			normalize_ifft_output(time, FFT_SIZE, FFT_SIZE);
-
-			add_cyclic_prefix(time, FFT_SIZE, ext, EXT_OFDM_SYMBOL_SIZE, CYCLIC_PREFIX_SIZE);
-			apply_window_function(ext, EXT_OFDM_SYMBOL_SIZE);
+		if (n_gaps && n_frames > 0) {
+			//in burst mode, separate this frame from the previous one
+			long long gap = gaps[(n_frames - 1) % n_gaps];
+			write_gap(f, format, seekable, gap, frame_start);
+			frame_start += gap;
+		}
 
-			sum_samples(mod_samples, ext, EXT_OFDM_SYMBOL_SIZE, (5 + symbol) * OFDM_SYMBOL_SIZE);
+		//outside burst mode, every frame starts from sample index 0
+		write_samples(f, format, mod_samples, n_samples, n_gaps ? frame_start : 0);
 
+		if (index) {
+			fprintf(index, "%d %lld %d\n", n_frames, frame_start, n_samples);
+			fflush(index);
 		}
 
-		//generate signal field and insert it into the frame
-		generate_signal_field(signal, params.data_rate, psdu_length);
-		sum_samples(mod_samples, signal, EXT_SIGNAL_SIZE, 4 * OFDM_SYMBOL_SIZE);
-
-		//insert preamble
-		sum_samples(mod_samples, short_sequence, EXT_SHORT_TRAINING_SIZE, 0);
-		sum_samples(mod_samples, long_sequence, EXT_LONG_TRAINING_SIZE, SHORT_TRAINING_SIZE);
-
-		int i;
-		for (i = 0; i < (5 + tx_params.n_sym) * OFDM_SYMBOL_SIZE + 1; i++) {
-
-			if (format == BIN) {
-				float val;
-				val = mod_samples[i][0];
-				fwrite(&val, sizeof(float), 1, f);
-				val = mod_samples[i][1];
-				fwrite(&val, sizeof(float), 1, f);
-			}
-			else {
-				fprintf(f, "%d %f %f\n", i, mod_samples[i][0], mod_samples[i][1]);
-			}
-		}
+		frame_start += n_samples;
+		n_frames++;
 
 		//flush the output file
 		fflush(f);
+		profiler_end(STAGE_OUTPUT, pt);
+
+		profiler_frame_end();
 
 		//these will be realloced at next cycle
 		free(psdu);
-		free(data);
-		free(scrambled_data);
-		free(encoded_data);
-		free(punctured_data);
-		free(interleaved_data);
+		fftw_free(mod_samples);
+		mod_samples = 0;
 
 		//increment the sequence number
 		sequence_number++;
@@ -471,21 +567,36 @@ int main(int argc, char **argv) {
 	while (repeat);
 
 	fclose(f);
+	if (index) {
+		fclose(index);
+	}
+
+	if (profile_summary) {
+		profiler_print_summary(stderr);
+	}
+	if (tracefile) {
+		FILE *trace = fopen(tracefile, "w");
+		if (trace) {
+			profiler_write_trace(trace);
+			fclose(trace);
+		}
+		else {
+			fprintf(stderr, "Cannot open \"%s\" for write. Permission denied?\n", tracefile);
+		}
+	}
+	profiler_reset();
+
 	free(outfile);
+	free(indexfile);
+	free(tracefile);
+	free(gaps);
 	free(address3);
 	free(address2);
 	free(address1);
 	free(payload);
 
-	fftw_free(mod);
-	fftw_free(pil);
-	fftw_free(ifft);
-	fftw_free(time);
-	fftw_free(ext);
-	fftw_free(signal);
 	fftw_free(mod_samples);
-	fftw_free(short_sequence);
-	fftw_free(long_sequence);
+	free_ofdm_frame_encoder(&encoder);
 
 	return 0;
 
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "recorder_utils.h"
+
+//samples read from the input at a time
+#define READ_SIZE 65536
+
+void usage(const char *argv0) {
+
+	/**
+	 * h help
+	 * f format (cf32/sc16)
+	 * i index file
+	 * p pre-trigger samples
+	 * P post-trigger samples
+	 * d decode
+	 * T threshold
+	 * b bypass the energy gate
+	 * c condition the samples
+	 */
+	printf("Usage %s: [-h] [-f format] [-i index file] [-p samples] [-P samples] [-d] [-T threshold] [-b] [-c]\n"
+	       "       output [input]\n\n"
+	       "\t-h\tPrint this help and exit\n\n"
+	       "\t-f\tFormat of the samples, i.e., \"cf32\" (single precision complex, as\n"
+	       "\t\twritten by mac_ofdm_framer in binary mode or by GNURadio) or \"sc16\"\n"
+	       "\t\t(complex 16 bit integers). By default, cf32 is used\n\n"
+	       "\t-i\tWrite the frame index of the recording to the given file. By\n"
+	       "\t\tconvention, the index is stored next to the recording, with the\n"
+	       "\t\t\"" FRAME_INDEX_EXTENSION "\" extension\n\n"
+	       "\t-p\tSamples recorded before each frame (pre-trigger). By default, %d\n\n"
+	       "\t-P\tSamples recorded after each frame (post-trigger). By default, %d\n\n"
+	       "\t-d\tDecode each frame, so that the index holds the FCS status of the\n"
+	       "\t\tframes. By default, only the SIGNAL field is decoded\n\n"
+	       "\t-T\tThreshold of the short training detector, between 0 and 1. By default,\n"
+	       "\t\t%.1f is used\n\n"
+	       "\t-b\tBypass the energy gate, running the detector on the whole stream instead\n"
+	       "\t\tof on the samples above the noise floor only\n\n"
+	       "\t-c\tRemove the DC offset and the IQ imbalance, and normalize the level of the\n"
+	       "\t\tsamples given to the detector, e.g., for the captures of radios with a\n"
+	       "\t\tstrong DC spike. The recorded samples are not changed\n\n"
+	       "The samples are read from the input file, or from stdin if it is not given\n"
+	       "(e.g., from a pipe fed by an SDR). Only the frames, with their pre-trigger and\n"
+	       "post-trigger samples, are written to the output file, in the same format. A\n"
+	       "summary is printed on stderr\n", argv0, RECORDER_DEFAULT_PRE_TRIGGER, RECORDER_DEFAULT_POST_TRIGGER,
+	       RX_SHORT_THRESHOLD);
+
+}
+
+/**
+ * Parses a number of pre-trigger or post-trigger samples, returning -1 if
+ * it is not valid
+ */
+int parse_margin(const char *s) {
+	int margin = atoi(s);
+	if (margin < 0 || margin > RECORDER_MAX_MARGIN) {
+		fprintf(stderr, "The number of samples before and after a frame must be between 0 and %d\n",
+		        RECORDER_MAX_MARGIN);
+		return -1;
+	}
+	return margin;
+}
+
+int main(int argc, char **argv) {
+
+	struct TRIGGERED_RECORDER r;
+	enum CAPTURE_FORMAT format = CAPTURE_CF32;
+	const char *indexfile = NULL;
+	FILE *in;
+	unsigned char *samples;
+	size_t sample_size;
+	int pre_trigger = RECORDER_DEFAULT_PRE_TRIGGER, post_trigger = RECORDER_DEFAULT_POST_TRIGGER, decode = 0, bypass = 0;
+	int condition = 0, n, err, c;
+	double threshold = RX_SHORT_THRESHOLD;
+
+	while ((c = getopt(argc, argv, "hf:i:p:P:dT:bc")) != -1) {
+
+		switch (c) {
+
+			case 'h':
+				usage(argv[0]);
+				return 0;
+
+			case 'f':
+				if (strcmp(optarg, STR_CAPTURE_FORMAT[CAPTURE_CF32]) == 0) {
+					format = CAPTURE_CF32;
+				}
+				else if (strcmp(optarg, STR_CAPTURE_FORMAT[CAPTURE_SC16]) == 0) {
+					format = CAPTURE_SC16;
+				}
+				else {
+					fprintf(stderr, "Invalid format \"%s\"\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 'i':
+				indexfile = optarg;
+				break;
+
+			case 'p':
+				pre_trigger = parse_margin(optarg);
+				if (pre_trigger < 0) {
+					return 1;
+				}
+				break;
+
+			case 'P':
+				post_trigger = parse_margin(optarg);
+				if (post_trigger < 0) {
+					return 1;
+				}
+				break;
+
+			case 'd':
+				decode = 1;
+				break;
+
+			case 'T':
+				threshold = atof(optarg);
+				break;
+
+			case 'b':
+				bypass = 1;
+				break;
+
+			case 'c':
+				condition = 1;
+				break;
+
+			default:
+				usage(argv[0]);
+				return 1;
+
+		}
+
+	}
+
+	if (optind != argc - 1 && optind != argc - 2) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	in = stdin;
+	if (optind == argc - 2) {
+		in = fopen(argv[optind + 1], "rb");
+		if (in == NULL) {
+			fprintf(stderr, "Cannot read file \"%s\"\n", argv[optind + 1]);
+			return 1;
+		}
+	}
+
+	err = init_triggered_recorder(&r, format, argv[optind], indexfile);
+	if (err != 0) {
+		fprintf(stderr, "Cannot write \"%s\". Permission denied?\n",
+		        err == ERR_INDEX_CANNOT_WRITE ? indexfile : argv[optind]);
+		return 1;
+	}
+	r.threshold = threshold;
+	r.pre_trigger = pre_trigger;
+	r.post_trigger = post_trigger;
+	r.decode = decode;
+	r.gate.bypass = bypass;
+	r.condition = condition;
+
+	sample_size = r.sample_size;
+	samples = (unsigned char *)malloc(sample_size * READ_SIZE);
+	err = 0;
+	while (err >= 0 && (n = fread(samples, sample_size, READ_SIZE, in)) > 0) {
+		err = push_recorder_samples(&r, samples, n);
+	}
+	if (err < 0) {
+		fprintf(stderr, "Cannot write the recording. Disk full?\n");
+	}
+	fprintf(stderr, "%lld samples, %lld frames, %lld samples written (%.2f%%), %lld detections dropped\n",
+	        r.n_samples, r.n_frames, r.n_written, r.n_samples > 0 ? 100.0 * r.n_written / r.n_samples : 0,
+	        r.n_dropped);
+	fprintf(stderr, "%.1f%% of the stream through the detector\n",
+	        r.gate.n_blocks > 0 ? 100.0 * r.gate.n_open / r.gate.n_blocks : 0);
+
+	free(samples);
+	free_triggered_recorder(&r);
+	if (in != stdin) {
+		fclose(in);
+	}
+
+	return err < 0;
+
+}
@@ -176,6 +176,27 @@ int read_bits_from_file(const char *filename, char *bytes, int size);
  */
 int read_hex_from_file(const char *filename, char *bytes, int size);
 
+/**
+ * Read complex time samples from a file, in the textual format produced by
+ * mac_ofdm_framer and by print_complex_array(), i.e., one sample per line
+ * made by the index of the sample, the real and the imaginary part.
+ * The file can also contain comments, determined by a # at the
+ * beginning of the line. For example:
+ *
+ * #this is a sample complex file
+ * 0 0.023 0.023
+ * 1 -0.132 0.002
+ *
+ * is a valid complex file. The function will read 2 samples
+ *
+ * \param filename the file to read
+ * \param samples array where to store the read samples
+ * \param size maximum number of samples to read
+ * \return the number of samples read, or a negative value in case
+ * of an error
+ */
+int read_complex_from_file(const char *filename, fftw_complex *samples, int size);
+
 /**
  * Return the integer value of a group of bits inside a bit
  * string. For example, if input is byte=01011100 and the value
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: memory mapped access to raw sample captures
+ *
+ */
+
+#ifndef _CAPTURE_UTILS_H_
+#define _CAPTURE_UTILS_H_
+
+#include <stddef.h>
+
+#include <fftw3.h>
+
+#include "detector_utils.h"
+
+/**
+ * Formats of the samples of a raw capture file, i.e., a file containing the
+ * samples only, one after the other, in the byte order of the host
+ */
+enum CAPTURE_FORMAT {
+    //sample_cf32_t, as written by mac_ofdm_framer and GNURadio
+    CAPTURE_CF32,
+    //sample_sc16_t
+    CAPTURE_SC16
+};
+static const char* STR_CAPTURE_FORMAT[] = {
+	"cf32",
+	"sc16"
+};
+
+/**
+ * A capture is scanned for preambles in chunks of samples, each one by a
+ * single thread with its own short training detector. Every chunk starts
+ * CAPTURE_OVERLAP samples before the beginning of the samples it is
+ * responsible for, so that the detector has the same state as if it had
+ * been running since the beginning of the capture: the overlap is longer
+ * than a preamble and the hold-off of the detector, and it is a multiple of
+ * SC_RESYNC_INTERVAL, so that the running sums are recomputed at the same
+ * samples. A chunk also goes past its end by CAPTURE_LOOKAHEAD samples, so
+ * that a preamble starting at the end of the chunk generates its event
+ * there. CAPTURE_CHUNK_SIZE is a size suitable for large captures, and
+ * CAPTURE_CHUNK_SIZE_MAX the largest size accepted
+ */
+#define CAPTURE_OVERLAP         SC_RESYNC_INTERVAL
+#define CAPTURE_LOOKAHEAD       (SC_WINDOW + SC_DELAY)
+#define CAPTURE_CHUNK_SIZE      (1 << 22)
+#define CAPTURE_CHUNK_SIZE_MAX  (1 << 30)
+#define CAPTURE_MAX_THREADS     64
+//number of samples given to the detector at once
+#define CAPTURE_BLOCK_SIZE      4096
+
+//errors returned for an invalid number of threads or size of the chunks
+#define ERR_CAPTURE_THREADS     -3
+#define ERR_CAPTURE_CHUNK_SIZE  -4
+
+/**
+ * A capture file mapped into memory. The file is never read explicitly: the
+ * operating system loads its pages when the samples are accessed, so
+ * captures larger than the memory can be used
+ */
+struct CAPTURE {
+	int fd;
+	//the mapped file, NULL for an empty file
+	const void *data;
+	size_t size;
+	enum CAPTURE_FORMAT format;
+	long long n_samples;
+};
+
+/**
+ * Maps a capture file into memory
+ *
+ * \param c the capture
+ * \param filename path of the file
+ * \param format format of the samples
+ * \return 0 on success, ERR_CANNOT_READ_FILE if the file cannot be opened or
+ * mapped, or ERR_INVALID_FORMAT if its size is not a multiple of the size of
+ * a sample
+ */
+int open_capture(struct CAPTURE *c, const char *filename, enum CAPTURE_FORMAT format);
+
+/**
+ * Unmaps and closes a capture file
+ *
+ * \param c the capture
+ */
+void close_capture(struct CAPTURE *c);
+
+/**
+ * Copies samples of a capture into a double precision array, e.g., to decode
+ * a frame. sc16 samples are scaled so that full scale is 1
+ *
+ * \param c the capture
+ * \param offset index of the first sample to read
+ * \param size number of samples to read
+ * \param samples output array
+ * \return the number of samples read, which is less than size at the end of
+ * the capture
+ */
+int read_capture_samples(const struct CAPTURE *c, long long offset, int size, fftw_complex *samples);
+
+/**
+ * Runs the short training detector on a whole capture. The capture is split
+ * into chunks, which are scanned in parallel, and the events of the chunks
+ * are merged in sample order. sc16 captures are scanned in fixed point,
+ * without converting the samples. The result is the same as running
+ * detect_short_training_events_f() (for cf32 captures) or
+ * detect_short_training_events_s16() (for sc16 captures) over the whole
+ * capture, whatever the number of threads and the size of the chunks, unless
+ * the metric stays above the re-arm level for more than CAPTURE_OVERLAP
+ * samples (e.g., with an unmodulated carrier). Even then, events closer than
+ * SC_HOLDOFF samples to the previous one are dropped at chunk boundaries, as
+ * a single detector would do
+ *
+ * \param c the capture
+ * \param n_threads number of threads, up to CAPTURE_MAX_THREADS. With 0 or 1,
+ * the capture is scanned by the calling thread
+ * \param chunk_size number of samples of each chunk, e.g.,
+ * CAPTURE_CHUNK_SIZE, at least 1 and at most CAPTURE_CHUNK_SIZE_MAX. It is
+ * rounded up to a multiple of SC_RESYNC_INTERVAL
+ * \param threshold threshold on the timing metric, between 0 and 1
+ * \param events where to store the array of events, allocated by the
+ * function with malloc(). The index of each event is the estimated beginning
+ * of the short training sequence, counted from the beginning of the capture
+ * \return the number of events, or ERR_CAPTURE_THREADS if n_threads is out
+ * of range or ERR_CAPTURE_CHUNK_SIZE if chunk_size is, in which case no array
+ * is allocated
+ */
+long long scan_capture(const struct CAPTURE *c, int n_threads, int chunk_size, double threshold,
+                       struct DETECTION_EVENT **events);
+
+#endif
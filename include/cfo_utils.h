@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: carrier frequency offset estimation and correction
+ *
+ */
+
+#ifndef _CFO_UTILS_H_
+#define _CFO_UTILS_H_
+
+#include <fftw3.h>
+
+#include "detector_utils.h"
+
+/**
+ * A carrier frequency offset rotates the received samples by a constant
+ * angle per sample, so the offset is measured from the phase of the
+ * correlation between repeated parts of the preamble. Offsets are expressed
+ * in radians per sample: with a sampling frequency fs, an offset of w
+ * rad/sample is w * fs / (2 pi) Hz.
+ *
+ * The short training symbol repeats every CFO_SHORT_DELAY samples, so the
+ * coarse estimate is unambiguous within +-pi / CFO_SHORT_DELAY (+-625 kHz at
+ * 20 MHz). The two long training symbols are CFO_LONG_DELAY samples apart,
+ * so the fine estimate is more accurate, but only unambiguous within
+ * +-pi / CFO_LONG_DELAY: it must be computed after correcting the coarse one
+ */
+#define CFO_SHORT_DELAY         16
+#define CFO_LONG_DELAY          64
+
+/**
+ * Samples derotated with the same block of rotations by the NCO. The
+ * rotations of a block are obtained from a table computed once, so only one
+ * sine and one cosine are evaluated per block
+ */
+#define NCO_BLOCK               64
+
+/**
+ * Numerically controlled oscillator, which removes a carrier frequency
+ * offset by rotating the samples by -(phase + frequency * n). The state is
+ * kept between calls, so samples can be given in chunks of any size. No
+ * memory is allocated
+ */
+struct NCO {
+	//rotation of each sample of a block, relative to the first one
+	double table_re[NCO_BLOCK];
+	double table_im[NCO_BLOCK];
+	//rotation of each sample of the current block
+	double rotation_re[NCO_BLOCK];
+	double rotation_im[NCO_BLOCK];
+	//frequency (rad/sample), and phase of the first sample of the current block
+	double frequency;
+	double phase;
+	//position of the next sample within the current block
+	int offset;
+};
+
+/**
+ * Estimates the carrier frequency offset from the short training sequence,
+ * by correlating each sample with the one received CFO_SHORT_DELAY samples
+ * before
+ *
+ * \param samples samples of the short training sequence
+ * \param size number of samples. Must be greater than CFO_SHORT_DELAY
+ * \return the offset in rad/sample
+ */
+double estimate_coarse_cfo(const fftw_complex *samples, int size);
+
+/**
+ * Returns the coarse carrier frequency offset from the running sums of a
+ * short training detector, which correlates samples with the same delay of
+ * estimate_coarse_cfo(). This costs no additional work per sample, but the
+ * estimate is meaningful only while the window of the detector (the last
+ * SC_WINDOW + SC_DELAY samples) lies within the short training sequence,
+ * e.g., right after a detection event
+ *
+ * \param d the detector
+ * \return the offset in rad/sample
+ */
+double get_short_training_cfo(const struct SHORT_TRAINING_DETECTOR *d);
+
+/**
+ * Estimates the residual carrier frequency offset from the two long training
+ * symbols, after the coarse offset has been corrected
+ *
+ * \param samples the 2 * CFO_LONG_DELAY samples of the two long training
+ * symbols, i.e., the long training sequence without its 32 samples prefix
+ * \return the offset in rad/sample
+ */
+double estimate_fine_cfo(const fftw_complex *samples);
+
+/**
+ * Initializes an NCO
+ *
+ * \param nco the NCO
+ * \param frequency the offset to be removed, in rad/sample
+ */
+void init_nco(struct NCO *nco, double frequency);
+
+/**
+ * Changes the frequency of an NCO from the next sample on, keeping the phase
+ * continuous
+ *
+ * \param nco the NCO
+ * \param frequency the offset to be removed, in rad/sample
+ */
+void set_nco_frequency(struct NCO *nco, double frequency);
+
+/**
+ * Removes the carrier frequency offset from a chunk of samples. On x86 cpus
+ * supporting AVX2, a version vectorized with 256 bit instructions is used
+ *
+ * \param nco the NCO
+ * \param in input samples
+ * \param out output samples. Can be the same array of in
+ * \param size number of samples
+ */
+void derotate(struct NCO *nco, const fftw_complex *in, fftw_complex *out, int size);
+
+#endif
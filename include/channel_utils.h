@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: channel estimation and equalization from the long training sequence
+ *
+ */
+
+#ifndef _CHANNEL_UTILS_H_
+#define _CHANNEL_UTILS_H_
+
+#include <fftw3.h>
+
+#include "ofdm_utils.h"
+
+//number of used subcarriers (data and pilots)
+#define N_USED_SUBCARRIERS      (N_DATA_SUBCARRIERS + N_PILOT_SUBCARRIERS)
+//index of the DC subcarrier, in arrays of N_TOTAL_SUBCARRIERS from -26 to 26
+#define DC_SUBCARRIER           26
+//signal to noise ratio (dB) reported when no noise can be measured
+#define CHANNEL_MAX_SNR         100.0
+
+/**
+ * OFDM demodulator, i.e., the FFT of the receiver. The plan is created once
+ * and reused for every symbol
+ */
+struct OFDM_DEMODULATOR {
+	//cached FFTW plan
+	fftw_plan fft;
+	//time samples and spectrum of the symbol
+	fftw_complex *in, *out;
+};
+
+/**
+ * Channel estimate of a frame, computed from its two long training symbols.
+ * Arrays of N_TOTAL_SUBCARRIERS elements go from subcarrier -26 to 26, like
+ * the output of insert_pilots()
+ */
+struct CHANNEL_ESTIMATE {
+	//channel response on each subcarrier. The DC subcarrier is 0
+	fftw_complex h[N_TOTAL_SUBCARRIERS];
+	//one-tap equalizer, i.e., 1 / h, stored as separate real and imaginary
+	//parts so that equalize_symbol() can be vectorized. The DC subcarrier is 0
+	double eq_re[N_TOTAL_SUBCARRIERS];
+	double eq_im[N_TOTAL_SUBCARRIERS];
+	//squared magnitude of the channel on the data subcarriers, normalized to
+	//a mean of 1 over the used subcarriers, as taken by demap_soft()
+	double data_gain[N_DATA_SUBCARRIERS];
+	//mean power of the channel response and of the noise on a subcarrier
+	double signal_power;
+	double noise_power;
+	//signal to noise ratio in dB
+	double snr;
+};
+
+/**
+ * Initializes an OFDM demodulator, allocating its buffers and creating the
+ * FFTW plan. Since FFTW planning is not thread safe, this function should
+ * not be called concurrently from several threads
+ *
+ * \param d the demodulator
+ */
+void init_ofdm_demodulator(struct OFDM_DEMODULATOR *d);
+
+/**
+ * Frees buffers and plan of an OFDM demodulator
+ *
+ * \param d the demodulator
+ */
+void free_ofdm_demodulator(struct OFDM_DEMODULATOR *d);
+
+/**
+ * Demodulates an OFDM symbol, i.e., the inverse of map_ofdm_to_ifft() and
+ * perform_ifft(), including the normalization done by the transmitter
+ *
+ * \param d the demodulator
+ * \param samples the FFT_SIZE time samples of the symbol, without the cyclic
+ * prefix
+ * \param out the N_TOTAL_SUBCARRIERS subcarriers of the symbol, from -26 to 26
+ */
+void demodulate_symbol(struct OFDM_DEMODULATOR *d, const fftw_complex *samples, fftw_complex *out);
+
+/**
+ * Estimates the channel from the two long training symbols of a frame. The
+ * estimate of each subcarrier is the average of the two symbols, which can
+ * be further averaged over neighbouring subcarriers for channels whose
+ * response changes slowly with frequency. The noise is estimated from the
+ * difference between the two symbols, which makes the SNR estimate
+ * independent of the level of the signal
+ *
+ * \param d the demodulator
+ * \param samples the 2 * FFT_SIZE time samples of the two long training
+ * symbols, i.e., the long training sequence without its 32 samples prefix
+ * \param smoothing number of subcarriers on each side averaged with each
+ * subcarrier. 0 disables smoothing. Averaging is done over used subcarriers
+ * only, and the window is truncated at the edges of the band
+ * \param ch the estimate
+ */
+void estimate_channel(struct OFDM_DEMODULATOR *d, const fftw_complex *samples, int smoothing,
+                      struct CHANNEL_ESTIMATE *ch);
+
+/**
+ * Equalizes the subcarriers of a symbol with the one-tap equalizer of the
+ * channel estimate
+ *
+ * \param ch the channel estimate
+ * \param in the N_TOTAL_SUBCARRIERS subcarriers of the symbol, as given by
+ * demodulate_symbol()
+ * \param out the equalized subcarriers. Can be the same array of in
+ */
+void equalize_symbol(const struct CHANNEL_ESTIMATE *ch, const fftw_complex *in, fftw_complex *out);
+
+/**
+ * Equalizes the subcarriers of a symbol like equalize_symbol(), and also
+ * removes the phase error common to all subcarriers (e.g., left by a
+ * residual frequency offset, which builds up over long frames) and,
+ * optionally, the phase error growing linearly with the subcarrier index
+ * (e.g., due to a sampling clock offset). Both are estimated from the four
+ * pilots, after removing their polarity, and folded into the coefficients of
+ * the equalizer, so the subcarriers are swept only once
+ *
+ * \param ch the channel estimate
+ * \param in the N_TOTAL_SUBCARRIERS subcarriers of the symbol, as given by
+ * demodulate_symbol()
+ * \param symbol_index index of the symbol within the frame, as given to
+ * insert_pilots(): 0 for the SIGNAL field, 1 for the first DATA symbol
+ * \param track_slope if not 0, the slope of the phase error is estimated and
+ * removed as well
+ * \param out the equalized subcarriers. Can be the same array of in
+ * \param phase if not NULL, where to store the common phase error (rad)
+ * \param slope if not NULL, where to store the slope of the phase error (rad
+ * per subcarrier). It is 0 if track_slope is 0
+ */
+void equalize_symbol_with_pilots(const struct CHANNEL_ESTIMATE *ch, const fftw_complex *in, int symbol_index,
+                                 int track_slope, fftw_complex *out, double *phase, double *slope);
+
+/**
+ * Splits the subcarriers of a symbol into data and pilots, i.e., the inverse
+ * of insert_pilots(). Pilot polarity is not removed
+ *
+ * \param in the N_TOTAL_SUBCARRIERS subcarriers of the symbol
+ * \param data array where to store the N_DATA_SUBCARRIERS data subcarriers
+ * \param pilots array where to store the N_PILOT_SUBCARRIERS pilots, from -21
+ * to 21. Can be NULL
+ */
+void extract_data_subcarriers(const fftw_complex *in, fftw_complex *data, fftw_complex *pilots);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: conditioning of the received samples before detection
+ *
+ */
+
+#ifndef _CONDITIONING_UTILS_H_
+#define _CONDITIONING_UTILS_H_
+
+#include "detector_utils.h"
+
+/**
+ * The conditioner removes the impairments of the radio front end that bias
+ * the detectors: the DC offset, which correlates with itself at any delay
+ * and so drives the timing metric of the short training detector towards 1
+ * on noise, the IQ imbalance, and the arbitrary level of the capture.
+ *
+ * The samples are corrected with estimates that change only at the
+ * boundaries of blocks of COND_BLOCK samples (counted from the first
+ * sample), so the correction of a block is a branchless loop that the
+ * compiler can vectorize. The statistics of a block are summed into
+ * COND_LANES partial sums, and update the estimates applied to the next
+ * blocks:
+ * - DC offset: mean of the samples, smoothed by a first order IIR filter
+ *   with coefficient COND_DC_RATE per block (a DC blocker with a time
+ *   constant of COND_BLOCK / COND_DC_RATE samples)
+ * - IQ imbalance: blind estimation from the powers of the I and Q branches
+ *   and their correlation, smoothed with coefficient COND_IQ_RATE. Since the
+ *   received signal is circular, the two branches are made orthogonal and of
+ *   the same power, i.e., Q is replaced by a Q + b I
+ * - level: mean power after the corrections, smoothed with coefficient
+ *   COND_AGC_RATE (after the mean of the first 1 / COND_AGC_RATE blocks),
+ *   which sets the gain so that the output has the target power. The time
+ *   constant, COND_BLOCK / COND_AGC_RATE samples (6.6 ms at 20 Msamples/s),
+ *   is longer than the longest frame, so the gain follows the level of the
+ *   capture and not the single frames. Still, a frame of T samples with P
+ *   times the power of the capture raises the level by a fraction of about
+ *   (P - 1) T COND_AGC_RATE / COND_BLOCK, and lowers the gain by half of it
+ * Results do not depend on the size of the chunks the samples are given in
+ */
+#define COND_BLOCK                  64
+#define COND_LANES                  8
+#define COND_DC_RATE                (1.0f / 64)
+#define COND_IQ_RATE                (1.0f / 256)
+#define COND_AGC_RATE               (1.0f / 2048)
+#define COND_DEFAULT_AGC_TARGET     1.0f
+
+/**
+ * State of a conditioner. No memory is allocated
+ */
+struct SIGNAL_CONDITIONER {
+	//settings, which can be changed at any time: whether each stage is
+	//enabled, and target power of the AGC
+	int dc, iq, agc;
+	float agc_target;
+
+	//corrections applied to the current block: DC offset, coefficients of
+	//the IQ correction, and gain
+	float dc_re, dc_im;
+	float iq_a, iq_b;
+	float gain;
+	//smoothed statistics: mean, powers and correlation of the I and Q
+	//branches, and power after the corrections
+	float mean_re, mean_im;
+	float p_ii, p_qq, p_iq;
+	float level;
+	//partial sums of the current block
+	float sum_re[COND_LANES], sum_im[COND_LANES];
+	float sum_ii[COND_LANES], sum_qq[COND_LANES], sum_iq[COND_LANES];
+	float sum_p[COND_LANES];
+	//position within the current block, and blocks processed
+	int fill;
+	unsigned long long n_blocks;
+};
+
+/**
+ * Initializes a conditioner, with all the stages enabled. Until the end of
+ * the first block, samples go through unchanged
+ *
+ * \param c the conditioner
+ */
+void init_signal_conditioner(struct SIGNAL_CONDITIONER *c);
+
+/**
+ * Conditions a chunk of samples. On x86 cpus supporting AVX2, a version
+ * vectorized with 256 bit instructions is used
+ *
+ * \param c the conditioner
+ * \param in input samples
+ * \param out output samples. Can be the same array of in
+ * \param size number of samples
+ */
+void condition_samples(struct SIGNAL_CONDITIONER *c, const sample_cf32_t *in, sample_cf32_t *out, int size);
+
+/**
+ * Returns the image rejection ratio left by the IQ imbalance of the given
+ * samples, i.e., the ratio between the power of the signal and the power of
+ * its mirror image, which is infinite for circular samples without
+ * imbalance. It is meant to check the IQ correction
+ *
+ * \param samples the samples
+ * \param size number of samples
+ * \return the image rejection ratio, in dB
+ */
+double measure_image_rejection(const sample_cf32_t *samples, int size);
+
+#endif
@@ -0,0 +1,571 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: streaming frame detectors for the receive chain
+ *
+ */
+
+#ifndef _DETECTOR_UTILS_H_
+#define _DETECTOR_UTILS_H_
+
+#include <fftw3.h>
+
+/**
+ * Single precision complex sample, with the same layout of fftw_complex
+ * (real part first). This is the format of the binary samples written by
+ * mac_ofdm_framer and used by GNURadio (gr_complex)
+ */
+typedef float sample_cf32_t[2];
+
+/**
+ * Complex sample made of two 16 bit integers (real part first), as delivered
+ * by most software defined radios. Full scale is 32768
+ */
+typedef short sample_sc16_t[2];
+
+/**
+ * Parameters of the Schmidl-Cox short training detector. The short training
+ * symbol repeats every 16 samples, so each sample is correlated with the one
+ * received 16 samples before. Products are summed over a window of 32 samples,
+ * i.e., two short symbols
+ */
+#define SC_DELAY            16
+#define SC_WINDOW           32
+/**
+ * Number of samples after which the running sums are recomputed from scratch,
+ * to get rid of the rounding errors accumulated by adding and removing terms
+ * (must be a power of two)
+ */
+#define SC_RESYNC_INTERVAL  1024
+/**
+ * After a detection event, the short training detector is re-armed only when
+ * the metric falls below SC_HYSTERESIS times the threshold, and not before
+ * SC_HOLDOFF samples, i.e., the length of the whole preamble
+ */
+#define SC_HYSTERESIS       0.5
+#define SC_HOLDOFF          320
+
+/**
+ * Parameters of the energy gate in front of the short training detector. The
+ * stream is divided into blocks of EG_BLOCK samples, and the detector only
+ * runs on the blocks whose mean power exceeds EG_MARGIN times the noise floor.
+ * The noise floor is the minimum block power over the last EG_FLOOR_WINDOWS
+ * windows of EG_FLOOR_BLOCKS blocks each, i.e., 131072 samples, which is
+ * longer than the longest frame
+ */
+#define EG_BLOCK            64
+#define EG_FLOOR_BLOCKS     64
+#define EG_FLOOR_WINDOWS    32
+#define EG_MARGIN           4.0
+/**
+ * Samples that restore the state of the short training detector when the
+ * gate opens, i.e., the span of the window of the timing metric
+ */
+#define EG_PRIME            (SC_WINDOW + SC_DELAY)
+
+/**
+ * Parameters of the fixed point detectors, which work on sc16 samples. The
+ * short training detector processes up to SC16_BLOCK samples at a time, and
+ * keeps the last SC16_HISTORY of them, i.e., the span of the window of the
+ * timing metric. Its sums are exact 64 bit integers, so they never need to
+ * be recomputed. The square root of the threshold is quantized to
+ * SC16_THRESHOLD_BITS fractional bits for the integer check of the metric
+ */
+#define SC16_BLOCK              256
+#define SC16_HISTORY            (SC_WINDOW + SC_DELAY)
+#define SC16_THRESHOLD_BITS     16
+/**
+ * The long training symbol is quantized with this scale, so that the sum of
+ * LT_SIZE products with full scale samples fits in 32 bits
+ */
+#define LT16_SCALE              2048
+
+/**
+ * Implementations of the fixed point detectors. All of them give exactly the
+ * same results
+ */
+enum DETECTOR_BACKEND {
+    DETECTOR_SCALAR,
+    //4 samples, i.e., 8 16 bit lanes, per instruction
+    DETECTOR_SSE2,
+    //8 samples, i.e., 16 16 bit lanes, per instruction
+    DETECTOR_AVX2
+};
+static const char* STR_DETECTOR_BACKEND[] = {
+	"scalar",
+	"sse2",
+	"avx2"
+};
+
+//error returned when the requested backend is not supported by the cpu
+#define ERR_DETECTOR_NOT_SUPPORTED -1
+
+/**
+ * Size of the long training symbol, which is the matched filter of the long
+ * training detector
+ */
+#define LT_SIZE             64
+/**
+ * Size of the FFTs used by the long training correlator. Each block produces
+ * LT_FFT_SIZE - LT_SIZE + 1 new correlation values
+ */
+#define LT_FFT_SIZE         1024
+
+/**
+ * A detection event
+ */
+struct DETECTION_EVENT {
+	//absolute index of the first sample of the window that generated the
+	//event, counted from the initialization of the detector. might be negative
+	//for events right after the initialization
+	long long sample;
+	//sub-sample refinement of the index, between -0.5 and 0.5. only computed
+	//by the long training correlator, 0 otherwise
+	double offset;
+	//value of the metric
+	double metric;
+};
+
+/**
+ * State of a streaming Schmidl-Cox short training detector. For every new
+ * sample r(n), the detector updates the running sums
+ *
+ * P(n) = sum_{k=0}^{SC_WINDOW-1} r(n-k) r*(n-k-SC_DELAY)
+ * R(n) = sum_{k=0}^{SC_WINDOW-1} |r(n-k)|^2
+ * R_D(n) = sum_{k=0}^{SC_WINDOW-1} |r(n-k-SC_DELAY)|^2
+ *
+ * by adding the newest term and removing the oldest one, so the cost per
+ * sample is constant. The timing metric is M(n) = |P(n)|^2 / (R(n) R_D(n)),
+ * which is between 0 and 1, close to 1 within the short training sequence
+ * and close to 0 for noise. Normalizing by the energy of both the windows,
+ * instead of by R(n)^2 only, avoids false triggers at the end of a frame,
+ * where the delayed window still contains the signal.
+ * The state is kept between calls, so samples can be given in chunks of any
+ * size. No memory is allocated
+ */
+struct SHORT_TRAINING_DETECTOR {
+	//last SC_DELAY samples
+	fftw_complex history[SC_DELAY];
+	//last SC_WINDOW delayed products, energies and delayed energies
+	fftw_complex products[SC_WINDOW];
+	double energies[SC_WINDOW];
+	double delayed_energies[SC_WINDOW];
+	//running sums
+	fftw_complex p;
+	double r, rd;
+	//number of samples processed so far
+	unsigned long long n;
+	//whether the metric is above threshold since the last event
+	int triggered;
+	//the detector cannot generate events until this sample
+	long long rearm;
+};
+
+/**
+ * Single precision version of SHORT_TRAINING_DETECTOR
+ */
+struct SHORT_TRAINING_DETECTOR_F {
+	//last SC_DELAY samples
+	sample_cf32_t history[SC_DELAY];
+	//last SC_WINDOW delayed products, energies and delayed energies
+	sample_cf32_t products[SC_WINDOW];
+	float energies[SC_WINDOW];
+	float delayed_energies[SC_WINDOW];
+	//running sums
+	sample_cf32_t p;
+	float r, rd;
+	//number of samples processed so far
+	unsigned long long n;
+	//whether the metric is above threshold since the last event
+	int triggered;
+	//the detector cannot generate events until this sample
+	long long rearm;
+};
+
+/**
+ * Fixed point version of SHORT_TRAINING_DETECTOR_F, for sc16 samples as
+ * delivered by the radio. The delayed products and the energies of a block
+ * are computed with 16 bit SIMD multiply-add instructions, which give exact
+ * 32 bit results (samples at -32768 are taken as -32767, so that the sum of
+ * two products cannot overflow). The running sums are updated sample by
+ * sample in 64 bit integers. Since |P(n)|^2 > t R(n) R_D(n) requires
+ * |Re P(n)| + |Im P(n)| > sqrt(t) min(R(n), R_D(n)), this bound is checked
+ * first, in integers, and rejects the noise. Only the candidates that pass
+ * it are promoted to floating point, to compare the metric with the
+ * threshold t. No memory is allocated
+ */
+struct SHORT_TRAINING_DETECTOR_S16 {
+	//last SC16_HISTORY samples, followed by the block being processed, and
+	//their delayed products and energies
+	sample_sc16_t samples[SC16_HISTORY + SC16_BLOCK];
+	int products[SC16_HISTORY + SC16_BLOCK][2];
+	int energies[SC16_HISTORY + SC16_BLOCK];
+	//running sums
+	long long p[2];
+	long long r, rd;
+	//number of samples processed so far
+	unsigned long long n;
+	//whether the metric is above threshold since the last event
+	int triggered;
+	//the detector cannot generate events until this sample
+	long long rearm;
+};
+
+/**
+ * State of an energy gate. Most of the time a receiver sees noise only, and
+ * computing the timing metric for every sample is wasted. The gate measures
+ * the power of each block of EG_BLOCK samples, which costs much less than the
+ * metric, and gives the block to the short training detector only if its
+ * power exceeds the noise floor by the margin. The noise floor is tracked
+ * with minimum statistics, so it adapts to changes of the noise level (e.g.,
+ * of the gain of the radio) without being raised by the frames. Since the
+ * minimum is biased low, a margin of EG_MARGIN opens the gate for frames a
+ * couple of dB above the noise, where the timing metric is far below
+ * threshold anyway.
+ * When the gate opens after closed blocks, the running sums of the detector
+ * are rebuilt from the last EG_PRIME samples, so the metric is the same as
+ * without gate. Samples are collected until a block is complete, so events
+ * are reported with a delay of up to one block, and the last samples of a
+ * stream that do not fill a block are not processed. In bypass mode all
+ * the blocks are given to the detector, so that the detection probability
+ * can be compared with and without gate. No memory is allocated
+ */
+struct ENERGY_GATE {
+	//settings, which can be changed at any time. margin on the noise floor,
+	//and whether all the blocks are given to the detector
+	float margin;
+	int bypass;
+
+	//last EG_PRIME samples of the previous block, followed by the block
+	//being collected
+	sample_cf32_t samples[EG_PRIME + EG_BLOCK];
+	int fill;
+	//whether the previous block has been given to the detector
+	int was_open;
+	//minimum block power within each window, window being filled and its
+	//number of blocks, and noise floor
+	float minima[EG_FLOOR_WINDOWS];
+	int window, window_blocks;
+	float floor;
+	//statistics: blocks processed, and blocks given to the detector
+	unsigned long long n_blocks, n_open;
+};
+
+/**
+ * State of a streaming long training detector. Each window of LT_SIZE samples
+ * is correlated with the long training symbol, and the metric is
+ *
+ * M(n) = |sum_{k=0}^{LT_SIZE-1} r(n-LT_SIZE+1+k) L*(k)|^2 / (R(n) E_L)
+ *
+ * where R(n) is the energy of the window and E_L is the energy of the long
+ * training symbol. M(n) is between 0 and 1, and peaks at the beginning of
+ * each of the two long training symbols. Every peak above the threshold
+ * generates an event. The state is kept between calls, so samples can be
+ * given in chunks of any size. No memory is allocated
+ */
+struct LONG_TRAINING_DETECTOR {
+	//last LT_SIZE samples, stored twice so that the window is contiguous
+	fftw_complex history[2 * LT_SIZE];
+	//energies of the last LT_SIZE samples and their sum
+	double energies[LT_SIZE];
+	double r;
+	//energy of the long training symbol
+	double reference_energy;
+	//number of samples processed so far
+	unsigned long long n;
+	//whether the metric is above threshold, and best value seen since then
+	int in_peak;
+	double peak_metric;
+	long long peak_sample;
+};
+
+/**
+ * Fixed point version of LONG_TRAINING_DETECTOR, for sc16 samples. The
+ * correlation with the long training symbol, quantized with LT16_SCALE, is
+ * computed with 16 bit SIMD multiply-add instructions into 32 bit integers.
+ * The squared correlation is compared in 64 bit integers with threshold *
+ * r * reference_energy, with the product of the threshold and the energy
+ * rounded down, and the metric is computed in floating point only for the
+ * samples above this bound, i.e., the ones which can be above the
+ * threshold. Since the correlation costs LT_SIZE complex products per
+ * sample, the detector is meant to run on the candidate frames found by the
+ * short training detector
+ */
+struct LONG_TRAINING_DETECTOR_S16 {
+	//last LT_SIZE samples, stored twice so that the window is contiguous
+	sample_sc16_t history[2 * LT_SIZE];
+	//energies of the last LT_SIZE samples and their sum
+	int energies[LT_SIZE];
+	long long r;
+	//quantized long training symbol, as pairs multiplying the real and the
+	//imaginary part of a sample to give the real and the imaginary part of
+	//the correlation, and its energy
+	short reference_re[LT_SIZE][2];
+	short reference_im[LT_SIZE][2];
+	double reference_energy;
+	//number of samples processed so far
+	unsigned long long n;
+	//whether the metric is above threshold, and best value seen since then
+	int in_peak;
+	double peak_metric;
+	long long peak_sample;
+};
+
+/**
+ * State of a long training correlator. It computes the same metric of
+ * LONG_TRAINING_DETECTOR, but the correlation with the long training symbol
+ * is done in the frequency domain with the overlap-save method: samples are
+ * collected into blocks of LT_FFT_SIZE samples (the last LT_SIZE - 1 of
+ * the previous block, plus the new ones), and each block is correlated with
+ * one forward and one backward FFT, reusing plans created once at
+ * initialization. Peaks are refined to a fraction of a sample by parabolic
+ * interpolation of the metric. Since samples are processed one block at a
+ * time, events are reported with a delay of up to one block.
+ * The correlation costs O(log LT_FFT_SIZE) operations per sample instead of
+ * the LT_SIZE complex products of LONG_TRAINING_DETECTOR: with FFTW, the
+ * correlator is about ten times faster (see the lts_correlator and
+ * long_detector kernels of ofdm_bench)
+ */
+struct LONG_TRAINING_CORRELATOR {
+	//cached FFTW plans
+	fftw_plan forward, backward;
+	//time samples of the block under construction
+	fftw_complex *block;
+	//spectrum of the block, and correlation output
+	fftw_complex *spectrum, *correlation;
+	//spectrum of the matched filter, scaled by 1 / LT_FFT_SIZE
+	fftw_complex *reference;
+	//number of samples in the block
+	int fill;
+	//energies of the last LT_SIZE samples and their sum
+	double energies[LT_SIZE];
+	double r;
+	//energy of the long training symbol
+	double reference_energy;
+	//number of samples processed so far
+	unsigned long long n;
+	//peak tracking: whether the metric is above threshold, best value since
+	//then with its neighbours, and metric of the previous sample
+	int in_peak;
+	int need_right;
+	double peak_metric, left_metric, right_metric, previous_metric;
+	long long peak_sample;
+};
+
+/**
+ * Resets the state of a short training detector, as if no sample had been
+ * received (i.e., past samples are considered to be 0)
+ *
+ * \param d the detector
+ */
+void init_short_training_detector(struct SHORT_TRAINING_DETECTOR *d);
+
+/**
+ * Feeds a chunk of samples to the short training detector
+ *
+ * \param d the detector
+ * \param samples new complex time samples
+ * \param size number of samples in the chunk
+ * \param threshold threshold on the timing metric M(n), between 0 and 1
+ * \param metric if not null, an array of size elements where to store the
+ * timing metric computed for each sample
+ * \return the index (within the chunk) of the first sample for which the
+ * timing metric exceeds the threshold, or -1 if none is found. The window
+ * of this sample spans the previous SC_WINDOW + SC_DELAY samples. The whole
+ * chunk is always consumed
+ */
+int update_short_training_detector(struct SHORT_TRAINING_DETECTOR *d, const fftw_complex *samples, int size, double threshold, double *metric);
+
+/**
+ * Feeds a chunk of samples to the short training detector, generating an event
+ * each time the timing metric exceeds the threshold. To avoid multiple events
+ * for the same frame, the detector re-arms only when the metric falls below
+ * SC_HYSTERESIS times the threshold, and not before SC_HOLDOFF samples. Since
+ * the state is carried over between calls, a preamble split between two chunks
+ * is detected as well
+ *
+ * \param d the detector
+ * \param samples new complex time samples
+ * \param size number of samples in the chunk
+ * \param threshold threshold on the timing metric M(n), between 0 and 1
+ * \param events array where to store the events. The index of each event is the
+ * estimated beginning of the short training sequence
+ * \param max_events size of the events array. Further events in the same chunk
+ * are lost. A chunk cannot generate more than size / SC_HOLDOFF + 1 events
+ * \return the number of events stored into the array
+ */
+int detect_short_training_events(struct SHORT_TRAINING_DETECTOR *d, const fftw_complex *samples, int size, double threshold,
+                                 struct DETECTION_EVENT *events, int max_events);
+
+/**
+ * Single precision version of init_short_training_detector()
+ */
+void init_short_training_detector_f(struct SHORT_TRAINING_DETECTOR_F *d);
+
+/**
+ * Single precision version of update_short_training_detector()
+ */
+int update_short_training_detector_f(struct SHORT_TRAINING_DETECTOR_F *d, const sample_cf32_t *samples, int size, float threshold, float *metric);
+
+/**
+ * Single precision version of detect_short_training_events()
+ */
+int detect_short_training_events_f(struct SHORT_TRAINING_DETECTOR_F *d, const sample_cf32_t *samples, int size, float threshold,
+                                   struct DETECTION_EVENT *events, int max_events);
+
+/**
+ * Selects the implementation used by the fixed point detectors. By default,
+ * the fastest one supported by the cpu is used. The backend must not be
+ * changed while detectors are running in other threads
+ *
+ * \param backend the backend to use
+ * \return 0 on success, or ERR_DETECTOR_NOT_SUPPORTED if the backend is not
+ * supported by the cpu or by the compiler. The current backend is left
+ * unchanged in such a case
+ */
+int set_detector_backend(enum DETECTOR_BACKEND backend);
+
+/**
+ * Returns the implementation currently used by the fixed point detectors
+ */
+enum DETECTOR_BACKEND get_detector_backend();
+
+/**
+ * Fixed point version of init_short_training_detector()
+ */
+void init_short_training_detector_s16(struct SHORT_TRAINING_DETECTOR_S16 *d);
+
+/**
+ * Fixed point version of detect_short_training_events(). The metric of the
+ * events is the same as the one of the floating point detectors, up to the
+ * quantization of the samples
+ */
+int detect_short_training_events_s16(struct SHORT_TRAINING_DETECTOR_S16 *d, const sample_sc16_t *samples, int size, double threshold,
+                                     struct DETECTION_EVENT *events, int max_events);
+
+/**
+ * Fixed point version of init_long_training_detector()
+ */
+void init_long_training_detector_s16(struct LONG_TRAINING_DETECTOR_S16 *d);
+
+/**
+ * Fixed point version of detect_long_training_events()
+ */
+int detect_long_training_events_s16(struct LONG_TRAINING_DETECTOR_S16 *d, const sample_sc16_t *samples, int size, double threshold,
+                                    struct DETECTION_EVENT *events, int max_events);
+
+/**
+ * Resets an energy gate, with margin EG_MARGIN and bypass off. The noise
+ * floor is unknown until the first block, which is always given to the
+ * detector
+ *
+ * \param g the gate
+ */
+void init_energy_gate(struct ENERGY_GATE *g);
+
+/**
+ * Feeds a chunk of samples to the single precision short training detector
+ * through an energy gate, generating the events of
+ * detect_short_training_events_f() for the blocks that pass the gate
+ *
+ * \param g the gate
+ * \param d the detector, initialized together with the gate
+ * \param samples new complex time samples
+ * \param size number of samples in the chunk
+ * \param threshold threshold on the timing metric M(n), between 0 and 1
+ * \param events array where to store the events
+ * \param max_events size of the events array. Further events in the same chunk
+ * are lost. A chunk cannot generate more than size / SC_HOLDOFF + 2 events
+ * \return the number of events stored into the array
+ */
+int detect_short_training_events_gated_f(struct ENERGY_GATE *g, struct SHORT_TRAINING_DETECTOR_F *d, const sample_cf32_t *samples,
+                                         int size, float threshold, struct DETECTION_EVENT *events, int max_events);
+
+/**
+ * Resets the state of a long training detector
+ *
+ * \param d the detector
+ */
+void init_long_training_detector(struct LONG_TRAINING_DETECTOR *d);
+
+/**
+ * Feeds a chunk of samples to the long training detector, generating an event
+ * for every peak of the metric above the threshold. An event is generated when
+ * the metric falls back below the threshold, so it might be reported in the
+ * chunk following the one containing the peak
+ *
+ * \param d the detector
+ * \param samples new complex time samples
+ * \param size number of samples in the chunk
+ * \param threshold threshold on the metric M(n), between 0 and 1
+ * \param events array where to store the events. The index of each event is the
+ * first sample of the long training symbol
+ * \param max_events size of the events array. Further events in the same chunk
+ * are lost
+ * \return the number of events stored into the array
+ */
+int detect_long_training_events(struct LONG_TRAINING_DETECTOR *d, const fftw_complex *samples, int size, double threshold,
+                                struct DETECTION_EVENT *events, int max_events);
+
+/**
+ * Initializes a long training correlator, allocating its buffers and
+ * creating the FFTW plans. Since FFTW planning is not thread safe, this
+ * function should not be called concurrently from several threads
+ *
+ * \param c the correlator
+ */
+void init_long_training_correlator(struct LONG_TRAINING_CORRELATOR *c);
+
+/**
+ * Frees buffers and plans of a long training correlator
+ *
+ * \param c the correlator
+ */
+void free_long_training_correlator(struct LONG_TRAINING_CORRELATOR *c);
+
+/**
+ * Feeds a chunk of samples to the long training correlator, generating an
+ * event for every peak of the metric above the threshold, like
+ * detect_long_training_events(). Each event also reports the sub-sample
+ * offset of the peak. Samples are buffered until a block is complete
+ *
+ * \param c the correlator
+ * \param samples new complex time samples
+ * \param size number of samples in the chunk
+ * \param threshold threshold on the metric, between 0 and 1
+ * \param events array where to store the events
+ * \param max_events size of the events array. Further events in the same chunk
+ * are lost
+ * \return the number of events stored into the array
+ */
+int correlate_long_training(struct LONG_TRAINING_CORRELATOR *c, const fftw_complex *samples, int size, double threshold,
+                            struct DETECTION_EVENT *events, int max_events);
+
+/**
+ * Processes the samples buffered by the long training correlator, as if the
+ * stream ended, reporting a peak still above the threshold as well. Further
+ * samples can be given afterwards
+ *
+ * \param c the correlator
+ * \param threshold threshold on the metric, between 0 and 1
+ * \param events array where to store the events
+ * \param max_events size of the events array
+ * \return the number of events stored into the array
+ */
+int flush_long_training_correlator(struct LONG_TRAINING_CORRELATOR *c, double threshold, struct DETECTION_EVENT *events, int max_events);
+
+#endif
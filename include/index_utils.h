@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: persistent index of the frames of a capture
+ *
+ */
+
+#ifndef _INDEX_UTILS_H_
+#define _INDEX_UTILS_H_
+
+#include <stdio.h>
+
+#include "capture_utils.h"
+#include "pool_utils.h"
+
+/**
+ * A frame index is a binary file, usually stored next to the capture with
+ * the FRAME_INDEX_EXTENSION extension, describing the frames found in the
+ * capture. It starts with a FRAME_INDEX_HEADER, followed by one
+ * FRAME_INDEX_RECORD per frame, in capture order. Both are written in the
+ * byte order of the host, like the captures. Records have a fixed size, so
+ * record N is read directly from its position in the file, and records are
+ * appended one at a time while the capture is being scanned: a reader
+ * ignores a last record written only in part
+ */
+#define FRAME_INDEX_EXTENSION   ".idx"
+#define FRAME_INDEX_MAGIC       "OFDMIDX"
+#define FRAME_INDEX_VERSION     1
+
+//error returned when the index file cannot be written
+#define ERR_INDEX_CANNOT_WRITE  -3
+//status of a frame whose SIGNAL field only has been decoded
+#define FRAME_INDEX_NOT_DECODED 1
+
+struct FRAME_INDEX_HEADER {
+	//FRAME_INDEX_MAGIC, 0 terminated
+	char magic[8];
+	int version;
+	//size of a record in bytes, for readers of other versions
+	int record_size;
+	//enum CAPTURE_FORMAT of the capture
+	int format;
+	int reserved;
+};
+
+struct FRAME_INDEX_RECORD {
+	//index of the first sample of the frame in the capture, and number of
+	//samples of the frame
+	long long offset;
+	int n_samples;
+	//enum DATA_RATE and size of the PSDU in bytes, from the SIGNAL field
+	int data_rate;
+	int psdu_size;
+	//result of the decoding of the frame, e.g., 0 if the frame check
+	//sequence is correct, or ERR_RX_FCS if it is not. FRAME_INDEX_NOT_DECODED
+	//if the DATA field has not been decoded
+	int status;
+	//signal to noise ratio (dB) and carrier frequency offset (rad/sample)
+	float snr;
+	float cfo;
+};
+
+/**
+ * An index file being written
+ */
+struct FRAME_INDEX_WRITER {
+	FILE *f;
+	long long n_records;
+	//result of the last write, 0 or ERR_INDEX_CANNOT_WRITE
+	int err;
+};
+
+/**
+ * An index file mapped into memory for reading
+ */
+struct FRAME_INDEX {
+	int fd;
+	//the mapped file
+	const void *data;
+	size_t size;
+	enum CAPTURE_FORMAT format;
+	const struct FRAME_INDEX_RECORD *records;
+	long long n_records;
+};
+
+/**
+ * Creates an index file, replacing an existing one, and writes its header
+ *
+ * \param w the writer
+ * \param filename path of the index file
+ * \param format format of the samples of the capture
+ * \return 0 on success, or ERR_INDEX_CANNOT_WRITE
+ */
+int create_frame_index(struct FRAME_INDEX_WRITER *w, const char *filename, enum CAPTURE_FORMAT format);
+
+/**
+ * Appends a record to an index file. The record is flushed right away, so
+ * the index can be read while the capture is still being scanned
+ *
+ * \param w the writer
+ * \param r the record
+ * \return 0 on success, or ERR_INDEX_CANNOT_WRITE
+ */
+int append_frame_index_record(struct FRAME_INDEX_WRITER *w, const struct FRAME_INDEX_RECORD *r);
+
+/**
+ * Closes an index file being written
+ *
+ * \param w the writer
+ */
+void close_frame_index_writer(struct FRAME_INDEX_WRITER *w);
+
+/**
+ * Fills a record with the information about a frame measured by the receiver
+ *
+ * \param offset index, in the capture, of the first sample given to the
+ * receiver
+ * \param status result of ofdm_decode_frame()
+ * \param stats information about the frame, whose SIGNAL field must have
+ * been decoded
+ * \param r the record
+ */
+void make_frame_index_record(long long offset, int status, const struct RX_STATS *stats,
+                             struct FRAME_INDEX_RECORD *r);
+
+/**
+ * Callback for decode_capture() that appends a record for every frame to
+ * the index given as argument, so that the index is built while the capture
+ * is decoded. Write errors are stored into the err field of the writer
+ *
+ * \param frame the decoded frame
+ * \param writer the FRAME_INDEX_WRITER
+ */
+void index_decoded_frame(const struct DECODED_FRAME *frame, void *writer);
+
+/**
+ * Maps an index file into memory. Records appended afterwards are not seen
+ *
+ * \param idx the index
+ * \param filename path of the index file
+ * \return 0 on success, ERR_CANNOT_READ_FILE if the file cannot be opened or
+ * mapped, or ERR_INVALID_FORMAT if it is not an index file of this version
+ */
+int open_frame_index(struct FRAME_INDEX *idx, const char *filename);
+
+/**
+ * Unmaps and closes an index file
+ *
+ * \param idx the index
+ */
+void close_frame_index(struct FRAME_INDEX *idx);
+
+/**
+ * Returns the record of the n-th frame
+ *
+ * \param idx the index
+ * \param n number of the frame, starting from 0
+ * \return the record, or NULL if there are not so many frames
+ */
+const struct FRAME_INDEX_RECORD *get_frame_index_record(const struct FRAME_INDEX *idx, long long n);
+
+/**
+ * Searches the first frame, starting from the given one, with one of the
+ * given data rates
+ *
+ * \param idx the index
+ * \param from number of the first frame to check
+ * \param rates accepted data rates, as a mask of (1 << DATA_RATE) values. 0
+ * accepts any rate
+ * \param correct_only if not 0, only frames with a correct frame check
+ * sequence are accepted
+ * \return the number of the frame, or -1 if there is none
+ */
+long long find_frame_index_record(const struct FRAME_INDEX *idx, long long from, int rates, int correct_only);
+
+#endif
@@ -224,6 +224,16 @@ static const char *STR_DATA_ADDRESSES_FUNCTIONALITY[4][4] = {
 	{"Receiver", "Transmitter", "Destination", "Source"},
 };
 
+/**
+ * Computes the CRC32 of a set of bytes, i.e., the frame check sequence
+ * appended to a MAC frame by generate_mac_data_frame()
+ *
+ * \param buf the bytes
+ * \param len number of bytes
+ * \return the CRC32
+ */
+unsigned int crc32(const char *buf, size_t len);
+
 /**
  * Converts a mac address string into a mac_address_t type
  *
@@ -341,6 +351,15 @@ void set_frame_control_version(dbyte *frame_control, char version, int lsb);
  */
 void set_frame_control_type(dbyte *frame_control, enum FC_TYPE type, int lsb);
 
+/**
+ * Get type from MAC control field
+ *
+ * \param frame_control frame control field
+ * \param lsb first bit of frame control is the LSB
+ * \return the type of the frame
+ */
+enum FC_TYPE get_frame_control_type(dbyte frame_control, int lsb);
+
 /**
  * Set subtype for MAC control field
  *
@@ -80,6 +80,26 @@ enum DATA_RATE {
     BW_10_DR_24_MBPS,
     BW_10_DR_27_MBPS
 };
+static const char* STR_DATA_RATE[] = {
+	"BW_20_DR_6_MBPS",
+	"BW_20_DR_9_MBPS",
+	"BW_20_DR_12_MBPS",
+	"BW_20_DR_18_MBPS",
+	"BW_20_DR_24_MBPS",
+	"BW_20_DR_36_MBPS",
+	"BW_20_DR_48_MBPS",
+	"BW_20_DR_54_MBPS",
+	"BW_10_DR_3_MBPS",
+	"BW_10_DR_4_5_MBPS",
+	"BW_10_DR_6_MBPS",
+	"BW_10_DR_9_MBPS",
+	"BW_10_DR_12_MBPS",
+	"BW_10_DR_18_MBPS",
+	"BW_10_DR_24_MBPS",
+	"BW_10_DR_27_MBPS"
+};
+//number of available data rates
+#define N_DATA_RATES            16
 
 /**
  * Define coding rates for the puncturing function
@@ -173,8 +193,36 @@ struct TX_PARAMETERS {
 };
 
 /**
- * Defines subcarriers polarities
+ * Buffers and precomputed samples used by generate_ofdm_frame(). Their size
+ * does not depend on the frame, so they can be allocated once and reused for
+ * every frame
+ */
+struct OFDM_FRAME_ENCODER {
+	//initial state of the scrambler
+	char scrambler_seed;
+	//OFDM modulated symbol
+	fftw_complex *mod;
+	//symbol with pilot carriers
+	fftw_complex *pil;
+	//ifft inputs
+	fftw_complex *ifft;
+	//symbol time samples (after ifft)
+	fftw_complex *time;
+	//cyclically extended symbol
+	fftw_complex *ext;
+	//signal header
+	fftw_complex *signal;
+	//short training sequence
+	fftw_complex *short_sequence;
+	//long training sequence
+	fftw_complex *long_sequence;
+};
+
+/**
+ * Defines subcarriers polarities. The sequence is repeated cyclically for
+ * frames with more than N_PILOT_POLARITIES symbols
  */
+#define N_PILOT_POLARITIES      127
 static const double subcarrier_polarities[] = {
 	1, 1, 1, 1, -1, -1, -1, 1, -1, -1, -1, -1, 1, 1, -1, 1, -1, -1, 1, 1, -1, 1, 1, -1, 1, 1, 1, 1, 1, 1, -1, 1,
 	1, 1, -1, 1, 1, -1, -1, 1, 1, 1, -1, 1, -1, -1, -1, 1, -1, 1, -1, -1, 1, -1, -1, 1, 1, 1, 1, 1, -1, -1, 1, 1,
@@ -253,6 +301,18 @@ void scramble(const char *in, char *out, int size);
  */
 void scramble_with_initial_state(const char *in, char *out, int size, char initial_state);
 
+/**
+ * Recovers the initial state of the scrambler from a scrambled DATA field.
+ * The first 7 bits of the SERVICE field are 0, so they are transmitted as
+ * the first 7 bits of the scrambling sequence, from which the register is
+ * run backwards. Since scrambling is an xor, the field is then descrambled
+ * with scramble_with_initial_state() and the recovered state
+ *
+ * \param scrambled the scrambled DATA field, at least 1 byte
+ * \return the initial state of the 7-bit shift register
+ */
+char get_scrambler_initial_state(const char *scrambled);
+
 /**
  * Set to 0 the TAIL bits AFTER the scrambling has been
  * performed, as indicated in 802.11-2007, 17.3.5.2.
@@ -495,10 +555,47 @@ void generate_signal_field(fftw_complex *out, enum DATA_RATE data_rate, int leng
  * \param data pointer to a non-alloced array where data field will
  * be stored. The array will be malloced by the procedure
  * \param data_length pointer to an integer where to store the size of
- * the data field, in bytes
+ * the data field, in bytes, rounded up when the field is not made of whole
+ * bytes (see get_tx_parameters())
  */
 void generate_data_field(const char *psdu, int length, enum DATA_RATE data_rate, char **data, int *data_length);
 
+/**
+ * Initializes the buffers used for generating frames with generate_ofdm_frame(),
+ * and generates the short and long training sequences, which are the same for
+ * every frame. The scrambler seed is set to 0x5D, i.e., the one used in the
+ * example of 802.11-2012 annex L, and can be changed afterwards
+ *
+ * \param enc the encoder to initialize
+ */
+void init_ofdm_frame_encoder(struct OFDM_FRAME_ENCODER *enc);
+
+/**
+ * Frees the buffers allocated by init_ofdm_frame_encoder()
+ *
+ * \param enc the encoder to free
+ */
+void free_ofdm_frame_encoder(struct OFDM_FRAME_ENCODER *enc);
+
+/**
+ * Performs all the OFDM encoding steps for a PSDU, from the generation of the
+ * DATA field down to the complex time samples of the whole frame, i.e.,
+ * preamble, SIGNAL header and DATA symbols. If the profiler is enabled, the
+ * time spent in each step is accounted to the corresponding stage
+ *
+ * \param enc encoder initialized with init_ofdm_frame_encoder()
+ * \param psdu the PSDU as given by the MAC layer (e.g., by generate_mac_data_frame()).
+ * The endianness of the bytes is changed internally, so the array is not modified
+ * \param length number of octets in the PSDU
+ * \param data_rate the data rate used for encoding
+ * \param samples pointer to a non-alloced array where the time samples will be
+ * stored. The array is allocated by the procedure with fftw_alloc_complex(), and
+ * must be freed with fftw_free()
+ * \param n_samples pointer to an integer where to store the number of samples,
+ * i.e., FRAME_SIZE(n_sym)
+ */
+void generate_ofdm_frame(struct OFDM_FRAME_ENCODER *enc, const char *psdu, int length, enum DATA_RATE data_rate, fftw_complex **samples, int *n_samples);
+
 /**
  * Set the content of an array of complex samples to 0
  *
@@ -526,7 +623,9 @@ double compute_correlation(fftw_complex *samples, fftw_complex *known_samples, i
 /**
  * Detects the start of the short training sequence (if any) into a set of complex time
  * samples. The function computes an autocorrelation and the returns the index of the
- * first time samples where the autocorrelation values exceeds the given threshold
+ * first time samples where the autocorrelation values exceeds the given threshold.
+ * The correlation is recomputed from scratch for every candidate offset: for
+ * continuous reception, see the streaming detector in detector_utils.h
  *
  * \param samples set of complex time samples
  * \param size number of complex time samples into the set
@@ -537,4 +636,15 @@ double compute_correlation(fftw_complex *samples, fftw_complex *known_samples, i
  */
 int detect_short_training_start(fftw_complex *samples, int size, double correlation_threshold);
 
+/**
+ * Detects the start of the long training sequence (if any) into a set of complex time
+ * samples, by correlating the samples with the time domain long training symbol
+ *
+ * \param samples set of complex time samples
+ * \param size number of complex time samples into the set
+ * \return the index of the first time sample where the correlation exceeds the threshold
+ * or -1 if none is found
+ */
+int detect_long_training_start(fftw_complex *samples, int size);
+
 #endif
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: parallel decoding of the frames of a capture
+ *
+ */
+
+#ifndef _POOL_UTILS_H_
+#define _POOL_UTILS_H_
+
+#include <pthread.h>
+
+#include <fftw3.h>
+
+#include "receiver_utils.h"
+#include "capture_utils.h"
+
+/**
+ * A capture is decoded in two stages. The calling thread scans it and, for
+ * each frame, only decodes the SIGNAL field with ofdm_locate_frame(), which
+ * gives where the frame starts and ends. The samples of the frame are then
+ * handed as a job to a pool of worker threads, each one with its own
+ * decoder, which decode the DATA field with ofdm_decode_frame(). Results are
+ * delivered in capture order, whatever the order in which workers complete.
+ * The capture is read from its file mapping: only the samples being scanned,
+ * and those of each job, are converted to fftw_complex.
+ *
+ * The capture is scanned in windows of POOL_SCAN_WINDOW samples, which
+ * overlap by POOL_SCAN_OVERLAP samples so that a preamble across the end of
+ * a window is found in the next one. A window is larger than the longest
+ * frame, so a frame truncated by the end of a window is located again by a
+ * window starting at its beginning
+ */
+#define POOL_SCAN_WINDOW        (1 << 20)
+#define POOL_SCAN_OVERLAP       (SHORT_TRAINING_SIZE + RX_SEARCH_SIZE + OFDM_SYMBOL_SIZE)
+//samples converted at once by the scan. The windows following a frame start
+//at its end, so with two windows a sample is converted at most twice
+#define POOL_SCAN_BUFFER        (2 * POOL_SCAN_WINDOW)
+//samples given to the workers before and after the frame located by the scan
+#define POOL_JOB_MARGIN         32
+//maximum number of frames located but not delivered yet
+#define POOL_QUEUE_SIZE         64
+#define POOL_MAX_THREADS        64
+
+//error returned when the worker threads cannot be created
+#define ERR_POOL_THREADS        -1
+
+/**
+ * A frame decoded by the pool
+ */
+struct DECODED_FRAME {
+	//index, within the capture, of the first sample given to the decoder.
+	//The positions in stats are relative to it, e.g., the frame starts at
+	//sample offset + stats.start of the capture
+	long long offset;
+	//result of ofdm_decode_frame(). Frames dropped by the address filter
+	//are delivered as well, with ERR_RX_FILTERED
+	int err;
+	int length;
+	struct RX_STATS stats;
+	char psdu[RX_MAX_PSDU_SIZE];
+};
+
+/**
+ * Function called, from the thread calling decode_capture(), for every
+ * frame of the capture, in capture order
+ *
+ * \param frame the decoded frame. It is only valid during the call
+ * \param arg the argument given to decode_capture()
+ */
+typedef void (*decoded_frame_callback)(const struct DECODED_FRAME *frame, void *arg);
+
+/**
+ * Frame waiting to be decoded, being decoded, or waiting to be delivered
+ */
+struct POOL_JOB {
+	//samples of the frame, converted from the capture. The buffer is kept
+	//from one job to the next, and only grows when a frame does not fit
+	fftw_complex *samples;
+	int capacity;
+	int size;
+	int done;
+	struct DECODED_FRAME frame;
+};
+
+struct DECODER_POOL;
+
+/**
+ * A worker thread and the decoder it uses
+ */
+struct POOL_WORKER {
+	pthread_t thread;
+	struct DECODER_POOL *pool;
+	struct OFDM_FRAME_DECODER *decoder;
+};
+
+/**
+ * Pool of decoding threads. Each thread has its own decoder, allocated once
+ * by init_decoder_pool(), so decoding a frame does not allocate memory
+ */
+struct DECODER_POOL {
+	//decoder settings, applied to all the decoders by decode_capture()
+	int bw_10_mhz;
+	int smoothing;
+	const struct RX_ADDRESS_FILTER *filter;
+	int n_threads;
+	struct POOL_WORKER *workers;
+	//one decoder per worker, plus the one of the scan
+	struct OFDM_FRAME_DECODER *decoders;
+	//ring of POOL_QUEUE_SIZE jobs. Jobs [delivered, taken) are being
+	//decoded or wait for delivery, jobs [taken, queued) wait for a worker
+	struct POOL_JOB *jobs;
+	long long queued, taken, delivered;
+	//samples of the capture being scanned, up to POOL_SCAN_BUFFER of them
+	//from buffer_start on
+	fftw_complex *buffer;
+	long long buffer_start;
+	int buffered;
+	int stop;
+	pthread_mutex_t mutex;
+	//signaled when a job is queued, and when a job is done
+	pthread_cond_t job_available;
+	pthread_cond_t job_done;
+};
+
+/**
+ * Initializes a pool, allocating the decoders and starting the threads.
+ * Since it initializes decoders, it should not be called concurrently from
+ * several threads
+ *
+ * \param p the pool
+ * \param n_threads number of worker threads, up to POOL_MAX_THREADS. With 0,
+ * frames are decoded by the thread calling decode_capture(), right after
+ * being located
+ * \return 0 on success, or ERR_POOL_THREADS, in which case nothing has to be
+ * freed
+ */
+int init_decoder_pool(struct DECODER_POOL *p, int n_threads);
+
+/**
+ * Stops the threads of a pool and frees its memory
+ *
+ * \param p the pool
+ */
+void free_decoder_pool(struct DECODER_POOL *p);
+
+/**
+ * Decodes all the frames of a capture. Frames whose preamble or SIGNAL field
+ * cannot be decoded are skipped, the others are decoded by the workers and
+ * given to the callback in capture order. The function returns once all of
+ * them have been delivered. The capture must stay open meanwhile
+ *
+ * \param p the pool
+ * \param c the capture, opened with open_capture()
+ * \param callback function called for every frame
+ * \param arg argument passed to the callback
+ * \return the number of frames given to the callback
+ */
+int decode_capture(struct DECODER_POOL *p, const struct CAPTURE *c, decoded_frame_callback callback, void *arg);
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: per-stage profiler for the OFDM encoding pipeline
+ *
+ */
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <stdio.h>
+
+#include "utils.h"
+
+/**
+ * Stages of the OFDM transmission pipeline that can be profiled
+ */
+enum PROFILER_STAGE {
+    STAGE_DATA_FIELD,
+    STAGE_SCRAMBLE,
+    STAGE_ENCODE,
+    STAGE_PUNCTURE,
+    STAGE_INTERLEAVE,
+    STAGE_MODULATE,
+    STAGE_PILOTS,
+    STAGE_IFFT,
+    STAGE_CP_WINDOW,
+    STAGE_SIGNAL,
+    STAGE_PREAMBLE,
+    STAGE_OUTPUT,
+    N_PROFILER_STAGES
+};
+static const char* STR_PROFILER_STAGE[] = {
+	"data field",
+	"scramble",
+	"encode",
+	"puncture",
+	"interleave",
+	"modulate",
+	"pilots",
+	"ifft",
+	"cp/window",
+	"signal",
+	"preamble",
+	"output"
+};
+
+/**
+ * Profiler modes, to be given (or-ed) to profiler_enable(). In summary mode
+ * the profiler only accumulates the time and the number of calls of each
+ * stage. In trace mode, it also records every single event, so that a
+ * trace can be dumped with profiler_write_trace()
+ */
+#define PROFILER_SUMMARY    0x01
+#define PROFILER_TRACE      0x02
+
+/**
+ * Enables the profiler. The profiler is disabled by default, and the
+ * profiler_begin() and profiler_end() calls only cost a check on a flag
+ *
+ * \param mode profiling mode (PROFILER_SUMMARY, PROFILER_TRACE, or both).
+ * A value of 0 disables the profiler
+ */
+void profiler_enable(int mode);
+
+/**
+ * Resets all the statistics and the recorded trace events
+ */
+void profiler_reset();
+
+/**
+ * Marks the beginning of a stage. Stages cannot be nested: each one must be
+ * ended with profiler_end() before the next one begins
+ *
+ * \param stage the stage which is starting
+ * \return the timer to be passed to profiler_end(), or 0 if the profiler
+ * is disabled
+ */
+nanotimer_t profiler_begin(enum PROFILER_STAGE stage);
+
+/**
+ * Marks the end of a stage, accounting the elapsed time to it
+ *
+ * \param stage the stage which is ending, i.e., the one of the last
+ * profiler_begin()
+ * \param timer the timer returned by profiler_begin()
+ */
+void profiler_end(enum PROFILER_STAGE stage, nanotimer_t timer);
+
+/**
+ * Marks the beginning of a frame. Stages recorded between this call and
+ * profiler_frame_end() are grouped under the same frame in the trace
+ */
+void profiler_frame_begin();
+
+/**
+ * Marks the end of a frame
+ */
+void profiler_frame_end();
+
+/**
+ * Prints a table with the number of calls, the total, average, minimum and
+ * maximum time spent in each stage, and the share of the total time
+ *
+ * \param f the file where to print the table
+ */
+void profiler_print_summary(FILE *f);
+
+/**
+ * Writes the recorded events in the Chrome trace-event JSON format, which
+ * can be loaded in chrome://tracing or in Perfetto
+ *
+ * \param f the file where to write the trace
+ * \return the number of events written
+ */
+int profiler_write_trace(FILE *f);
+
+#endif
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: decoding of received OFDM frames
+ *
+ */
+
+#ifndef _RECEIVER_UTILS_H_
+#define _RECEIVER_UTILS_H_
+
+#include <fftw3.h>
+
+#include "ofdm_utils.h"
+#include "channel_utils.h"
+#include "cfo_utils.h"
+#include "viterbi_utils.h"
+#include "mac_utils.h"
+
+//errors returned when the SIGNAL field is not valid
+//the parity bit does not match the first 17 bits
+#define ERR_SIGNAL_PARITY       -1
+//the RATE bits are not one of the defined rates
+#define ERR_SIGNAL_RATE         -2
+//the reserved bit is not 0
+#define ERR_SIGNAL_RESERVED     -3
+//the received coded bits differ from the re-encoded SIGNAL field in more
+//than SIGNAL_MAX_CODE_ERRORS positions, i.e., the symbol is likely noise
+#define ERR_SIGNAL_CODE         -4
+//the LENGTH field is 0
+#define ERR_SIGNAL_LENGTH       -5
+//errors returned by ofdm_decode_frame(), besides the ERR_SIGNAL_ ones
+//no short training sequence has been detected
+#define ERR_RX_NO_FRAME         -6
+//no long training symbol follows the short training sequence
+#define ERR_RX_NO_LONG_TRAINING -7
+//the frame announced by the SIGNAL field ends after the last sample
+#define ERR_RX_TRUNCATED        -8
+//the frame has been decoded, but its frame check sequence is wrong
+#define ERR_RX_FCS              -9
+//the frame is not addressed to any of the watched addresses, or its type is
+//not accepted: decoding stopped after the MAC header (see RX_ADDRESS_FILTER)
+#define ERR_RX_FILTERED         -10
+//no space left for another address in the filter
+#define ERR_RX_FILTER_FULL      -11
+
+//maximum size of a PSDU, i.e., the largest value of the LENGTH field
+#define RX_MAX_PSDU_SIZE        4095
+//maximum size of the DATA field in bytes: SERVICE and tail bits, plus the
+//padding to a whole symbol at the largest number of data bits per symbol
+#define RX_MAX_DATA_BYTES       ((16 + 8 * RX_MAX_PSDU_SIZE + 6 + 216) / 8)
+//number of samples of the longest frame, i.e., at 6 Mbps (24 data bits per symbol)
+#define RX_MAX_FRAME_SIZE       FRAME_SIZE(RX_MAX_DATA_BYTES * 8 / 24)
+//thresholds on the metrics of the short and long training detectors
+#define RX_SHORT_THRESHOLD      0.8
+#define RX_LONG_THRESHOLD       0.5
+//samples of the short training sequence used for the coarse frequency
+//offset estimate, starting from the detection
+#define RX_COARSE_CFO_SIZE      64
+//samples after the detection where the long training symbols are searched
+#define RX_SEARCH_SIZE          (SHORT_TRAINING_SIZE + LONG_TRAINING_SIZE)
+//the FFT windows start this many samples before the estimated beginning of
+//the symbols, i.e., within the cyclic prefix. This only rotates the phase
+//of the subcarriers, which is removed by the equalizer, and protects the
+//symbols from the interference of the previous ones when the timing is
+//late (e.g., when the strongest path is not the first one)
+#define RX_TIMING_BACKOFF       3
+
+/**
+ * Maximum number of the 48 coded bits of a valid SIGNAL field whose hard
+ * decision can differ from the re-encoded field. The Viterbi decoder always
+ * finds some field for a noise symbol, but its coded bits are typically
+ * 8 to 14 positions away from the received ones, while a frame that can be
+ * decoded has only a few errors. The tail bits cannot be used for this
+ * check, as the traceback from the zero state always sets them to 0
+ */
+#define SIGNAL_MAX_CODE_ERRORS  6
+
+/**
+ * Decodes the SIGNAL field of a frame, i.e., the inverse of
+ * generate_signal_field(): BPSK demapping, deinterleaving, Viterbi decoding
+ * with viterbi_decode_signal(), and validation of the fields and of the
+ * distance between the received and the re-encoded bits. The cost is
+ * small compared to the FFT of the symbol, so it can be used to discard
+ * false detections after the first symbol
+ *
+ * \param data the N_DATA_SUBCARRIERS data subcarriers of the SIGNAL symbol,
+ * equalized (e.g., by equalize_symbol_with_pilots() with symbol index 0 and
+ * extract_data_subcarriers())
+ * \param gain the gain of the data subcarriers, as taken by demap_soft().
+ * Can be NULL
+ * \param bw_10_mhz if not 0, the frame uses the 10 MHz channel spacing. The
+ * RATE field has the same values for both channel spacings
+ * \param tx_params where to store the transmission parameters of the frame,
+ * as given by get_tx_parameters()
+ * \return 0 on success, or one of the ERR_SIGNAL_ errors. In such a case,
+ * tx_params is not modified
+ */
+int decode_signal_field(const fftw_complex *data, const double *gain, int bw_10_mhz,
+                        struct TX_PARAMETERS *tx_params);
+
+//maximum number of addresses watched by a filter
+#define RX_MAX_WATCHED_ADDRESSES    8
+
+/**
+ * Filter applied by ofdm_decode_frame() to the first bytes of the MAC header
+ * (frame control, duration and address 1), which are decided by the Viterbi
+ * decoder after a few DATA symbols (e.g., 8 at 6 Mbps). Frames not matching
+ * the filter are dropped right away, without demodulating and decoding the
+ * rest of their symbols
+ */
+struct RX_ADDRESS_FILTER {
+	//accepted values of address 1. If there are none, any address is accepted
+	mac_address_t addresses[RX_MAX_WATCHED_ADDRESSES];
+	int n_addresses;
+	//accepted frame types, as a mask of (1 << FC_TYPE) values. 0 accepts any type
+	int types;
+};
+
+/**
+ * Information about a received frame, as measured by ofdm_decode_frame()
+ */
+struct RX_STATS {
+	//index of the sample where the short training sequence was detected
+	int detection;
+	//estimated index of the first sample of the frame, and index of the
+	//first sample after it. After an error, end is where the search for
+	//the next frame should resume
+	int start;
+	int end;
+	//carrier frequency offset (rad/sample), coarse and fine estimates together
+	double cfo;
+	//signal to noise ratio in dB, as estimated from the long training symbols
+	double snr;
+	//transmission parameters announced by the SIGNAL field
+	struct TX_PARAMETERS tx_params;
+	//initial state of the scrambler, recovered from the SERVICE field
+	char scrambler_seed;
+	//number of DATA symbols demodulated and decoded. It is less than
+	//tx_params.n_sym when the frame is dropped by the address filter
+	int n_decoded_symbols;
+};
+
+/**
+ * Buffers and state used by ofdm_decode_frame(). Their size does not depend
+ * on the frame, so they can be allocated once and reused for every frame.
+ * A decoder must not be used by several threads at the same time
+ */
+struct OFDM_FRAME_DECODER {
+	//if not 0, frames use the 10 MHz channel spacing (see decode_signal_field())
+	int bw_10_mhz;
+	//number of neighbouring subcarriers averaged by the channel estimate
+	//(see estimate_channel()). 0 by default
+	int smoothing;
+	//if not NULL, frames not matching the filter are not decoded completely.
+	//NULL by default
+	const struct RX_ADDRESS_FILTER *filter;
+	//FFT of the receiver
+	struct OFDM_DEMODULATOR demodulator;
+	//oscillator removing the carrier frequency offset
+	struct NCO nco;
+	//channel estimate of the frame
+	struct CHANNEL_ESTIMATE channel;
+	//Viterbi decoder of the DATA field
+	struct VITERBI_DECODER viterbi;
+	//samples corrected by the NCO
+	fftw_complex *corrected;
+	//decoded and descrambled DATA field
+	char *decoded;
+	char *descrambled;
+};
+
+/**
+ * Initializes an address filter
+ *
+ * \param f the filter
+ * \param types accepted frame types, as a mask of (1 << FC_TYPE) values. 0
+ * accepts any type
+ */
+void init_address_filter(struct RX_ADDRESS_FILTER *f, int types);
+
+/**
+ * Adds an address to the ones accepted by a filter
+ *
+ * \param f the filter
+ * \param mac the address, in "aa:bb:cc:dd:ee:ff" hex format
+ * \return 0 on success, or ERR_RX_FILTER_FULL if the filter already has
+ * RX_MAX_WATCHED_ADDRESSES addresses
+ */
+int add_watched_address(struct RX_ADDRESS_FILTER *f, const char *mac);
+
+/**
+ * Initializes a decoder, allocating its buffers and creating the FFTW plan.
+ * Since FFTW planning is not thread safe, this function should not be called
+ * concurrently from several threads. It also fills the tables that the
+ * receiver builds at first use, so once all the decoders have been
+ * initialized, each of them can be used by a different thread
+ *
+ * \param dec the decoder to initialize
+ */
+void init_ofdm_frame_decoder(struct OFDM_FRAME_DECODER *dec);
+
+/**
+ * Frees the buffers allocated by init_ofdm_frame_decoder()
+ *
+ * \param dec the decoder to free
+ */
+void free_ofdm_frame_decoder(struct OFDM_FRAME_DECODER *dec);
+
+/**
+ * Decodes the first frame found in a set of samples, i.e., the inverse of
+ * generate_ofdm_frame(). The steps are:
+ *  - detection of the short training sequence, and coarse estimate of the
+ *    carrier frequency offset
+ *  - timing from the peak of the first long training symbol, found after
+ *    removing the coarse offset, and fine estimate of the offset
+ *  - channel estimate from the long training symbols
+ *  - decoding of the SIGNAL field with decode_signal_field()
+ *  - for each DATA symbol: FFT, equalization with pilot phase tracking, soft
+ *    demapping, deinterleaving and Viterbi decoding
+ *  - descrambling, with the initial state of the scrambler recovered from
+ *    the SERVICE field, and check of the frame check sequence
+ * If the decoder has an address filter, the beginning of the DATA field is
+ * descrambled and checked as soon as the Viterbi decoder has decided the
+ * first bytes of the MAC header, and frames not matching the filter are
+ * dropped without decoding their remaining symbols
+ * The whole offset is removed by the NCO from the first long training symbol
+ * on, one symbol at a time, so no memory is allocated
+ *
+ * \param dec decoder initialized with init_ofdm_frame_decoder()
+ * \param samples the received samples
+ * \param n number of samples
+ * \param psdu array where to store the PSDU, including the frame check
+ * sequence. Must have space for RX_MAX_PSDU_SIZE bytes
+ * \param length where to store the size of the PSDU in bytes
+ * \param stats if not NULL, where to store information about the frame
+ * \return 0 on success, ERR_RX_FCS if the frame has been decoded but its
+ * frame check sequence is wrong (psdu and length are set anyway), or one of
+ * the other ERR_RX_ and ERR_SIGNAL_ errors (including ERR_RX_FILTERED), in
+ * which case psdu and length are not modified
+ */
+int ofdm_decode_frame(struct OFDM_FRAME_DECODER *dec, const fftw_complex *samples, int n, char *psdu, int *length,
+                      struct RX_STATS *stats);
+
+/**
+ * Finds the first frame in a set of samples and decodes its SIGNAL field
+ * only, i.e., the first steps of ofdm_decode_frame(). This gives the position
+ * and the size of the frame at the cost of a few symbols, so that the
+ * frame can then be decoded separately, e.g., by another thread
+ *
+ * \param dec decoder initialized with init_ofdm_frame_decoder()
+ * \param samples the received samples
+ * \param n number of samples
+ * \param stats if not NULL, where to store information about the frame. On
+ * success, all the fields but scrambler_seed and n_decoded_symbols are set,
+ * and the frame lies within samples [start, end)
+ * \return 0 on success, or one of the ERR_RX_ and ERR_SIGNAL_ errors, with
+ * the same meaning as for ofdm_decode_frame(). If the SIGNAL field has been
+ * decoded but the rest of the frame is beyond the samples, ERR_RX_TRUNCATED
+ * is returned with start and tx_params set anyway, so the size of the frame
+ * is known: it ends FRAME_SIZE(tx_params.n_sym) samples after start
+ */
+int ofdm_locate_frame(struct OFDM_FRAME_DECODER *dec, const fftw_complex *samples, int n, struct RX_STATS *stats);
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: triggered recording of the frames of a sample stream
+ *
+ */
+
+#ifndef _RECORDER_UTILS_H_
+#define _RECORDER_UTILS_H_
+
+#include <stdio.h>
+
+#include <fftw3.h>
+
+#include "detector_utils.h"
+#include "conditioning_utils.h"
+#include "receiver_utils.h"
+#include "index_utils.h"
+
+/**
+ * The recorder runs the short training detector, behind an energy gate, on
+ * a stream of samples and writes to disk only the samples of the frames,
+ * dropping quiet periods.
+ * The most recent samples are kept in a ring of RECORDER_RING_SIZE samples,
+ * in the format of the stream. For each detection, the recorder waits for
+ * the SIGNAL field, which gives the length of the frame, and then for the
+ * end of the frame. It then writes the window going from pre_trigger
+ * samples before the frame to post_trigger samples after it. Windows of
+ * consecutive frames do not overlap: a window starts at the end of the
+ * previous one at the earliest. Detections whose SIGNAL field cannot be
+ * decoded, and detections within a frame, are dropped.
+ *
+ * The recorded file is itself a capture, in the format of the stream, and
+ * for each frame a record is appended to its frame index. The offsets in the
+ * index refer to the recorded file
+ */
+#define RECORDER_RING_SIZE          (1 << 18)
+//samples processed at a time
+#define RECORDER_BLOCK_SIZE         4096
+//maximum number of detections waiting for their SIGNAL field or their end
+#define RECORDER_MAX_PENDING        64
+//maximum value of pre_trigger and post_trigger
+#define RECORDER_MAX_MARGIN         65536
+#define RECORDER_DEFAULT_PRE_TRIGGER    400
+#define RECORDER_DEFAULT_POST_TRIGGER   100
+
+//error returned when the recorded samples cannot be written
+#define ERR_RECORDER_CANNOT_WRITE   -4
+
+/**
+ * A detection followed by the recorder
+ */
+struct RECORDER_TRIGGER {
+	//estimated beginning of the short training sequence in the stream
+	long long detection;
+	//whether the SIGNAL field has been decoded
+	int located;
+	//first sample of the frame and first sample after it
+	long long start, end;
+	struct RX_STATS stats;
+};
+
+/**
+ * State of a triggered recorder
+ */
+struct TRIGGERED_RECORDER {
+	//settings, which can be changed after init_triggered_recorder().
+	//threshold of the short training detector
+	double threshold;
+	//samples written before and after each frame, up to RECORDER_MAX_MARGIN
+	int pre_trigger, post_trigger;
+	//if not 0, frames are decoded when complete, and the result is the
+	//status of their record. Otherwise, only the SIGNAL field is decoded
+	int decode;
+	//energy gate in front of the detector, whose margin and bypass mode
+	//can be changed as well
+	struct ENERGY_GATE gate;
+	//if not 0, the samples given to the detector go through the conditioner,
+	//whose stages can be changed as well. The samples written to disk and
+	//given to the decoder are not conditioned
+	int condition;
+	struct SIGNAL_CONDITIONER conditioner;
+
+	enum CAPTURE_FORMAT format;
+	size_t sample_size;
+	struct SHORT_TRAINING_DETECTOR_F detector;
+	struct OFDM_FRAME_DECODER decoder;
+	//last RECORDER_RING_SIZE samples of the stream, in its format
+	unsigned char *ring;
+	//block given to the detector, and frame given to the decoder
+	sample_cf32_t *block;
+	fftw_complex *frame;
+	//detections waiting for their SIGNAL field or their end, in order
+	struct RECORDER_TRIGGER pending[RECORDER_MAX_PENDING];
+	int n_pending;
+	//first sample of the stream not written yet
+	long long written_end;
+	FILE *out;
+	struct FRAME_INDEX_WRITER index;
+	int has_index;
+
+	//statistics: samples received and written, frames recorded, and
+	//detections dropped
+	long long n_samples;
+	long long n_written;
+	long long n_frames;
+	long long n_dropped;
+};
+
+/**
+ * Initializes a recorder, creating the output files
+ *
+ * \param r the recorder
+ * \param format format of the samples of the stream, which is also the
+ * format of the recorded file
+ * \param filename path of the recorded file
+ * \param indexfile path of the frame index of the recorded file, or NULL
+ * \return 0 on success, ERR_RECORDER_CANNOT_WRITE or ERR_INDEX_CANNOT_WRITE,
+ * in which case nothing has to be freed
+ */
+int init_triggered_recorder(struct TRIGGERED_RECORDER *r, enum CAPTURE_FORMAT format, const char *filename,
+                            const char *indexfile);
+
+/**
+ * Feeds samples of the stream to the recorder, writing the frames that are
+ * complete. The samples can be given in chunks of any size
+ *
+ * \param r the recorder
+ * \param samples the samples, in the format of the stream
+ * \param size number of samples
+ * \return the number of frames written, or ERR_RECORDER_CANNOT_WRITE or
+ * ERR_INDEX_CANNOT_WRITE
+ */
+int push_recorder_samples(struct TRIGGERED_RECORDER *r, const void *samples, int size);
+
+/**
+ * Closes the output files and frees a recorder. Frames not complete at the
+ * end of the stream are not written
+ *
+ * \param r the recorder
+ */
+void free_triggered_recorder(struct TRIGGERED_RECORDER *r);
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: soft bit processing of the receive chain
+ *
+ */
+
+#ifndef _SOFT_UTILS_H_
+#define _SOFT_UTILS_H_
+
+#include <fftw3.h>
+
+#include "ofdm_utils.h"
+
+/**
+ * Soft bits are signed 8 bit values, as taken by the Viterbi decoder:
+ * positive values stand for a 1, negative ones for a 0, and the magnitude is
+ * the confidence. Values saturate at +-SOFT_MAX
+ */
+#define SOFT_MAX                127
+/**
+ * Default scale of the demapper: a bit whose metric is one constellation
+ * step (e.g., a BPSK point at unit gain) gets a soft value of 32, so that
+ * weak subcarriers still have some resolution and strong ones saturate
+ */
+#define DEMAP_DEFAULT_SCALE     32.0
+
+//error returned by deinterleave_soft() for a symbol size that is not the
+//one of the modulation, over N_DATA_SUBCARRIERS subcarriers
+#define ERR_SOFT_INTERLEAVER    -1
+
+/**
+ * Soft demapper, i.e., the inverse of modulate(). For each subcarrier, it
+ * computes the log likelihood ratios of its n_bpsc bits with the max-log
+ * approximation, which for the Gray mapping of the standard is piecewise
+ * linear in the I and Q components. With components x normalized to the
+ * constellation step (e.g., +-1, +-3 for QAM16), the metrics are
+ *
+ *  - BPSK and QPSK: x
+ *  - QAM16: x and 2 - |x|
+ *  - QAM64: x, 4 - |x| and 2 - ||x| - 4|
+ *
+ * for the I bits first, and then for the Q bits. Each metric is weighted by
+ * the gain of the channel on the subcarrier, as the noise of an equalized
+ * subcarrier is inversely proportional to it, scaled, and quantized. The
+ * computation is branchless, so that the compiler can vectorize it across
+ * the subcarriers
+ *
+ * \param in equalized data subcarriers
+ * \param gain the squared magnitude of the channel response on each
+ * subcarrier. If NULL, all subcarriers have unit gain
+ * \param size number of subcarriers
+ * \param modulation modulation of the subcarriers
+ * \param scale scale of the soft bits (see DEMAP_DEFAULT_SCALE)
+ * \param out output soft bits. The array must have space for size times the
+ * number of bits per subcarrier of the modulation
+ */
+void demap_soft(const fftw_complex *in, const double *gain, int size, enum MODULATION_TYPE modulation, double scale,
+                signed char *out);
+
+/**
+ * Soft deinterleaver, i.e., the inverse of interleave() on soft bits. The
+ * permutation of each modulation is computed once, at the first call, and
+ * then applied through a table
+ *
+ * \param in soft bits, as given by demap_soft()
+ * \param out output soft bits. Must not overlap with in
+ * \param size number of soft bits. Must be a multiple of n_cbps
+ * \param n_cbps number of coded bits per OFDM symbol, N_DATA_SUBCARRIERS
+ * times n_bpsc
+ * \param n_bpsc number of coded bits per subcarrier, i.e., 1, 2, 4 or 6
+ * \return 0 on success, or ERR_SOFT_INTERLEAVER if the parameters are not
+ * the ones of a modulation of the standard
+ */
+int deinterleave_soft(const signed char *in, signed char *out, int size, int n_cbps, int n_bpsc);
+
+/**
+ * Soft depuncturer, i.e., the inverse of puncturing() on soft bits. The bits
+ * removed by puncturing are re-inserted as erasures (0), so that the output
+ * is at rate 1/2. The Viterbi decoder does the same on the fly, so this is
+ * only needed by consumers of rate 1/2 soft bits
+ *
+ * \param in soft bits, as given by deinterleave_soft()
+ * \param size number of soft bits
+ * \param rate coding rate of the input
+ * \param out output soft bits. Must not overlap with in, and must have space
+ * for size * 2 * r soft bits, where r is the coding rate
+ * \return the number of output soft bits
+ */
+int depuncture_soft(const signed char *in, int size, enum CODING_RATE rate, signed char *out);
+
+#endif
@@ -27,7 +27,8 @@
  * nanoseconds, which cannot be reached using gettimeofday(). Linux and Mac
  * systems have different calls for getting nanosecond resolution timers.
  * On Mac, we can use mach_absolute_time(), on linux we can use
- * clock_gettime(CLOCK_REALTIME)
+ * clock_gettime(). On x86 processors with an invariant TSC, the cycle
+ * counter can be used as well, which is the cheapest option
  */
 #ifdef __APPLE__
 #include <mach/mach_time.h>
@@ -37,10 +38,48 @@
 
 typedef unsigned long int nanotimer_t;
 
+/**
+ * Available timer backends
+ */
+enum TIMER_BACKEND {
+    //wall clock time: clock_gettime(CLOCK_REALTIME). jumps when the clock is adjusted (e.g., by NTP)
+    TIMER_REALTIME,
+    //clock_gettime(CLOCK_MONOTONIC_RAW): monotonic, not subject to NTP adjustments. this is the default
+    TIMER_MONOTONIC_RAW,
+    //x86 time stamp counter (rdtsc/rdtscp), calibrated against CLOCK_MONOTONIC_RAW
+    TIMER_TSC
+};
+
+//error returned when the requested timer backend is not supported by the system
+#define ERR_TIMER_NOT_SUPPORTED -1
+
+/**
+ * Selects the backend used by start_timer() and elapsed_nanosecond().
+ * The first time the TSC backend is selected, the frequency of the TSC is
+ * calibrated against CLOCK_MONOTONIC_RAW, which takes a few milliseconds.
+ * Timers started with one backend must not be used with another one, so
+ * the backend should be selected once at startup.
+ * On Mac, all backends use mach_absolute_time()
+ *
+ * \param backend the timer backend to use
+ * \return 0 on success, or ERR_TIMER_NOT_SUPPORTED if the backend is not
+ * available (e.g., TSC on a non x86 CPU or a CPU without an invariant TSC).
+ * In such a case, the current backend is left unchanged
+ */
+int set_timer_backend(enum TIMER_BACKEND backend);
+
+/**
+ * Returns the timer backend currently in use
+ *
+ * \return the timer backend
+ */
+enum TIMER_BACKEND get_timer_backend();
+
 /**
  * Starts a timer which can be used afterwards to compute elapsed time
  *
- * \return the started timer
+ * \return the started timer, i.e., the current time in nanoseconds
+ * from an arbitrary origin
  */
 nanotimer_t start_timer();
 
@@ -53,4 +92,13 @@ nanotimer_t start_timer();
  */
 nanotimer_t elapsed_nanosecond(nanotimer_t timer);
 
+/**
+ * Measures the overhead of the current timer backend, i.e., the average time
+ * needed by a start_timer() followed by an elapsed_nanosecond()
+ *
+ * \param iterations number of measurements to average
+ * \return the average overhead in nanoseconds
+ */
+double measure_timer_overhead(int iterations);
+
 #endif
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: soft decision Viterbi decoder for the 802.11 convolutional code
+ *
+ */
+
+#ifndef _VITERBI_UTILS_H_
+#define _VITERBI_UTILS_H_
+
+#include "ofdm_utils.h"
+
+/**
+ * The decoder works on the K=7 code with generator polynomials 133 and 171
+ * (octal) used by convolutional_encoding(), which has 64 states.
+ *
+ * Soft inputs are signed 8 bit values: positive values stand for a coded
+ * bit equal to 1, negative ones for a 0, and the magnitude is the confidence
+ * (127 is the strongest). A value of 0 is an erasure, and it is what the
+ * decoder inserts at the positions removed by puncturing().
+ *
+ * Decisions are kept for the last VITERBI_RING trellis steps only: every
+ * VITERBI_BLOCK steps, the decoder traces back VITERBI_TRACEBACK +
+ * VITERBI_BLOCK steps from the best state, and outputs the oldest
+ * VITERBI_BLOCK bits. Memory does not depend on the size of the frame.
+ *
+ * The streaming decoder keeps 8 bit path metrics, so that a 256 bit register
+ * holds the metrics of 32 states. Soft values are rounded to
+ * VITERBI_SOFT_SHIFT fewer bits and clipped to +-VITERBI_SOFT_MAX, so that a
+ * branch metric is within +-2 VITERBI_SOFT_MAX. Every VITERBI_PHASES steps,
+ * the metrics are re-normalized so that the best one is
+ * VITERBI_METRIC_TARGET, which leaves room for the growth until the next
+ * re-normalization. Additions saturate, so the metrics of hopeless paths
+ * stick at -128
+ */
+#define VITERBI_STATES              64
+#define VITERBI_TRACEBACK           96
+#define VITERBI_BLOCK               256
+#define VITERBI_RING                1024
+#define VITERBI_SOFT_SHIFT          3
+#define VITERBI_SOFT_MAX            8
+#define VITERBI_PHASES              5
+#define VITERBI_METRIC_TARGET       (127 - 2 * VITERBI_SOFT_MAX * VITERBI_PHASES)
+//16 bit path metrics of the batched decoder are re-normalized every VITERBI_RENORM_INTERVAL steps
+#define VITERBI_RENORM_INTERVAL     32
+//number of frames decoded together by viterbi_decode_batch()
+#define VITERBI_LANES               16
+//number of bits of the SIGNAL field, decoded by viterbi_decode_signal()
+#define VITERBI_SIGNAL_BITS         24
+
+/**
+ * Implementations of the add-compare-select step. All of them give exactly
+ * the same results
+ */
+enum VITERBI_BACKEND {
+    VITERBI_SCALAR,
+    //16 states per instruction
+    VITERBI_SSE2,
+    //32 states per instruction
+    VITERBI_AVX2
+};
+static const char* STR_VITERBI_BACKEND[] = {
+	"scalar",
+	"sse2",
+	"avx2"
+};
+
+//error returned when the requested backend is not supported by the cpu
+#define ERR_VITERBI_NOT_SUPPORTED -1
+
+/**
+ * State of a streaming Viterbi decoder
+ */
+struct VITERBI_DECODER {
+	//path metrics of the 64 states, in the order of the registers of the
+	//add-compare-select, which changes with the phase of the next step
+	signed char metrics[VITERBI_STATES];
+	//decisions of the last VITERBI_RING steps, one bit per state
+	unsigned long long decisions[VITERBI_RING];
+	//coding rate, i.e., puncturing pattern of the input
+	enum CODING_RATE rate;
+	//position within the puncturing pattern
+	int phase;
+	//first soft value of a step whose second value has not been received yet
+	int has_y0;
+	short y0;
+	//number of trellis steps done and number of bits output
+	unsigned long long steps, decoded;
+};
+
+/**
+ * Selects the implementation used by the decoders. By default, the fastest
+ * one supported by the cpu is used
+ *
+ * \param backend the backend to use
+ * \return 0 on success, or ERR_VITERBI_NOT_SUPPORTED if the backend is not
+ * supported by the cpu or by the compiler. The current backend is left
+ * unchanged in such a case
+ */
+int set_viterbi_backend(enum VITERBI_BACKEND backend);
+
+/**
+ * Returns the implementation currently used by the decoders
+ */
+enum VITERBI_BACKEND get_viterbi_backend();
+
+/**
+ * Initializes a decoder. The encoder is assumed to start in the zero state
+ *
+ * \param v the decoder
+ * \param rate coding rate of the input soft bits
+ */
+void init_viterbi_decoder(struct VITERBI_DECODER *v, enum CODING_RATE rate);
+
+/**
+ * Feeds soft bits to the decoder. Punctured positions are re-inserted as
+ * erasures on the fly, so the input is what comes out of the deinterleaver.
+ * The input can be split in chunks of any size
+ *
+ * \param v the decoder
+ * \param soft soft bits
+ * \param size number of soft bits
+ * \param out the output array for the whole frame. Decoded bits are written
+ * packed, the first one in the most significant bit of out[0], and each
+ * call continues from where the previous one stopped. The array must have
+ * space for the number of trellis steps, i.e., decoded bits, of the whole
+ * input
+ * \return the total number of bits written into out so far
+ */
+int viterbi_decoder_push(struct VITERBI_DECODER *v, const signed char *soft, int size, char *out);
+
+/**
+ * Completes the decoding, tracing back from the last step and writing the
+ * remaining bits
+ *
+ * \param v the decoder
+ * \param terminated if not 0, the encoder is known to end in the zero state
+ * (e.g., the SIGNAL field, which ends with the tail bits). Otherwise, the
+ * best state is used (e.g., the DATA field, where pad bits follow the tail)
+ * \param out the output array given to viterbi_decoder_push()
+ * \return the total number of bits written into out
+ */
+int viterbi_decoder_finish(struct VITERBI_DECODER *v, int terminated, char *out);
+
+/**
+ * Writes the bits that can already be decided, i.e., all but the ones of the
+ * last VITERBI_TRACEBACK steps, tracing back from the best state. The state
+ * of the decoder is not changed, so this can be used to inspect the
+ * beginning of a frame (e.g., its MAC header) before it has been completely
+ * received. The bits written only by this function are overwritten by the
+ * following calls to viterbi_decoder_push() and viterbi_decoder_finish()
+ *
+ * \param v the decoder
+ * \param out the output array given to viterbi_decoder_push()
+ * \return the number of bits available in out
+ */
+int viterbi_decoder_peek(struct VITERBI_DECODER *v, char *out);
+
+/**
+ * Decodes a whole block of soft bits
+ *
+ * \param soft soft bits
+ * \param size number of soft bits
+ * \param rate coding rate of the input soft bits
+ * \param terminated whether the encoder ends in the zero state (see
+ * viterbi_decoder_finish())
+ * \param out array where to store the decoded bits, packed
+ * \return the number of decoded bits
+ */
+int viterbi_decode(const signed char *soft, int size, enum CODING_RATE rate, int terminated, char *out);
+
+/**
+ * Decodes a batch of frames with the same coding rate and the same number of
+ * soft bits, e.g., the frames of a Monte Carlo simulation. Each frame goes
+ * into a lane of the SIMD registers, VITERBI_LANES frames at a time, so even
+ * short frames use the full width of the vectors. Decisions are kept for the
+ * whole frame: memory is 128 bytes per decoded bit, independent of the number
+ * of frames. The result is the one of a full traceback from the last step,
+ * and it is the same for every backend
+ *
+ * \param soft the soft bits of each frame
+ * \param n_frames number of frames
+ * \param size number of soft bits of each frame
+ * \param rate coding rate of the input soft bits
+ * \param terminated whether the encoders end in the zero state (see
+ * viterbi_decoder_finish())
+ * \param out array where to store the decoded bits of each frame, packed
+ * \return the number of decoded bits of each frame
+ */
+int viterbi_decode_batch(const signed char **soft, int n_frames, int size, enum CODING_RATE rate, int terminated,
+                         char **out);
+
+/**
+ * Decodes the SIGNAL field, i.e., VITERBI_SIGNAL_BITS bits at rate 1/2 whose
+ * last 6 bits are the tail that brings the encoder back to the zero state.
+ * This is a specialized version of viterbi_decode(), which keeps the
+ * decisions of the few steps on the stack and traces back once from the
+ * zero state, so that it can be run on every detected frame
+ *
+ * \param soft the 2 * VITERBI_SIGNAL_BITS soft bits of the field
+ * \param out array where to store the VITERBI_SIGNAL_BITS decoded bits, packed
+ * \return the number of decoded bits
+ */
+int viterbi_decode_signal(const signed char *soft, char *out);
+
+#endif
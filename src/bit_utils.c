@@ -330,6 +330,42 @@ int read_hex_from_file(const char *filename, char *bytes, int size) {
 
 }
 
+int read_complex_from_file(const char *filename, fftw_complex *samples, int size) {
+
+	//number of read samples
+	int samples_read = 0;
+	//line read from the file
+	char line[256];
+	//index of the sample (ignored)
+	long index;
+	//file to be read
+	FILE *f = fopen(filename, "r");
+
+	if (!f) {
+		return ERR_CANNOT_READ_FILE;
+	}
+
+	while (samples_read < size && fgets(line, sizeof(line), f)) {
+
+		//skip comments and empty lines
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+
+		if (sscanf(line, "%ld %lf %lf", &index, &samples[samples_read][0], &samples[samples_read][1]) != 3) {
+			fclose(f);
+			return ERR_INVALID_FORMAT;
+		}
+		samples_read++;
+
+	}
+
+	fclose(f);
+
+	return samples_read;
+
+}
+
 char get_bit_group_value(const char *bytes, int size, int a, int length) {
 
 	//index for getting bits
@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: memory mapped access to raw sample captures
+ *
+ */
+
+//captures can be larger than 2 GB on 32 bit hosts as well
+#define _FILE_OFFSET_BITS 64
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "capture_utils.h"
+#include "bit_utils.h"
+
+//scale of sc16 samples
+#define SC16_SCALE (1.0f / 32768)
+
+/**
+ * Events found in a chunk of a capture
+ */
+struct CHUNK_EVENTS {
+	struct DETECTION_EVENT *events;
+	int n_events;
+	int capacity;
+};
+
+/**
+ * State shared by the threads scanning a capture
+ */
+struct CAPTURE_SCAN {
+	const struct CAPTURE *capture;
+	int chunk_size;
+	float threshold;
+	int n_chunks;
+	//next chunk to be scanned
+	int next;
+	pthread_mutex_t mutex;
+	struct CHUNK_EVENTS *chunks;
+};
+
+/**
+ * Returns the size in bytes of a sample of the given format
+ */
+static size_t sample_size(enum CAPTURE_FORMAT format) {
+	return format == CAPTURE_SC16 ? sizeof(sample_sc16_t) : sizeof(sample_cf32_t);
+}
+
+int open_capture(struct CAPTURE *c, const char *filename, enum CAPTURE_FORMAT format) {
+
+	struct stat st;
+	void *data;
+
+	c->fd = open(filename, O_RDONLY);
+	if (c->fd < 0) {
+		return ERR_CANNOT_READ_FILE;
+	}
+	if (fstat(c->fd, &st) != 0) {
+		close(c->fd);
+		return ERR_CANNOT_READ_FILE;
+	}
+	if (st.st_size % sample_size(format) != 0) {
+		close(c->fd);
+		return ERR_INVALID_FORMAT;
+	}
+
+	c->format = format;
+	c->size = (size_t)st.st_size;
+	c->n_samples = (long long)(st.st_size / sample_size(format));
+	c->data = NULL;
+	if (c->size == 0) {
+		return 0;
+	}
+
+	data = mmap(NULL, c->size, PROT_READ, MAP_PRIVATE, c->fd, 0);
+	if (data == MAP_FAILED) {
+		close(c->fd);
+		return ERR_CANNOT_READ_FILE;
+	}
+	//chunks are read front to back, let the kernel read ahead
+	madvise(data, c->size, MADV_SEQUENTIAL);
+	c->data = data;
+
+	return 0;
+
+}
+
+void close_capture(struct CAPTURE *c) {
+	if (c->data != NULL) {
+		munmap((void *)c->data, c->size);
+	}
+	close(c->fd);
+}
+
+int read_capture_samples(const struct CAPTURE *c, long long offset, int size, fftw_complex *samples) {
+
+	int i;
+
+	if (offset >= c->n_samples) {
+		return 0;
+	}
+	if (offset + size > c->n_samples) {
+		size = (int)(c->n_samples - offset);
+	}
+
+	if (c->format == CAPTURE_SC16) {
+		const sample_sc16_t *in = (const sample_sc16_t *)c->data + offset;
+		for (i = 0; i < size; i++) {
+			samples[i][0] = in[i][0] * SC16_SCALE;
+			samples[i][1] = in[i][1] * SC16_SCALE;
+		}
+	}
+	else {
+		const sample_cf32_t *in = (const sample_cf32_t *)c->data + offset;
+		for (i = 0; i < size; i++) {
+			samples[i][0] = in[i][0];
+			samples[i][1] = in[i][1];
+		}
+	}
+
+	return size;
+
+}
+
+/**
+ * Appends the events of a block to the ones of a chunk, keeping only the
+ * ones at or after the given sample
+ */
+static void add_chunk_events(struct CHUNK_EVENTS *chunk, const struct DETECTION_EVENT *events, int n_events,
+                             long long first) {
+	int i;
+	for (i = 0; i < n_events; i++) {
+		if (events[i].sample < first) {
+			continue;
+		}
+		if (chunk->n_events == chunk->capacity) {
+			chunk->capacity = chunk->capacity == 0 ? 64 : 2 * chunk->capacity;
+			chunk->events = (struct DETECTION_EVENT *)realloc(chunk->events,
+			                                                  sizeof(struct DETECTION_EVENT) * chunk->capacity);
+		}
+		chunk->events[chunk->n_events++] = events[i];
+	}
+}
+
+/**
+ * Scans a chunk of the capture, from CAPTURE_OVERLAP samples before its
+ * beginning to CAPTURE_LOOKAHEAD samples after its end
+ */
+static void scan_chunk(struct CAPTURE_SCAN *s, int index, struct SHORT_TRAINING_DETECTOR_S16 *detector_s16) {
+
+	const struct CAPTURE *c = s->capture;
+	struct SHORT_TRAINING_DETECTOR_F detector;
+	//a block cannot generate more events than this
+	struct DETECTION_EVENT events[CAPTURE_BLOCK_SIZE / SC_HOLDOFF + 1];
+	long long chunk_start, chunk_end, first, start, end, pos;
+	int size, n_events, i;
+
+	chunk_start = (long long)index * s->chunk_size;
+	chunk_end = chunk_start + s->chunk_size;
+	start = chunk_start - CAPTURE_OVERLAP > 0 ? chunk_start - CAPTURE_OVERLAP : 0;
+	end = chunk_end + CAPTURE_LOOKAHEAD < c->n_samples ? chunk_end + CAPTURE_LOOKAHEAD : c->n_samples;
+	//the first chunk keeps the events reported before the first sample, as a
+	//single detector does
+	first = index == 0 ? -SC_WINDOW - SC_DELAY : chunk_start;
+
+	init_short_training_detector_f(&detector);
+	init_short_training_detector_s16(detector_s16);
+	for (pos = start; pos < end; pos += size) {
+		size = end - pos < CAPTURE_BLOCK_SIZE ? (int)(end - pos) : CAPTURE_BLOCK_SIZE;
+		//sc16 samples are scanned as they are, in fixed point
+		if (c->format == CAPTURE_SC16) {
+			n_events = detect_short_training_events_s16(detector_s16, (const sample_sc16_t *)c->data + pos, size,
+			                                            s->threshold, events, CAPTURE_BLOCK_SIZE / SC_HOLDOFF + 1);
+		}
+		else {
+			n_events = detect_short_training_events_f(&detector, (const sample_cf32_t *)c->data + pos, size,
+			                                          s->threshold, events, CAPTURE_BLOCK_SIZE / SC_HOLDOFF + 1);
+		}
+		//event indexes are relative to the beginning of the scan, and the
+		//events of the lookahead belong to the next chunk
+		for (i = 0; i < n_events; i++) {
+			events[i].sample += start;
+		}
+		while (n_events > 0 && events[n_events - 1].sample >= chunk_end) {
+			n_events--;
+		}
+		add_chunk_events(&s->chunks[index], events, n_events, first);
+	}
+
+}
+
+/**
+ * Main loop of a scan thread: scans the next chunk not taken yet, until all
+ * of them have been scanned
+ */
+static void *scan_worker(void *arg) {
+
+	struct CAPTURE_SCAN *s = (struct CAPTURE_SCAN *)arg;
+	struct SHORT_TRAINING_DETECTOR_S16 detector_s16;
+	int index;
+
+	while (1) {
+		pthread_mutex_lock(&s->mutex);
+		index = s->next++;
+		pthread_mutex_unlock(&s->mutex);
+		if (index >= s->n_chunks) {
+			break;
+		}
+		scan_chunk(s, index, &detector_s16);
+	}
+
+	return NULL;
+
+}
+
+/**
+ * Concatenates the events of the chunks, dropping the ones that a single
+ * detector would not have generated because of the hold-off
+ */
+static long long merge_chunk_events(struct CAPTURE_SCAN *s, struct DETECTION_EVENT **events) {
+
+	long long n = 0;
+	int i, j;
+
+	for (i = 0; i < s->n_chunks; i++) {
+		n += s->chunks[i].n_events;
+	}
+	*events = (struct DETECTION_EVENT *)malloc(sizeof(struct DETECTION_EVENT) * (n > 0 ? n : 1));
+
+	n = 0;
+	for (i = 0; i < s->n_chunks; i++) {
+		for (j = 0; j < s->chunks[i].n_events; j++) {
+			if (j == 0 && n > 0 && s->chunks[i].events[0].sample <= (*events)[n - 1].sample + SC_HOLDOFF) {
+				continue;
+			}
+			(*events)[n++] = s->chunks[i].events[j];
+		}
+		free(s->chunks[i].events);
+	}
+
+	return n;
+
+}
+
+long long scan_capture(const struct CAPTURE *c, int n_threads, int chunk_size, double threshold,
+                       struct DETECTION_EVENT **events) {
+
+	struct CAPTURE_SCAN s;
+	pthread_t threads[CAPTURE_MAX_THREADS];
+	long long n_chunks, n_events;
+	int i, started;
+
+	if (n_threads < 0 || n_threads > CAPTURE_MAX_THREADS) {
+		return ERR_CAPTURE_THREADS;
+	}
+	//the chunks are counted dividing by their size, once rounded up
+	if (chunk_size <= 0 || chunk_size > CAPTURE_CHUNK_SIZE_MAX) {
+		return ERR_CAPTURE_CHUNK_SIZE;
+	}
+
+	chunk_size = (chunk_size + SC_RESYNC_INTERVAL - 1) / SC_RESYNC_INTERVAL * SC_RESYNC_INTERVAL;
+	n_chunks = (c->n_samples + chunk_size - 1) / chunk_size;
+	s.capture = c;
+	s.chunk_size = chunk_size;
+	s.threshold = (float)threshold;
+	s.n_chunks = (int)n_chunks;
+	s.next = 0;
+	s.chunks = (struct CHUNK_EVENTS *)calloc(n_chunks > 0 ? n_chunks : 1, sizeof(struct CHUNK_EVENTS));
+	pthread_mutex_init(&s.mutex, NULL);
+
+	//the calling thread scans as well. If a thread cannot be created, the
+	//other ones scan its chunks
+	for (started = 0; started < n_threads - 1; started++) {
+		if (pthread_create(&threads[started], NULL, scan_worker, &s) != 0) {
+			break;
+		}
+	}
+	scan_worker(&s);
+	for (i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	pthread_mutex_destroy(&s.mutex);
+
+	n_events = merge_chunk_events(&s, events);
+	free(s.chunks);
+	return n_events;
+
+}
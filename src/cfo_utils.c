@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: carrier frequency offset estimation and correction
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "cfo_utils.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_X86_SIMD
+#endif
+
+/**
+ * Rotates the samples by the given rotations. The loop is branchless and
+ * the rotations are stored as separate real and imaginary parts, so that the
+ * compiler can vectorize it. It is instantiated once for the baseline
+ * instruction set and once for AVX2
+ */
+static inline __attribute__((always_inline)) void rotate_body(const double *rotation_re, const double *rotation_im,
+                                                              const fftw_complex *in, fftw_complex *out, int size) {
+	int k;
+	double re, im;
+	for (k = 0; k < size; k++) {
+		re = in[k][0];
+		im = in[k][1];
+		out[k][0] = re * rotation_re[k] - im * rotation_im[k];
+		out[k][1] = re * rotation_im[k] + im * rotation_re[k];
+	}
+}
+
+static void rotate_scalar(const double *rotation_re, const double *rotation_im, const fftw_complex *in,
+                          fftw_complex *out, int size) {
+	rotate_body(rotation_re, rotation_im, in, out, size);
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2")))
+static void rotate_avx2(const double *rotation_re, const double *rotation_im, const fftw_complex *in,
+                        fftw_complex *out, int size) {
+	rotate_body(rotation_re, rotation_im, in, out, size);
+}
+#endif
+
+/**
+ * Rotation function used by derotate(), selected at the first call
+ */
+static void (*rotate)(const double *, const double *, const fftw_complex *, fftw_complex *, int) = NULL;
+
+/**
+ * Returns the phase of the sum of r(n + delay) r*(n), divided by the delay
+ */
+static double delayed_correlation_phase(const fftw_complex *samples, int size, int delay) {
+
+	double re = 0, im = 0;
+	int n;
+
+	for (n = 0; n < size - delay; n++) {
+		re += samples[n + delay][0] * samples[n][0] + samples[n + delay][1] * samples[n][1];
+		im += samples[n + delay][1] * samples[n][0] - samples[n + delay][0] * samples[n][1];
+	}
+
+	return atan2(im, re) / delay;
+
+}
+
+double estimate_coarse_cfo(const fftw_complex *samples, int size) {
+	return delayed_correlation_phase(samples, size, CFO_SHORT_DELAY);
+}
+
+double get_short_training_cfo(const struct SHORT_TRAINING_DETECTOR *d) {
+	//the detector sums r(n) r*(n - SC_DELAY)
+	return atan2(d->p[1], d->p[0]) / SC_DELAY;
+}
+
+double estimate_fine_cfo(const fftw_complex *samples) {
+	return delayed_correlation_phase(samples, 2 * CFO_LONG_DELAY, CFO_LONG_DELAY);
+}
+
+/**
+ * Computes the rotations of the current block, from the phase of its first
+ * sample
+ */
+static void update_rotations(struct NCO *nco) {
+
+	int k;
+	double c = cos(nco->phase), s = -sin(nco->phase);
+
+	for (k = 0; k < NCO_BLOCK; k++) {
+		nco->rotation_re[k] = nco->table_re[k] * c - nco->table_im[k] * s;
+		nco->rotation_im[k] = nco->table_re[k] * s + nco->table_im[k] * c;
+	}
+
+}
+
+void init_nco(struct NCO *nco, double frequency) {
+
+	if (rotate == NULL) {
+		rotate = rotate_scalar;
+#ifdef HAVE_X86_SIMD
+		if (__builtin_cpu_supports("avx2")) {
+			rotate = rotate_avx2;
+		}
+#endif
+	}
+
+	memset(nco, 0, sizeof(struct NCO));
+	set_nco_frequency(nco, frequency);
+
+}
+
+void set_nco_frequency(struct NCO *nco, double frequency) {
+
+	int k;
+
+	//move the start of the block to the next sample, so that the phase of
+	//the samples already rotated is not changed
+	nco->phase = fmod(nco->phase + nco->frequency * nco->offset, 2 * M_PI);
+	nco->frequency = frequency;
+	nco->offset = 0;
+
+	for (k = 0; k < NCO_BLOCK; k++) {
+		nco->table_re[k] = cos(frequency * k);
+		nco->table_im[k] = -sin(frequency * k);
+	}
+	update_rotations(nco);
+
+}
+
+void derotate(struct NCO *nco, const fftw_complex *in, fftw_complex *out, int size) {
+
+	int done = 0, n;
+
+	while (done < size) {
+		n = NCO_BLOCK - nco->offset;
+		if (n > size - done) {
+			n = size - done;
+		}
+		rotate(&nco->rotation_re[nco->offset], &nco->rotation_im[nco->offset], &in[done], &out[done], n);
+		done += n;
+		nco->offset += n;
+		if (nco->offset == NCO_BLOCK) {
+			//the phase is kept within one turn, so that it does not lose precision
+			nco->phase = fmod(nco->phase + nco->frequency * NCO_BLOCK, 2 * M_PI);
+			nco->offset = 0;
+			update_rotations(nco);
+		}
+	}
+
+}
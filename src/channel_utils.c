@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: channel estimation and equalization from the long training sequence
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "channel_utils.h"
+
+/**
+ * Positions of the pilots in arrays of subcarriers from -26 to 26 (see
+ * insert_pilots())
+ */
+static const int pilot_index[N_PILOT_SUBCARRIERS] = {5, 19, 33, 47};
+
+/**
+ * Subcarrier index of the pilots, and sum of their squares, for the least
+ * squares fit of the phase slope
+ */
+static const int pilot_subcarrier[N_PILOT_SUBCARRIERS] = {-21, -7, 7, 21};
+#define PILOT_SUBCARRIER_ENERGY (2 * (21 * 21 + 7 * 7))
+//sign of each pilot, to be multiplied by the polarity of the symbol
+static const double pilot_sign[N_PILOT_SUBCARRIERS] = {1, 1, 1, -1};
+
+/**
+ * Positions of the data subcarriers in arrays of subcarriers from -26 to 26
+ */
+static const int data_index[N_DATA_SUBCARRIERS] = {
+	0, 1, 2, 3, 4, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 20, 21, 22, 23, 24, 25,
+	27, 28, 29, 30, 31, 32, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 48, 49, 50, 51, 52
+};
+
+void init_ofdm_demodulator(struct OFDM_DEMODULATOR *d) {
+	d->in = fftw_alloc_complex(FFT_SIZE);
+	d->out = fftw_alloc_complex(FFT_SIZE);
+	d->fft = fftw_plan_dft_1d(FFT_SIZE, d->in, d->out, FFTW_FORWARD, FFTW_MEASURE);
+}
+
+void free_ofdm_demodulator(struct OFDM_DEMODULATOR *d) {
+	fftw_destroy_plan(d->fft);
+	fftw_free(d->in);
+	fftw_free(d->out);
+}
+
+void demodulate_symbol(struct OFDM_DEMODULATOR *d, const fftw_complex *samples, fftw_complex *out) {
+
+	int i;
+
+	memcpy(d->in, samples, sizeof(fftw_complex) * FFT_SIZE);
+	fftw_execute(d->fft);
+
+	//the transmitter normalizes the IFFT output by 1 / FFT_SIZE, so the
+	//forward FFT gives back the subcarriers with no further scaling.
+	//FFT bins 38 to 63 are subcarriers -26 to -1, 0 to 26 are 0 to 26
+	for (i = 0; i < 26; i++) {
+		out[i][0] = d->out[i + 38][0];
+		out[i][1] = d->out[i + 38][1];
+	}
+	for (i = 26; i < N_TOTAL_SUBCARRIERS; i++) {
+		out[i][0] = d->out[i - 26][0];
+		out[i][1] = d->out[i - 26][1];
+	}
+
+}
+
+void estimate_channel(struct OFDM_DEMODULATOR *d, const fftw_complex *samples, int smoothing,
+                      struct CHANNEL_ESTIMATE *ch) {
+
+	fftw_complex y1[N_TOTAL_SUBCARRIERS], y2[N_TOTAL_SUBCARRIERS];
+	//channel response of the used subcarriers only, before smoothing
+	fftw_complex raw[N_USED_SUBCARRIERS];
+	double noise = 0, power = 0, re, im, p;
+	int i, k, n, from, to;
+
+	demodulate_symbol(d, samples, y1);
+	demodulate_symbol(d, &samples[FFT_SIZE], y2);
+
+	n = 0;
+	for (k = 0; k < N_TOTAL_SUBCARRIERS; k++) {
+		if (k == DC_SUBCARRIER) {
+			continue;
+		}
+		//the long training subcarriers are +-1, so dividing is multiplying
+		raw[n][0] = (y1[k][0] + y2[k][0]) * 0.5 * freq_long_symbol[k][0];
+		raw[n][1] = (y1[k][1] + y2[k][1]) * 0.5 * freq_long_symbol[k][0];
+		//the channel is the same on the two symbols, the noise is not
+		re = y1[k][0] - y2[k][0];
+		im = y1[k][1] - y2[k][1];
+		noise += re * re + im * im;
+		n++;
+	}
+
+	n = 0;
+	for (k = 0; k < N_TOTAL_SUBCARRIERS; k++) {
+		if (k == DC_SUBCARRIER) {
+			ch->h[k][0] = 0;
+			ch->h[k][1] = 0;
+			continue;
+		}
+		from = n - smoothing < 0 ? 0 : n - smoothing;
+		to = n + smoothing >= N_USED_SUBCARRIERS ? N_USED_SUBCARRIERS - 1 : n + smoothing;
+		re = 0;
+		im = 0;
+		for (i = from; i <= to; i++) {
+			re += raw[i][0];
+			im += raw[i][1];
+		}
+		ch->h[k][0] = re / (to - from + 1);
+		ch->h[k][1] = im / (to - from + 1);
+		n++;
+	}
+
+	//one-tap equalizer, and power of the channel
+	for (k = 0; k < N_TOTAL_SUBCARRIERS; k++) {
+		p = ch->h[k][0] * ch->h[k][0] + ch->h[k][1] * ch->h[k][1];
+		if (p > 0) {
+			ch->eq_re[k] = ch->h[k][0] / p;
+			ch->eq_im[k] = -ch->h[k][1] / p;
+		}
+		else {
+			ch->eq_re[k] = 0;
+			ch->eq_im[k] = 0;
+		}
+		power += p;
+	}
+	power /= N_USED_SUBCARRIERS;
+
+	for (i = 0; i < N_DATA_SUBCARRIERS; i++) {
+		k = data_index[i];
+		p = ch->h[k][0] * ch->h[k][0] + ch->h[k][1] * ch->h[k][1];
+		ch->data_gain[i] = power > 0 ? p / power : 0;
+	}
+
+	//y1 - y2 has twice the noise power of a symbol, while the average of the
+	//two symbols has half of it, which has to be removed from the signal
+	ch->noise_power = noise / (2 * N_USED_SUBCARRIERS);
+	ch->signal_power = power - ch->noise_power / 2;
+	if (ch->signal_power < 0) {
+		ch->signal_power = 0;
+	}
+	if (ch->noise_power > 0 && ch->signal_power > 0) {
+		ch->snr = 10 * log10(ch->signal_power / ch->noise_power);
+		if (ch->snr > CHANNEL_MAX_SNR) {
+			ch->snr = CHANNEL_MAX_SNR;
+		}
+	}
+	else {
+		ch->snr = ch->noise_power > 0 ? -CHANNEL_MAX_SNR : CHANNEL_MAX_SNR;
+	}
+
+}
+
+/**
+ * Multiplies each subcarrier by its coefficient. The loop is branchless, so
+ * that the compiler can vectorize it
+ */
+static inline void apply_equalizer(const double *w_re, const double *w_im, const fftw_complex *in, fftw_complex *out) {
+
+	int k;
+	double re, im;
+
+	for (k = 0; k < N_TOTAL_SUBCARRIERS; k++) {
+		re = in[k][0];
+		im = in[k][1];
+		out[k][0] = re * w_re[k] - im * w_im[k];
+		out[k][1] = re * w_im[k] + im * w_re[k];
+	}
+
+}
+
+void equalize_symbol(const struct CHANNEL_ESTIMATE *ch, const fftw_complex *in, fftw_complex *out) {
+	//the DC subcarrier has a null equalizer, so it is set to 0
+	apply_equalizer(ch->eq_re, ch->eq_im, in, out);
+}
+
+void equalize_symbol_with_pilots(const struct CHANNEL_ESTIMATE *ch, const fftw_complex *in, int symbol_index,
+                                 int track_slope, fftw_complex *out, double *phase, double *slope) {
+
+	double polarity = subcarrier_polarities[symbol_index % N_PILOT_POLARITIES];
+	double z_re[N_PILOT_SUBCARRIERS], z_im[N_PILOT_SUBCARRIERS];
+	double re = 0, im = 0, theta, alpha = 0, c, s;
+	double r_re, r_im, step_re, step_im, t;
+	double w_re[N_TOTAL_SUBCARRIERS], w_im[N_TOTAL_SUBCARRIERS];
+	int i, k;
+
+	//each pilot times the conjugate of its channel response and of its
+	//expected value, so that pilots are weighted by the channel power
+	for (i = 0; i < N_PILOT_SUBCARRIERS; i++) {
+		k = pilot_index[i];
+		z_re[i] = (in[k][0] * ch->h[k][0] + in[k][1] * ch->h[k][1]) * pilot_sign[i] * polarity;
+		z_im[i] = (in[k][1] * ch->h[k][0] - in[k][0] * ch->h[k][1]) * pilot_sign[i] * polarity;
+		re += z_re[i];
+		im += z_im[i];
+	}
+	theta = atan2(im, re);
+
+	//least squares fit of the phase of each pilot, relative to the common one
+	if (track_slope) {
+		c = cos(theta);
+		s = sin(theta);
+		for (i = 0; i < N_PILOT_SUBCARRIERS; i++) {
+			alpha += pilot_subcarrier[i] * atan2(z_im[i] * c - z_re[i] * s, z_re[i] * c + z_im[i] * s);
+		}
+		alpha /= PILOT_SUBCARRIER_ENERGY;
+	}
+
+	//coefficients rotated by -(theta + alpha * subcarrier), starting from subcarrier -26
+	r_re = cos(theta - 26 * alpha);
+	r_im = -sin(theta - 26 * alpha);
+	step_re = cos(alpha);
+	step_im = -sin(alpha);
+	for (k = 0; k < N_TOTAL_SUBCARRIERS; k++) {
+		w_re[k] = ch->eq_re[k] * r_re - ch->eq_im[k] * r_im;
+		w_im[k] = ch->eq_re[k] * r_im + ch->eq_im[k] * r_re;
+		t = r_re * step_re - r_im * step_im;
+		r_im = r_re * step_im + r_im * step_re;
+		r_re = t;
+	}
+
+	apply_equalizer(w_re, w_im, in, out);
+
+	if (phase) {
+		*phase = theta;
+	}
+	if (slope) {
+		*slope = alpha;
+	}
+
+}
+
+void extract_data_subcarriers(const fftw_complex *in, fftw_complex *data, fftw_complex *pilots) {
+
+	int i;
+
+	for (i = 0; i < N_DATA_SUBCARRIERS; i++) {
+		data[i][0] = in[data_index[i]][0];
+		data[i][1] = in[data_index[i]][1];
+	}
+	if (pilots) {
+		for (i = 0; i < N_PILOT_SUBCARRIERS; i++) {
+			pilots[i][0] = in[pilot_index[i]][0];
+			pilots[i][1] = in[pilot_index[i]][1];
+		}
+	}
+
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: conditioning of the received samples before detection
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "conditioning_utils.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_X86_SIMD
+#endif
+
+/**
+ * Conditions a single sample, which is at the given lane of the partial sums
+ */
+static inline __attribute__((always_inline)) void condition_sample(struct SIGNAL_CONDITIONER *c,
+                                                                   const sample_cf32_t in, sample_cf32_t out,
+                                                                   int lane) {
+	float re = in[0] - c->dc_re, im = in[1] - c->dc_im, q;
+	q = c->iq_a * im + c->iq_b * re;
+	c->sum_re[lane] += re;
+	c->sum_im[lane] += im;
+	c->sum_ii[lane] += re * re;
+	c->sum_qq[lane] += im * im;
+	c->sum_iq[lane] += re * im;
+	c->sum_p[lane] += re * re + q * q;
+	out[0] = re * c->gain;
+	out[1] = q * c->gain;
+}
+
+/**
+ * Conditions groups of COND_LANES samples, starting from the first lane of
+ * the partial sums. The corrections and the partial sums are kept in local
+ * variables and the loop is branchless, so that the compiler can vectorize
+ * it, with one vector for each partial sum. Each partial sum is updated in
+ * the order of the samples, so the result is the one of condition_sample().
+ * It is instantiated once for the baseline instruction set and once for AVX2
+ */
+static inline __attribute__((always_inline)) void condition_groups_body(struct SIGNAL_CONDITIONER *c,
+                                                                        const sample_cf32_t *in,
+                                                                        sample_cf32_t *out, int n_groups) {
+	float sum_re[COND_LANES], sum_im[COND_LANES], sum_ii[COND_LANES], sum_qq[COND_LANES], sum_iq[COND_LANES];
+	float sum_p[COND_LANES];
+	float dc_re = c->dc_re, dc_im = c->dc_im, a = c->iq_a, b = c->iq_b, gain = c->gain;
+	float re, im, q;
+	int k, j;
+
+	memcpy(sum_re, c->sum_re, sizeof(sum_re));
+	memcpy(sum_im, c->sum_im, sizeof(sum_im));
+	memcpy(sum_ii, c->sum_ii, sizeof(sum_ii));
+	memcpy(sum_qq, c->sum_qq, sizeof(sum_qq));
+	memcpy(sum_iq, c->sum_iq, sizeof(sum_iq));
+	memcpy(sum_p, c->sum_p, sizeof(sum_p));
+
+	for (k = 0; k < n_groups * COND_LANES; k += COND_LANES) {
+		for (j = 0; j < COND_LANES; j++) {
+			re = in[k + j][0] - dc_re;
+			im = in[k + j][1] - dc_im;
+			q = a * im + b * re;
+			sum_re[j] += re;
+			sum_im[j] += im;
+			sum_ii[j] += re * re;
+			sum_qq[j] += im * im;
+			sum_iq[j] += re * im;
+			sum_p[j] += re * re + q * q;
+			out[k + j][0] = re * gain;
+			out[k + j][1] = q * gain;
+		}
+	}
+
+	memcpy(c->sum_re, sum_re, sizeof(sum_re));
+	memcpy(c->sum_im, sum_im, sizeof(sum_im));
+	memcpy(c->sum_ii, sum_ii, sizeof(sum_ii));
+	memcpy(c->sum_qq, sum_qq, sizeof(sum_qq));
+	memcpy(c->sum_iq, sum_iq, sizeof(sum_iq));
+	memcpy(c->sum_p, sum_p, sizeof(sum_p));
+}
+
+static void condition_groups_scalar(struct SIGNAL_CONDITIONER *c, const sample_cf32_t *in, sample_cf32_t *out,
+                                    int n_groups) {
+	condition_groups_body(c, in, out, n_groups);
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2")))
+static void condition_groups_avx2(struct SIGNAL_CONDITIONER *c, const sample_cf32_t *in, sample_cf32_t *out,
+                                  int n_groups) {
+	condition_groups_body(c, in, out, n_groups);
+}
+#endif
+
+/**
+ * Group function used by condition_samples(), selected at the first call of
+ * init_signal_conditioner()
+ */
+static void (*condition_groups)(struct SIGNAL_CONDITIONER *, const sample_cf32_t *, sample_cf32_t *, int) = NULL;
+
+void init_signal_conditioner(struct SIGNAL_CONDITIONER *c) {
+
+	if (condition_groups == NULL) {
+		condition_groups = condition_groups_scalar;
+#ifdef HAVE_X86_SIMD
+		if (__builtin_cpu_supports("avx2")) {
+			condition_groups = condition_groups_avx2;
+		}
+#endif
+	}
+
+	memset(c, 0, sizeof(struct SIGNAL_CONDITIONER));
+	c->dc = 1;
+	c->iq = 1;
+	c->agc = 1;
+	c->agc_target = COND_DEFAULT_AGC_TARGET;
+	c->iq_a = 1;
+	c->gain = 1;
+
+}
+
+/**
+ * Smooths the statistics with the ones of the block that has just ended,
+ * and updates the corrections applied to the next block
+ */
+static void update_corrections(struct SIGNAL_CONDITIONER *c) {
+
+	float m_re = 0, m_im = 0, p_ii = 0, p_qq = 0, p_iq = 0, level = 0, det;
+	int j;
+
+	//the sums are of the samples without the DC offset estimated so far, so
+	//the powers are computed around the mean of the block
+	for (j = 0; j < COND_LANES; j++) {
+		m_re += c->sum_re[j];
+		m_im += c->sum_im[j];
+		p_ii += c->sum_ii[j];
+		p_qq += c->sum_qq[j];
+		p_iq += c->sum_iq[j];
+		level += c->sum_p[j];
+	}
+	m_re /= COND_BLOCK;
+	m_im /= COND_BLOCK;
+	p_ii = p_ii / COND_BLOCK - m_re * m_re;
+	p_qq = p_qq / COND_BLOCK - m_im * m_im;
+	p_iq = p_iq / COND_BLOCK - m_re * m_im;
+	level /= COND_BLOCK;
+	m_re += c->dc_re;
+	m_im += c->dc_im;
+
+	if (c->n_blocks == 0) {
+		c->mean_re = m_re;
+		c->mean_im = m_im;
+		c->p_ii = p_ii;
+		c->p_qq = p_qq;
+		c->p_iq = p_iq;
+		c->level = level;
+	}
+	else {
+		c->mean_re += COND_DC_RATE * (m_re - c->mean_re);
+		c->mean_im += COND_DC_RATE * (m_im - c->mean_im);
+		c->p_ii += COND_IQ_RATE * (p_ii - c->p_ii);
+		c->p_qq += COND_IQ_RATE * (p_qq - c->p_qq);
+		c->p_iq += COND_IQ_RATE * (p_iq - c->p_iq);
+		//the level is the mean of the blocks so far until there are 1 /
+		//COND_AGC_RATE of them, so that the first ones, which are not
+		//corrected yet, do not bias it for a whole time constant
+		c->level += (c->n_blocks < 1 / COND_AGC_RATE ? 1.0f / (c->n_blocks + 1) : COND_AGC_RATE) * (level - c->level);
+	}
+	memset(c->sum_re, 0, sizeof(c->sum_re));
+	memset(c->sum_im, 0, sizeof(c->sum_im));
+	memset(c->sum_ii, 0, sizeof(c->sum_ii));
+	memset(c->sum_qq, 0, sizeof(c->sum_qq));
+	memset(c->sum_iq, 0, sizeof(c->sum_iq));
+	memset(c->sum_p, 0, sizeof(c->sum_p));
+	c->fill = 0;
+	c->n_blocks++;
+
+	c->dc_re = c->dc ? c->mean_re : 0;
+	c->dc_im = c->dc ? c->mean_im : 0;
+	//Gram-Schmidt: a Q + b I is orthogonal to I, with the same power
+	det = c->p_ii > 0 ? c->p_qq - c->p_iq * c->p_iq / c->p_ii : 0;
+	if (c->iq && det > 0) {
+		c->iq_a = sqrtf(c->p_ii / det);
+		c->iq_b = -c->iq_a * c->p_iq / c->p_ii;
+	}
+	else {
+		c->iq_a = 1;
+		c->iq_b = 0;
+	}
+	c->gain = c->agc && c->level > 0 ? sqrtf(c->agc_target / c->level) : 1;
+
+}
+
+/**
+ * Conditions samples within the current block. The groups of samples
+ * aligned to the lanes of the partial sums go through the vectorized loop
+ */
+static void condition_segment(struct SIGNAL_CONDITIONER *c, const sample_cf32_t *in, sample_cf32_t *out, int size) {
+
+	int lane = c->fill % COND_LANES, k = 0, n_groups;
+
+	for (; lane != 0 && k < size; k++, lane = (lane + 1) % COND_LANES) {
+		condition_sample(c, in[k], out[k], lane);
+	}
+	n_groups = (size - k) / COND_LANES;
+	condition_groups(c, &in[k], &out[k], n_groups);
+	for (k += n_groups * COND_LANES, lane = 0; k < size; k++, lane++) {
+		condition_sample(c, in[k], out[k], lane);
+	}
+
+}
+
+void condition_samples(struct SIGNAL_CONDITIONER *c, const sample_cf32_t *in, sample_cf32_t *out, int size) {
+
+	int n;
+
+	while (size > 0) {
+		n = COND_BLOCK - c->fill < size ? COND_BLOCK - c->fill : size;
+		condition_segment(c, in, out, n);
+		c->fill += n;
+		if (c->fill == COND_BLOCK) {
+			update_corrections(c);
+		}
+		in += n;
+		out += n;
+		size -= n;
+	}
+
+}
+
+double measure_image_rejection(const sample_cf32_t *samples, int size) {
+
+	//for z = alpha s + beta s* with circular s, E[z z] / E[|z|^2] is
+	//r = 2 |alpha| |beta| / (|alpha|^2 + |beta|^2), from which the ratio
+	//t = |beta| / |alpha| is found
+	double m_re = 0, m_im = 0, re, im, p = 0, z2_re = 0, z2_im = 0, r, t;
+	int k;
+
+	if (size <= 0) {
+		return 0;
+	}
+	for (k = 0; k < size; k++) {
+		m_re += samples[k][0];
+		m_im += samples[k][1];
+	}
+	m_re /= size;
+	m_im /= size;
+	for (k = 0; k < size; k++) {
+		re = samples[k][0] - m_re;
+		im = samples[k][1] - m_im;
+		p += re * re + im * im;
+		z2_re += re * re - im * im;
+		z2_im += 2 * re * im;
+	}
+	if (p == 0) {
+		return 0;
+	}
+	r = sqrt(z2_re * z2_re + z2_im * z2_im) / p;
+	if (r == 0) {
+		return HUGE_VAL;
+	}
+	t = (1 - sqrt(1 - r * r)) / r;
+
+	return -20 * log10(t);
+
+}
@@ -0,0 +1,1009 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: streaming frame detectors for the receive chain
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <pthread.h>
+
+#include "detector_utils.h"
+#include "ofdm_utils.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+void init_short_training_detector(struct SHORT_TRAINING_DETECTOR *d) {
+	memset(d, 0, sizeof(struct SHORT_TRAINING_DETECTOR));
+	d->rearm = -1;
+}
+
+/**
+ * Core of the short training detector. Computes the timing metric for
+ * each sample and, if events is not null, generates the detection events
+ */
+static int process_short_training(struct SHORT_TRAINING_DETECTOR *d, const fftw_complex *samples, int size, double threshold, double *metric,
+                                  struct DETECTION_EVENT *events, int max_events, int *n_events) {
+
+	int i, k;
+	int first = -1;
+	//local copies of the running sums, so that the compiler can keep them in registers
+	double p_re = d->p[0], p_im = d->p[1], r = d->r, rd = d->rd;
+	unsigned long long n = d->n;
+
+	for (i = 0; i < size; i++) {
+
+		double x_re = samples[i][0], x_im = samples[i][1];
+		//ring indexes of the delayed sample and of the oldest product in the window
+		int hd = n & (SC_DELAY - 1);
+		int hw = n & (SC_WINDOW - 1);
+		double y_re = d->history[hd][0], y_im = d->history[hd][1];
+		//x * conj(y)
+		double c_re = x_re * y_re + x_im * y_im;
+		double c_im = x_im * y_re - x_re * y_im;
+		double e = x_re * x_re + x_im * x_im;
+		double ed = y_re * y_re + y_im * y_im;
+		double pp, rr;
+
+		p_re += c_re - d->products[hw][0];
+		p_im += c_im - d->products[hw][1];
+		r += e - d->energies[hw];
+		rd += ed - d->delayed_energies[hw];
+
+		d->history[hd][0] = x_re;
+		d->history[hd][1] = x_im;
+		d->products[hw][0] = c_re;
+		d->products[hw][1] = c_im;
+		d->energies[hw] = e;
+		d->delayed_energies[hw] = ed;
+		n++;
+
+		if ((n & (SC_RESYNC_INTERVAL - 1)) == 0) {
+			//recompute the sums from the stored terms
+			p_re = p_im = r = rd = 0;
+			for (k = 0; k < SC_WINDOW; k++) {
+				p_re += d->products[k][0];
+				p_im += d->products[k][1];
+				r += d->energies[k];
+				rd += d->delayed_energies[k];
+			}
+		}
+
+		pp = p_re * p_re + p_im * p_im;
+		rr = r * rd;
+
+		if (metric) {
+			metric[i] = rr > 0 ? pp / rr : 0;
+		}
+
+		//compare without dividing. when rr is 0, pp is 0 as well
+		if (first == -1 && pp > threshold * rr) {
+			first = i;
+		}
+
+		if (events) {
+			if (!d->triggered) {
+				if ((long long)n > d->rearm && pp > threshold * rr) {
+					if (*n_events < max_events) {
+						//the window of the current sample (n - 1) starts SC_WINDOW + SC_DELAY - 1 samples before
+						events[*n_events].sample = (long long)n - SC_WINDOW - SC_DELAY;
+						events[*n_events].offset = 0;
+						events[*n_events].metric = pp / rr;
+						(*n_events)++;
+					}
+					d->triggered = 1;
+					d->rearm = (long long)n + SC_HOLDOFF;
+				}
+			}
+			else {
+				if (pp < threshold * SC_HYSTERESIS * rr) {
+					d->triggered = 0;
+				}
+			}
+		}
+
+	}
+
+	d->p[0] = p_re;
+	d->p[1] = p_im;
+	d->r = r;
+	d->rd = rd;
+	d->n = n;
+
+	return first;
+
+}
+
+int update_short_training_detector(struct SHORT_TRAINING_DETECTOR *d, const fftw_complex *samples, int size, double threshold, double *metric) {
+	return process_short_training(d, samples, size, threshold, metric, 0, 0, 0);
+}
+
+int detect_short_training_events(struct SHORT_TRAINING_DETECTOR *d, const fftw_complex *samples, int size, double threshold,
+                                 struct DETECTION_EVENT *events, int max_events) {
+	int n_events = 0;
+	process_short_training(d, samples, size, threshold, 0, events, max_events, &n_events);
+	return n_events;
+}
+
+void init_short_training_detector_f(struct SHORT_TRAINING_DETECTOR_F *d) {
+	memset(d, 0, sizeof(struct SHORT_TRAINING_DETECTOR_F));
+	d->rearm = -1;
+}
+
+/**
+ * Core of the single precision short training detector. Computes the timing metric for
+ * each sample and, if events is not null, generates the detection events
+ */
+static int process_short_training_f(struct SHORT_TRAINING_DETECTOR_F *d, const sample_cf32_t *samples, int size, float threshold, float *metric,
+                                    struct DETECTION_EVENT *events, int max_events, int *n_events) {
+
+	int i, k;
+	int first = -1;
+	//local copies of the running sums, so that the compiler can keep them in registers
+	float p_re = d->p[0], p_im = d->p[1], r = d->r, rd = d->rd;
+	unsigned long long n = d->n;
+
+	for (i = 0; i < size; i++) {
+
+		float x_re = samples[i][0], x_im = samples[i][1];
+		//ring indexes of the delayed sample and of the oldest product in the window
+		int hd = n & (SC_DELAY - 1);
+		int hw = n & (SC_WINDOW - 1);
+		float y_re = d->history[hd][0], y_im = d->history[hd][1];
+		//x * conj(y)
+		float c_re = x_re * y_re + x_im * y_im;
+		float c_im = x_im * y_re - x_re * y_im;
+		float e = x_re * x_re + x_im * x_im;
+		float ed = y_re * y_re + y_im * y_im;
+		float pp, rr;
+
+		p_re += c_re - d->products[hw][0];
+		p_im += c_im - d->products[hw][1];
+		r += e - d->energies[hw];
+		rd += ed - d->delayed_energies[hw];
+
+		d->history[hd][0] = x_re;
+		d->history[hd][1] = x_im;
+		d->products[hw][0] = c_re;
+		d->products[hw][1] = c_im;
+		d->energies[hw] = e;
+		d->delayed_energies[hw] = ed;
+		n++;
+
+		if ((n & (SC_RESYNC_INTERVAL - 1)) == 0) {
+			//in single precision the rounding errors build up quickly. recompute the sums
+			p_re = p_im = r = rd = 0;
+			for (k = 0; k < SC_WINDOW; k++) {
+				p_re += d->products[k][0];
+				p_im += d->products[k][1];
+				r += d->energies[k];
+				rd += d->delayed_energies[k];
+			}
+		}
+
+		pp = p_re * p_re + p_im * p_im;
+		rr = r * rd;
+
+		if (metric) {
+			metric[i] = rr > 0 ? pp / rr : 0;
+		}
+
+		//compare without dividing. when rr is 0, pp is 0 as well
+		if (first == -1 && pp > threshold * rr) {
+			first = i;
+		}
+
+		if (events) {
+			if (!d->triggered) {
+				if ((long long)n > d->rearm && pp > threshold * rr) {
+					if (*n_events < max_events) {
+						//the window of the current sample (n - 1) starts SC_WINDOW + SC_DELAY - 1 samples before
+						events[*n_events].sample = (long long)n - SC_WINDOW - SC_DELAY;
+						events[*n_events].offset = 0;
+						events[*n_events].metric = pp / rr;
+						(*n_events)++;
+					}
+					d->triggered = 1;
+					d->rearm = (long long)n + SC_HOLDOFF;
+				}
+			}
+			else {
+				if (pp < threshold * SC_HYSTERESIS * rr) {
+					d->triggered = 0;
+				}
+			}
+		}
+
+	}
+
+	d->p[0] = p_re;
+	d->p[1] = p_im;
+	d->r = r;
+	d->rd = rd;
+	d->n = n;
+
+	return first;
+
+}
+
+int update_short_training_detector_f(struct SHORT_TRAINING_DETECTOR_F *d, const sample_cf32_t *samples, int size, float threshold, float *metric) {
+	return process_short_training_f(d, samples, size, threshold, metric, 0, 0, 0);
+}
+
+int detect_short_training_events_f(struct SHORT_TRAINING_DETECTOR_F *d, const sample_cf32_t *samples, int size, float threshold,
+                                   struct DETECTION_EVENT *events, int max_events) {
+	int n_events = 0;
+	process_short_training_f(d, samples, size, threshold, 0, events, max_events, &n_events);
+	return n_events;
+}
+
+void init_energy_gate(struct ENERGY_GATE *g) {
+	int i;
+	memset(g, 0, sizeof(struct ENERGY_GATE));
+	g->margin = EG_MARGIN;
+	//the detector starts with all its past samples at 0, as if it had seen them
+	g->was_open = 1;
+	for (i = 0; i < EG_FLOOR_WINDOWS; i++) {
+		g->minima[i] = FLT_MAX;
+	}
+	g->floor = FLT_MAX;
+}
+
+/**
+ * Updates the noise floor with the power of a block
+ */
+static void update_noise_floor(struct ENERGY_GATE *g, float power) {
+	int i;
+	if (power < g->minima[g->window]) {
+		g->minima[g->window] = power;
+	}
+	if (power < g->floor) {
+		g->floor = power;
+	}
+	g->window_blocks++;
+	if (g->window_blocks == EG_FLOOR_BLOCKS) {
+		//the oldest window is forgotten
+		g->window = (g->window + 1) % EG_FLOOR_WINDOWS;
+		g->window_blocks = 0;
+		g->minima[g->window] = FLT_MAX;
+		g->floor = FLT_MAX;
+		for (i = 0; i < EG_FLOOR_WINDOWS; i++) {
+			if (g->minima[i] < g->floor) {
+				g->floor = g->minima[i];
+			}
+		}
+	}
+}
+
+/**
+ * Decides whether the collected block passes the gate and, if so, gives it
+ * to the detector. Then keeps its last samples for the next block
+ */
+static void process_gated_block(struct ENERGY_GATE *g, struct SHORT_TRAINING_DETECTOR_F *d, float threshold,
+                                struct DETECTION_EVENT *events, int max_events, int *n_events) {
+
+	const sample_cf32_t *block = &g->samples[EG_PRIME];
+	float power = 0;
+	int open, triggered, i;
+	long long rearm;
+	unsigned long long n;
+
+	for (i = 0; i < EG_BLOCK; i++) {
+		power += block[i][0] * block[i][0] + block[i][1] * block[i][1];
+	}
+	power /= EG_BLOCK;
+	//the first block sets the noise floor, and is always open
+	open = g->bypass || g->n_blocks == 0 || power > g->margin * g->floor;
+	update_noise_floor(g, power);
+
+	if (open) {
+		if (!g->was_open) {
+			//the running sums are rebuilt from the previous samples, keeping the
+			//state of the events
+			n = g->n_blocks * EG_BLOCK - EG_PRIME;
+			triggered = d->triggered;
+			rearm = d->rearm;
+			init_short_training_detector_f(d);
+			d->n = n;
+			d->triggered = triggered;
+			d->rearm = rearm;
+			process_short_training_f(d, g->samples, EG_PRIME, threshold, 0, 0, 0, 0);
+		}
+		process_short_training_f(d, block, EG_BLOCK, threshold, 0, events, max_events, n_events);
+		g->n_open++;
+	}
+	g->was_open = open;
+	g->n_blocks++;
+
+	memmove(g->samples, &g->samples[EG_BLOCK], sizeof(sample_cf32_t) * EG_PRIME);
+	g->fill = 0;
+
+}
+
+int detect_short_training_events_gated_f(struct ENERGY_GATE *g, struct SHORT_TRAINING_DETECTOR_F *d, const sample_cf32_t *samples,
+                                         int size, float threshold, struct DETECTION_EVENT *events, int max_events) {
+	int n_events = 0, n;
+	while (size > 0) {
+		n = EG_BLOCK - g->fill < size ? EG_BLOCK - g->fill : size;
+		memcpy(&g->samples[EG_PRIME + g->fill], samples, sizeof(sample_cf32_t) * n);
+		g->fill += n;
+		samples += n;
+		size -= n;
+		if (g->fill == EG_BLOCK) {
+			process_gated_block(g, d, threshold, events, max_events, &n_events);
+		}
+	}
+	return n_events;
+}
+
+void init_long_training_detector(struct LONG_TRAINING_DETECTOR *d) {
+
+	int k;
+
+	memset(d, 0, sizeof(struct LONG_TRAINING_DETECTOR));
+	for (k = 0; k < LT_SIZE; k++) {
+		d->reference_energy += time_long_symbol[k][0] * time_long_symbol[k][0] + time_long_symbol[k][1] * time_long_symbol[k][1];
+	}
+
+}
+
+int detect_long_training_events(struct LONG_TRAINING_DETECTOR *d, const fftw_complex *samples, int size, double threshold,
+                                struct DETECTION_EVENT *events, int max_events) {
+
+	int i, k;
+	int n_events = 0;
+	double r = d->r;
+	unsigned long long n = d->n;
+
+	for (i = 0; i < size; i++) {
+
+		double x_re = samples[i][0], x_im = samples[i][1];
+		int h = n & (LT_SIZE - 1);
+		double e = x_re * x_re + x_im * x_im;
+		//the last LT_SIZE samples, oldest first
+		const fftw_complex *w;
+		double c_re = 0, c_im = 0;
+		double metric;
+
+		r += e - d->energies[h];
+		d->energies[h] = e;
+		//each sample is stored twice, so that the window is always contiguous
+		d->history[h][0] = d->history[h + LT_SIZE][0] = x_re;
+		d->history[h][1] = d->history[h + LT_SIZE][1] = x_im;
+		w = &d->history[h + 1];
+		n++;
+
+		if ((n & (SC_RESYNC_INTERVAL - 1)) == 0) {
+			r = 0;
+			for (k = 0; k < LT_SIZE; k++) {
+				r += d->energies[k];
+			}
+		}
+
+		//correlate with the conjugate of the long training symbol
+		for (k = 0; k < LT_SIZE; k++) {
+			c_re += w[k][0] * time_long_symbol[k][0] + w[k][1] * time_long_symbol[k][1];
+			c_im += w[k][1] * time_long_symbol[k][0] - w[k][0] * time_long_symbol[k][1];
+		}
+
+		metric = r > 0 ? (c_re * c_re + c_im * c_im) / (r * d->reference_energy) : 0;
+
+		if (metric > threshold) {
+			if (!d->in_peak || metric > d->peak_metric) {
+				//the window of the current sample (n - 1) starts LT_SIZE - 1 samples before
+				d->peak_sample = (long long)n - LT_SIZE;
+				d->peak_metric = metric;
+			}
+			d->in_peak = 1;
+		}
+		else {
+			if (d->in_peak) {
+				//the metric fell below the threshold: the peak is over
+				if (n_events < max_events) {
+					events[n_events].sample = d->peak_sample;
+					events[n_events].offset = 0;
+					events[n_events].metric = d->peak_metric;
+					n_events++;
+				}
+				d->in_peak = 0;
+			}
+		}
+
+	}
+
+	d->r = r;
+	d->n = n;
+
+	return n_events;
+
+}
+
+/**
+ * Samples at -32768 are taken as -32767, so that the sum of two products of
+ * 16 bit values always fits in 32 bits
+ */
+static inline int clamp_s16(short v) {
+	return v < -32767 ? -32767 : v;
+}
+
+//backend of the fixed point detectors, selected at the first initialization if not set explicitly.
+//The selection runs once even when detectors are initialized by several threads at the same time
+static int detector_backend = -1;
+static pthread_once_t detector_backend_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Computes the products of size samples with the conjugate of the ones SC_DELAY
+ * samples before, and their energies
+ */
+typedef void (*products_function)(const sample_sc16_t *x, int size, int (*products)[2], int *energies);
+static products_function compute_products = 0;
+
+/**
+ * Computes the correlation of LT_SIZE samples with the quantized long training
+ * symbol
+ */
+typedef void (*lt_correlation_function)(const sample_sc16_t *w, const short (*reference_re)[2],
+                                        const short (*reference_im)[2], int *c_re, int *c_im);
+static lt_correlation_function correlate_lt = 0;
+
+static void products_scalar(const sample_sc16_t *x, int size, int (*products)[2], int *energies) {
+	int i;
+	for (i = 0; i < size; i++) {
+		int x_re = clamp_s16(x[i][0]), x_im = clamp_s16(x[i][1]);
+		int y_re = clamp_s16(x[i - SC_DELAY][0]), y_im = clamp_s16(x[i - SC_DELAY][1]);
+		products[i][0] = x_re * y_re + x_im * y_im;
+		products[i][1] = x_im * y_re - x_re * y_im;
+		energies[i] = x_re * x_re + x_im * x_im;
+	}
+}
+
+static void lt_correlation_scalar(const sample_sc16_t *w, const short (*reference_re)[2], const short (*reference_im)[2],
+                                  int *c_re, int *c_im) {
+	int k, x_re, x_im;
+	*c_re = *c_im = 0;
+	for (k = 0; k < LT_SIZE; k++) {
+		x_re = clamp_s16(w[k][0]);
+		x_im = clamp_s16(w[k][1]);
+		*c_re += x_re * reference_re[k][0] + x_im * reference_re[k][1];
+		*c_im += x_re * reference_im[k][0] + x_im * reference_im[k][1];
+	}
+}
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * The SIMD versions load the samples as pairs of 16 bit values, and get each
+ * 32 bit result with one multiply-add: x * conj(y) is (x_re, x_im) . (y_re, y_im)
+ * for the real part, and (x_re, x_im) . (-y_im, y_re) for the imaginary part,
+ * where the second pair is y with its halves swapped and the first one negated
+ */
+__attribute__((target("sse2")))
+static void products_sse2(const sample_sc16_t *x, int size, int (*products)[2], int *energies) {
+
+	const __m128i min = _mm_set1_epi16(-32767);
+	const __m128i sign = _mm_set1_epi32(0x0001FFFF);
+	int i;
+
+	for (i = 0; i + 4 <= size; i += 4) {
+		__m128i a = _mm_max_epi16(_mm_loadu_si128((const __m128i *)&x[i]), min);
+		__m128i b = _mm_max_epi16(_mm_loadu_si128((const __m128i *)&x[i - SC_DELAY]), min);
+		__m128i c = _mm_mullo_epi16(_mm_shufflehi_epi16(_mm_shufflelo_epi16(b, 0xB1), 0xB1), sign);
+		__m128i re = _mm_madd_epi16(a, b);
+		__m128i im = _mm_madd_epi16(a, c);
+		_mm_storeu_si128((__m128i *)&products[i][0], _mm_unpacklo_epi32(re, im));
+		_mm_storeu_si128((__m128i *)&products[i + 2][0], _mm_unpackhi_epi32(re, im));
+		_mm_storeu_si128((__m128i *)&energies[i], _mm_madd_epi16(a, a));
+	}
+	products_scalar(&x[i], size - i, &products[i], &energies[i]);
+
+}
+
+__attribute__((target("sse2")))
+static void lt_correlation_sse2(const sample_sc16_t *w, const short (*reference_re)[2], const short (*reference_im)[2],
+                                int *c_re, int *c_im) {
+
+	const __m128i min = _mm_set1_epi16(-32767);
+	__m128i re = _mm_setzero_si128(), im = _mm_setzero_si128();
+	int k;
+
+	for (k = 0; k < LT_SIZE; k += 4) {
+		__m128i a = _mm_max_epi16(_mm_loadu_si128((const __m128i *)&w[k]), min);
+		re = _mm_add_epi32(re, _mm_madd_epi16(a, _mm_loadu_si128((const __m128i *)&reference_re[k])));
+		im = _mm_add_epi32(im, _mm_madd_epi16(a, _mm_loadu_si128((const __m128i *)&reference_im[k])));
+	}
+	//horizontal sums
+	re = _mm_add_epi32(re, _mm_shuffle_epi32(re, 0x4E));
+	re = _mm_add_epi32(re, _mm_shuffle_epi32(re, 0xB1));
+	im = _mm_add_epi32(im, _mm_shuffle_epi32(im, 0x4E));
+	im = _mm_add_epi32(im, _mm_shuffle_epi32(im, 0xB1));
+	*c_re = _mm_cvtsi128_si32(re);
+	*c_im = _mm_cvtsi128_si32(im);
+
+}
+
+__attribute__((target("avx2")))
+static void products_avx2(const sample_sc16_t *x, int size, int (*products)[2], int *energies) {
+
+	const __m256i min = _mm256_set1_epi16(-32767);
+	const __m256i sign = _mm256_set1_epi32(0x0001FFFF);
+	int i;
+
+	for (i = 0; i + 8 <= size; i += 8) {
+		__m256i a = _mm256_max_epi16(_mm256_loadu_si256((const __m256i *)&x[i]), min);
+		__m256i b = _mm256_max_epi16(_mm256_loadu_si256((const __m256i *)&x[i - SC_DELAY]), min);
+		__m256i c = _mm256_mullo_epi16(_mm256_shufflehi_epi16(_mm256_shufflelo_epi16(b, 0xB1), 0xB1), sign);
+		__m256i re = _mm256_madd_epi16(a, b);
+		__m256i im = _mm256_madd_epi16(a, c);
+		//the unpack instructions work within 128 bit lanes: samples 0, 1, 4, 5 and 2, 3, 6, 7
+		__m256i lo = _mm256_unpacklo_epi32(re, im);
+		__m256i hi = _mm256_unpackhi_epi32(re, im);
+		_mm256_storeu_si256((__m256i *)&products[i][0], _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)&products[i + 4][0], _mm256_permute2x128_si256(lo, hi, 0x31));
+		_mm256_storeu_si256((__m256i *)&energies[i], _mm256_madd_epi16(a, a));
+	}
+	products_scalar(&x[i], size - i, &products[i], &energies[i]);
+
+}
+
+__attribute__((target("avx2")))
+static void lt_correlation_avx2(const sample_sc16_t *w, const short (*reference_re)[2], const short (*reference_im)[2],
+                                int *c_re, int *c_im) {
+
+	const __m256i min = _mm256_set1_epi16(-32767);
+	__m256i re = _mm256_setzero_si256(), im = _mm256_setzero_si256();
+	__m128i re4, im4;
+	int k;
+
+	for (k = 0; k < LT_SIZE; k += 8) {
+		__m256i a = _mm256_max_epi16(_mm256_loadu_si256((const __m256i *)&w[k]), min);
+		re = _mm256_add_epi32(re, _mm256_madd_epi16(a, _mm256_loadu_si256((const __m256i *)&reference_re[k])));
+		im = _mm256_add_epi32(im, _mm256_madd_epi16(a, _mm256_loadu_si256((const __m256i *)&reference_im[k])));
+	}
+	//horizontal sums
+	re4 = _mm_add_epi32(_mm256_castsi256_si128(re), _mm256_extracti128_si256(re, 1));
+	im4 = _mm_add_epi32(_mm256_castsi256_si128(im), _mm256_extracti128_si256(im, 1));
+	re4 = _mm_add_epi32(re4, _mm_shuffle_epi32(re4, 0x4E));
+	re4 = _mm_add_epi32(re4, _mm_shuffle_epi32(re4, 0xB1));
+	im4 = _mm_add_epi32(im4, _mm_shuffle_epi32(im4, 0x4E));
+	im4 = _mm_add_epi32(im4, _mm_shuffle_epi32(im4, 0xB1));
+	*c_re = _mm_cvtsi128_si32(re4);
+	*c_im = _mm_cvtsi128_si32(im4);
+
+}
+
+#endif
+
+int set_detector_backend(enum DETECTOR_BACKEND b) {
+
+	switch (b) {
+
+		case DETECTOR_SCALAR:
+			compute_products = products_scalar;
+			correlate_lt = lt_correlation_scalar;
+			break;
+
+#ifdef HAVE_X86_SIMD
+		case DETECTOR_SSE2:
+			if (!__builtin_cpu_supports("sse2")) {
+				return ERR_DETECTOR_NOT_SUPPORTED;
+			}
+			compute_products = products_sse2;
+			correlate_lt = lt_correlation_sse2;
+			break;
+
+		case DETECTOR_AVX2:
+			if (!__builtin_cpu_supports("avx2")) {
+				return ERR_DETECTOR_NOT_SUPPORTED;
+			}
+			compute_products = products_avx2;
+			correlate_lt = lt_correlation_avx2;
+			break;
+#endif
+
+		default:
+			return ERR_DETECTOR_NOT_SUPPORTED;
+
+	}
+
+	detector_backend = b;
+	return 0;
+
+}
+
+/**
+ * Picks the fastest backend, unless one has been set explicitly
+ */
+static void select_detector_backend() {
+
+	if (detector_backend == -1) {
+		if (set_detector_backend(DETECTOR_AVX2) != 0 && set_detector_backend(DETECTOR_SSE2) != 0) {
+			set_detector_backend(DETECTOR_SCALAR);
+		}
+	}
+
+}
+
+enum DETECTOR_BACKEND get_detector_backend() {
+
+	pthread_once(&detector_backend_once, select_detector_backend);
+	return (enum DETECTOR_BACKEND)detector_backend;
+
+}
+
+void init_short_training_detector_s16(struct SHORT_TRAINING_DETECTOR_S16 *d) {
+	get_detector_backend();
+	memset(d, 0, sizeof(struct SHORT_TRAINING_DETECTOR_S16));
+	d->rearm = -1;
+}
+
+int detect_short_training_events_s16(struct SHORT_TRAINING_DETECTOR_S16 *d, const sample_sc16_t *samples, int size, double threshold,
+                                     struct DETECTION_EVENT *events, int max_events) {
+
+	int n_events = 0, block, i;
+	//square root of the threshold, rounded down so that the check below never rejects a sample above threshold
+	long long root_q = (long long)(sqrt(threshold) * (1 << SC16_THRESHOLD_BITS));
+	long long p_re = d->p[0], p_im = d->p[1], r = d->r, rd = d->rd;
+	double pp, rr;
+	unsigned long long n = d->n;
+
+	while (size > 0) {
+
+		block = size < SC16_BLOCK ? size : SC16_BLOCK;
+		memcpy(&d->samples[SC16_HISTORY], samples, sizeof(sample_sc16_t) * block);
+		compute_products(&d->samples[SC16_HISTORY], block, &d->products[SC16_HISTORY], &d->energies[SC16_HISTORY]);
+
+		for (i = SC16_HISTORY; i < SC16_HISTORY + block; i++) {
+
+			//products and energies of full scale samples are close to 2^31, so
+			//their differences are taken in 64 bits
+			p_re += (long long)d->products[i][0] - d->products[i - SC_WINDOW][0];
+			p_im += (long long)d->products[i][1] - d->products[i - SC_WINDOW][1];
+			r += (long long)d->energies[i] - d->energies[i - SC_WINDOW];
+			rd += (long long)d->energies[i - SC_DELAY] - d->energies[i - SC_WINDOW - SC_DELAY];
+			n++;
+
+			if (!d->triggered) {
+				//|P|^2 > threshold * R * R_D requires |P_re| + |P_im| >= |P| > sqrt(threshold) * min(R, R_D)
+				if ((long long)n <= d->rearm ||
+				        ((llabs(p_re) + llabs(p_im)) << SC16_THRESHOLD_BITS) < root_q * (r < rd ? r : rd)) {
+					continue;
+				}
+				pp = (double)p_re * p_re + (double)p_im * p_im;
+				rr = (double)r * rd;
+				if (pp > threshold * rr) {
+					if (n_events < max_events) {
+						//the window of the current sample (n - 1) starts SC_WINDOW + SC_DELAY - 1 samples before
+						events[n_events].sample = (long long)n - SC_WINDOW - SC_DELAY;
+						events[n_events].offset = 0;
+						events[n_events].metric = pp / rr;
+						n_events++;
+					}
+					d->triggered = 1;
+					d->rearm = (long long)n + SC_HOLDOFF;
+				}
+			}
+			else {
+				pp = (double)p_re * p_re + (double)p_im * p_im;
+				rr = (double)r * rd;
+				if (pp < threshold * SC_HYSTERESIS * rr) {
+					d->triggered = 0;
+				}
+			}
+
+		}
+
+		memmove(d->samples, &d->samples[block], sizeof(sample_sc16_t) * SC16_HISTORY);
+		memmove(d->products, &d->products[block], sizeof(d->products[0]) * SC16_HISTORY);
+		memmove(d->energies, &d->energies[block], sizeof(int) * SC16_HISTORY);
+		samples += block;
+		size -= block;
+
+	}
+
+	d->p[0] = p_re;
+	d->p[1] = p_im;
+	d->r = r;
+	d->rd = rd;
+	d->n = n;
+
+	return n_events;
+
+}
+
+void init_long_training_detector_s16(struct LONG_TRAINING_DETECTOR_S16 *d) {
+
+	int k;
+
+	get_detector_backend();
+	memset(d, 0, sizeof(struct LONG_TRAINING_DETECTOR_S16));
+	for (k = 0; k < LT_SIZE; k++) {
+		short l_re = (short)lrint(time_long_symbol[k][0] * LT16_SCALE);
+		short l_im = (short)lrint(time_long_symbol[k][1] * LT16_SCALE);
+		//x * conj(l)
+		d->reference_re[k][0] = l_re;
+		d->reference_re[k][1] = l_im;
+		d->reference_im[k][0] = -l_im;
+		d->reference_im[k][1] = l_re;
+		d->reference_energy += (double)l_re * l_re + (double)l_im * l_im;
+	}
+
+}
+
+int detect_long_training_events_s16(struct LONG_TRAINING_DETECTOR_S16 *d, const sample_sc16_t *samples, int size, double threshold,
+                                    struct DETECTION_EVENT *events, int max_events) {
+
+	int i, n_events = 0;
+	long long r = d->r;
+	unsigned long long n = d->n;
+	//threshold * reference_energy rounded down, so that a squared correlation
+	//not above bound * r cannot give a metric above the threshold. The metric
+	//is at most 1, so larger thresholds are not needed for the bound, and
+	//bound * r stays within 64 bits
+	long long bound = (long long)((threshold < 0 ? 0 : threshold > 1 ? 1 : threshold) * d->reference_energy);
+
+	for (i = 0; i < size; i++) {
+
+		int x_re = clamp_s16(samples[i][0]), x_im = clamp_s16(samples[i][1]);
+		int h = n & (LT_SIZE - 1);
+		int e = x_re * x_re + x_im * x_im;
+		int c_re, c_im;
+		long long cc;
+		double metric;
+
+		r += e - d->energies[h];
+		d->energies[h] = e;
+		//each sample is stored twice, so that the window is always contiguous
+		d->history[h][0] = d->history[h + LT_SIZE][0] = samples[i][0];
+		d->history[h][1] = d->history[h + LT_SIZE][1] = samples[i][1];
+		n++;
+
+		correlate_lt(&d->history[h + 1], d->reference_re, d->reference_im, &c_re, &c_im);
+		//most samples are rejected in integer arithmetic, without the division
+		cc = (long long)c_re * c_re + (long long)c_im * c_im;
+		metric = cc > bound * r ? ((double)c_re * c_re + (double)c_im * c_im) / (r * d->reference_energy) : 0;
+
+		if (metric > threshold) {
+			if (!d->in_peak || metric > d->peak_metric) {
+				//the window of the current sample (n - 1) starts LT_SIZE - 1 samples before
+				d->peak_sample = (long long)n - LT_SIZE;
+				d->peak_metric = metric;
+			}
+			d->in_peak = 1;
+		}
+		else {
+			if (d->in_peak) {
+				//the metric fell below the threshold: the peak is over
+				if (n_events < max_events) {
+					events[n_events].sample = d->peak_sample;
+					events[n_events].offset = 0;
+					events[n_events].metric = d->peak_metric;
+					n_events++;
+				}
+				d->in_peak = 0;
+			}
+		}
+
+	}
+
+	d->r = r;
+	d->n = n;
+
+	return n_events;
+
+}
+
+void init_long_training_correlator(struct LONG_TRAINING_CORRELATOR *c) {
+
+	int k;
+
+	memset(c, 0, sizeof(struct LONG_TRAINING_CORRELATOR));
+
+	c->block = fftw_alloc_complex(LT_FFT_SIZE);
+	c->spectrum = fftw_alloc_complex(LT_FFT_SIZE);
+	c->correlation = fftw_alloc_complex(LT_FFT_SIZE);
+	c->reference = fftw_alloc_complex(LT_FFT_SIZE);
+
+	//plans are created once and reused for every block
+	c->forward = fftw_plan_dft_1d(LT_FFT_SIZE, c->block, c->spectrum, FFTW_FORWARD, FFTW_MEASURE);
+	c->backward = fftw_plan_dft_1d(LT_FFT_SIZE, c->spectrum, c->correlation, FFTW_BACKWARD, FFTW_MEASURE);
+
+	//the matched filter is the reversed conjugate of the long training symbol
+	zero_samples(c->block, LT_FFT_SIZE);
+	for (k = 0; k < LT_SIZE; k++) {
+		c->block[k][0] = time_long_symbol[LT_SIZE - 1 - k][0];
+		c->block[k][1] = -time_long_symbol[LT_SIZE - 1 - k][1];
+		c->reference_energy += time_long_symbol[k][0] * time_long_symbol[k][0] + time_long_symbol[k][1] * time_long_symbol[k][1];
+	}
+	fftw_execute_dft(c->forward, c->block, c->reference);
+	//include the normalization of the backward FFT
+	for (k = 0; k < LT_FFT_SIZE; k++) {
+		c->reference[k][0] /= LT_FFT_SIZE;
+		c->reference[k][1] /= LT_FFT_SIZE;
+	}
+
+	//the first block starts with LT_SIZE - 1 zeros, i.e., the samples before the stream
+	zero_samples(c->block, LT_FFT_SIZE);
+	c->fill = LT_SIZE - 1;
+
+}
+
+void free_long_training_correlator(struct LONG_TRAINING_CORRELATOR *c) {
+	fftw_destroy_plan(c->forward);
+	fftw_destroy_plan(c->backward);
+	fftw_free(c->block);
+	fftw_free(c->spectrum);
+	fftw_free(c->correlation);
+	fftw_free(c->reference);
+}
+
+/**
+ * Stores a peak of the correlator into the events array, refining its
+ * position by fitting a parabola through the peak and its neighbours
+ */
+static void add_correlator_peak(struct LONG_TRAINING_CORRELATOR *c, struct DETECTION_EVENT *events, int max_events, int *n_events) {
+
+	double offset = 0;
+	//the parabola is fitted on the correlation magnitude, i.e., the square root
+	//of the metric, whose peak is less sharp and better approximated
+	double l = sqrt(c->left_metric), p = sqrt(c->peak_metric), r = sqrt(c->right_metric);
+	double den = l - 2 * p + r;
+
+	if (!c->need_right && den < 0) {
+		offset = 0.5 * (l - r) / den;
+		if (offset > 0.5) {
+			offset = 0.5;
+		}
+		if (offset < -0.5) {
+			offset = -0.5;
+		}
+	}
+
+	if (*n_events < max_events) {
+		events[*n_events].sample = c->peak_sample;
+		events[*n_events].offset = offset;
+		events[*n_events].metric = c->peak_metric;
+		(*n_events)++;
+	}
+	c->in_peak = 0;
+	c->need_right = 0;
+
+}
+
+/**
+ * Correlates the current block, and runs the peak detection over the first
+ * end samples of the block. Then moves the last LT_SIZE - 1 samples at the
+ * beginning of the block, for the next one
+ */
+static void process_correlator_block(struct LONG_TRAINING_CORRELATOR *c, int end, double threshold,
+                                     struct DETECTION_EVENT *events, int max_events, int *n_events) {
+
+	int j, k;
+	double r = c->r;
+	unsigned long long n = c->n;
+
+	fftw_execute(c->forward);
+	for (k = 0; k < LT_FFT_SIZE; k++) {
+		double re = c->spectrum[k][0] * c->reference[k][0] - c->spectrum[k][1] * c->reference[k][1];
+		double im = c->spectrum[k][0] * c->reference[k][1] + c->spectrum[k][1] * c->reference[k][0];
+		c->spectrum[k][0] = re;
+		c->spectrum[k][1] = im;
+	}
+	fftw_execute(c->backward);
+
+	//the first LT_SIZE - 1 outputs wrap around the block and are discarded
+	for (j = LT_SIZE - 1; j < end; j++) {
+
+		int h = n & (LT_SIZE - 1);
+		double e = c->block[j][0] * c->block[j][0] + c->block[j][1] * c->block[j][1];
+		double metric;
+
+		r += e - c->energies[h];
+		c->energies[h] = e;
+		n++;
+
+		if ((n & (SC_RESYNC_INTERVAL - 1)) == 0) {
+			r = 0;
+			for (k = 0; k < LT_SIZE; k++) {
+				r += c->energies[k];
+			}
+		}
+
+		metric = r > 0 ? (c->correlation[j][0] * c->correlation[j][0] + c->correlation[j][1] * c->correlation[j][1]) /
+		         (r * c->reference_energy) : 0;
+
+		if (c->need_right) {
+			c->right_metric = metric;
+			c->need_right = 0;
+		}
+
+		if (metric > threshold) {
+			if (!c->in_peak || metric > c->peak_metric) {
+				c->peak_sample = (long long)n - LT_SIZE;
+				c->peak_metric = metric;
+				c->left_metric = c->previous_metric;
+				c->need_right = 1;
+			}
+			c->in_peak = 1;
+		}
+		else {
+			if (c->in_peak) {
+				add_correlator_peak(c, events, max_events, n_events);
+			}
+		}
+
+		c->previous_metric = metric;
+
+	}
+
+	c->r = r;
+	c->n = n;
+
+	memmove(c->block, &c->block[end - (LT_SIZE - 1)], (LT_SIZE - 1) * sizeof(fftw_complex));
+	c->fill = LT_SIZE - 1;
+
+}
+
+int correlate_long_training(struct LONG_TRAINING_CORRELATOR *c, const fftw_complex *samples, int size, double threshold,
+                            struct DETECTION_EVENT *events, int max_events) {
+
+	int n_events = 0;
+	int i = 0;
+
+	while (i < size) {
+
+		int n = LT_FFT_SIZE - c->fill;
+		if (n > size - i) {
+			n = size - i;
+		}
+		memcpy(&c->block[c->fill], &samples[i], n * sizeof(fftw_complex));
+		c->fill += n;
+		i += n;
+
+		if (c->fill == LT_FFT_SIZE) {
+			process_correlator_block(c, LT_FFT_SIZE, threshold, events, max_events, &n_events);
+		}
+
+	}
+
+	return n_events;
+
+}
+
+int flush_long_training_correlator(struct LONG_TRAINING_CORRELATOR *c, double threshold, struct DETECTION_EVENT *events, int max_events) {
+
+	int n_events = 0;
+	int end = c->fill;
+
+	if (end > LT_SIZE - 1) {
+		//pad the partial block with zeros. outputs after end are not used
+		zero_samples(&c->block[end], LT_FFT_SIZE - end);
+		process_correlator_block(c, end, threshold, events, max_events, &n_events);
+	}
+
+	if (c->in_peak) {
+		add_correlator_peak(c, events, max_events, &n_events);
+	}
+
+	return n_events;
+
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: persistent index of the frames of a capture
+ *
+ */
+
+//indexes can be larger than 2 GB on 32 bit hosts as well
+#define _FILE_OFFSET_BITS 64
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "index_utils.h"
+#include "bit_utils.h"
+
+int create_frame_index(struct FRAME_INDEX_WRITER *w, const char *filename, enum CAPTURE_FORMAT format) {
+
+	struct FRAME_INDEX_HEADER header;
+
+	w->n_records = 0;
+	w->err = 0;
+	w->f = fopen(filename, "wb");
+	if (w->f == NULL) {
+		w->err = ERR_INDEX_CANNOT_WRITE;
+		return w->err;
+	}
+
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, FRAME_INDEX_MAGIC);
+	header.version = FRAME_INDEX_VERSION;
+	header.record_size = sizeof(struct FRAME_INDEX_RECORD);
+	header.format = format;
+	if (fwrite(&header, sizeof(header), 1, w->f) != 1 || fflush(w->f) != 0) {
+		w->err = ERR_INDEX_CANNOT_WRITE;
+	}
+
+	return w->err;
+
+}
+
+int append_frame_index_record(struct FRAME_INDEX_WRITER *w, const struct FRAME_INDEX_RECORD *r) {
+	if (fwrite(r, sizeof(struct FRAME_INDEX_RECORD), 1, w->f) != 1 || fflush(w->f) != 0) {
+		w->err = ERR_INDEX_CANNOT_WRITE;
+		return w->err;
+	}
+	w->n_records++;
+	return 0;
+}
+
+void close_frame_index_writer(struct FRAME_INDEX_WRITER *w) {
+	if (w->f != NULL) {
+		fclose(w->f);
+		w->f = NULL;
+	}
+}
+
+void make_frame_index_record(long long offset, int status, const struct RX_STATS *stats,
+                             struct FRAME_INDEX_RECORD *r) {
+	memset(r, 0, sizeof(struct FRAME_INDEX_RECORD));
+	r->offset = offset + stats->start;
+	r->n_samples = stats->end - stats->start;
+	r->data_rate = stats->tx_params.data_rate;
+	r->psdu_size = stats->tx_params.psdu_size;
+	r->status = status;
+	r->snr = (float)stats->snr;
+	r->cfo = (float)stats->cfo;
+}
+
+void index_decoded_frame(const struct DECODED_FRAME *frame, void *writer) {
+	struct FRAME_INDEX_RECORD r;
+	make_frame_index_record(frame->offset, frame->err, &frame->stats, &r);
+	append_frame_index_record((struct FRAME_INDEX_WRITER *)writer, &r);
+}
+
+int open_frame_index(struct FRAME_INDEX *idx, const char *filename) {
+
+	const struct FRAME_INDEX_HEADER *header;
+	struct stat st;
+	void *data;
+
+	idx->fd = open(filename, O_RDONLY);
+	if (idx->fd < 0) {
+		return ERR_CANNOT_READ_FILE;
+	}
+	if (fstat(idx->fd, &st) != 0) {
+		close(idx->fd);
+		return ERR_CANNOT_READ_FILE;
+	}
+	if ((size_t)st.st_size < sizeof(struct FRAME_INDEX_HEADER)) {
+		close(idx->fd);
+		return ERR_INVALID_FORMAT;
+	}
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, idx->fd, 0);
+	if (data == MAP_FAILED) {
+		close(idx->fd);
+		return ERR_CANNOT_READ_FILE;
+	}
+	idx->data = data;
+	idx->size = (size_t)st.st_size;
+
+	header = (const struct FRAME_INDEX_HEADER *)data;
+	if (strncmp(header->magic, FRAME_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+	        header->version != FRAME_INDEX_VERSION || header->record_size != sizeof(struct FRAME_INDEX_RECORD)) {
+		close_frame_index(idx);
+		return ERR_INVALID_FORMAT;
+	}
+	idx->format = (enum CAPTURE_FORMAT)header->format;
+	idx->records = (const struct FRAME_INDEX_RECORD *)(header + 1);
+	//a record being written is ignored
+	idx->n_records = (idx->size - sizeof(struct FRAME_INDEX_HEADER)) / sizeof(struct FRAME_INDEX_RECORD);
+
+	return 0;
+
+}
+
+void close_frame_index(struct FRAME_INDEX *idx) {
+	munmap((void *)idx->data, idx->size);
+	close(idx->fd);
+}
+
+const struct FRAME_INDEX_RECORD *get_frame_index_record(const struct FRAME_INDEX *idx, long long n) {
+	if (n < 0 || n >= idx->n_records) {
+		return NULL;
+	}
+	return &idx->records[n];
+}
+
+long long find_frame_index_record(const struct FRAME_INDEX *idx, long long from, int rates, int correct_only) {
+	long long n;
+	for (n = from < 0 ? 0 : from; n < idx->n_records; n++) {
+		if ((rates == 0 || (rates & (1 << idx->records[n].data_rate))) &&
+		        (!correct_only || idx->records[n].status == 0)) {
+			return n;
+		}
+	}
+	return -1;
+}
@@ -257,6 +257,9 @@ void set_frame_control_type(dbyte *frame_control, enum FC_TYPE type, int lsb) {
 	set_frame_control_bit(frame_control, 2, get_bit(type, 1), lsb);
 	set_frame_control_bit(frame_control, 3, get_bit(type, 0), lsb);
 }
+enum FC_TYPE get_frame_control_type(dbyte frame_control, int lsb) {
+	return (enum FC_TYPE)(get_frame_control_bit(frame_control, 2, lsb) << 1 | get_frame_control_bit(frame_control, 3, lsb));
+}
 
 void set_frame_control_subtype(dbyte *frame_control, char subtype, int lsb) {
 	//notice: get_bit bit index is inverted as get_bit works in LSB
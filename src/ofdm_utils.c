@@ -27,6 +27,7 @@
 #include "ofdm_utils.h"
 #include "bit_utils.h"
 #include "utils.h"
+#include "profiler.h"
 
 int max(int a, int b) {
 	return a > b ? a : b;
@@ -68,6 +69,31 @@ void scramble_with_initial_state(const char *in, char *out, int size, char initi
 
 }
 
+char get_scrambler_initial_state(const char *scrambled) {
+
+	//scrambling sequence x(k), with x(k) = x(k - 4) xor x(k - 7). x[0] to x[6]
+	//are the bits in the register before the first output, the oldest first,
+	//and x[7] to x[13] are the first 7 outputs
+	char x[14];
+	char state = 0;
+	int i;
+
+	for (i = 0; i < 7; i++) {
+		x[7 + i] = (char)get_bit(scrambled[0], 7 - i);
+	}
+	//run the recurrence backwards
+	for (i = 6; i >= 0; i--) {
+		x[i] = x[i + 7] ^ x[i + 3];
+	}
+	//the oldest bit is the most significant one
+	for (i = 0; i < 7; i++) {
+		state = (char)(state << 1 | x[i]);
+	}
+
+	return state;
+
+}
+
 void reset_tail_bits(char *scrambled_data, int size, int n_pad) {
 
 	//index of the first bit of the TAIL field
@@ -325,7 +351,7 @@ void insert_pilots(fftw_complex *in, fftw_complex *out, int symbol_index) {
 	int i;
 
 	//polarity of pilot subcarriers for current symbol
-	int polarity = subcarrier_polarities[symbol_index];
+	int polarity = subcarrier_polarities[symbol_index % N_PILOT_POLARITIES];
 
 	//on the standard, pilots are mapped inserted into positions -21, -7, 7, 21
 	//using a 0-based array, means we have to put them into positions 5, 19, 33, 47
@@ -510,20 +536,12 @@ struct TX_PARAMETERS get_tx_parameters(enum DATA_RATE data_rate, int psdu_size)
 	tx_params.n_data = tx_params.n_sym * ofdm_params.n_dbps;
 	//compute number of padding bits (17-13)
 	tx_params.n_pad = tx_params.n_data - (16 + 8 * psdu_size + 6);
-	//number of data bytes
-	tx_params.n_data_bytes = tx_params.n_data / 8;
+	//number of data bytes. n_data is not a multiple of 8 for 9 Mbps (and 4.5
+	//Mbps) frames with an odd number of symbols: the last byte is then
+	//incomplete, and its unused bits are counted as padding by the encoder
+	tx_params.n_data_bytes = (tx_params.n_data + 7) / 8;
 	//number of data bytes after encoding and puncturing
-	switch (ofdm_params.coding_rate) {
-		case RATE_1_2:
-			tx_params.n_encoded_data_bytes = tx_params.n_data_bytes * 2;
-			break;
-		case RATE_3_4:
-			tx_params.n_encoded_data_bytes = tx_params.n_data_bytes * 4 / 3;
-			break;
-		case RATE_2_3:
-			tx_params.n_encoded_data_bytes = tx_params.n_data_bytes * 3 / 2;
-			break;
-	}
+	tx_params.n_encoded_data_bytes = tx_params.n_sym * ofdm_params.n_cbps / 8;
 
 	switch (data_rate) {
 
@@ -820,8 +838,8 @@ void generate_data_field(const char *psdu, int length, enum DATA_RATE data_rate,
 	//compute number of padding bits (17-13)
 	n_pad = n_data - (16 + 8 * length + 6);
 
-	//alloc data
-	*data_length = n_data / 8;
+	//alloc data, rounding up to a whole byte (see get_tx_parameters())
+	*data_length = (n_data + 7) / 8;
 	*data = (char *)calloc(*data_length, sizeof(char));
 
 	//calloc function already sets all elements to 0. we just need to copy psdu after first 16 service bits
@@ -829,6 +847,152 @@ void generate_data_field(const char *psdu, int length, enum DATA_RATE data_rate,
 
 }
 
+void init_ofdm_frame_encoder(struct OFDM_FRAME_ENCODER *enc) {
+
+	nanotimer_t pt;
+
+	enc->scrambler_seed = 0x5D;
+	enc->mod = fftw_alloc_complex(N_DATA_SUBCARRIERS);
+	enc->pil = fftw_alloc_complex(N_TOTAL_SUBCARRIERS);
+	enc->ifft = fftw_alloc_complex(FFT_SIZE);
+	enc->time = fftw_alloc_complex(FFT_SIZE);
+	enc->ext = fftw_alloc_complex(EXT_OFDM_SYMBOL_SIZE);
+	enc->signal = fftw_alloc_complex(EXT_SIGNAL_SIZE);
+	enc->short_sequence = fftw_alloc_complex(EXT_SHORT_TRAINING_SIZE);
+	enc->long_sequence = fftw_alloc_complex(EXT_LONG_TRAINING_SIZE);
+
+	//preamble is always the same for every frame
+	pt = profiler_begin(STAGE_PREAMBLE);
+	generate_short_training_sequence(enc->short_sequence);
+	generate_long_training_sequence(enc->long_sequence);
+	profiler_end(STAGE_PREAMBLE, pt);
+
+}
+
+void free_ofdm_frame_encoder(struct OFDM_FRAME_ENCODER *enc) {
+	fftw_free(enc->mod);
+	fftw_free(enc->pil);
+	fftw_free(enc->ifft);
+	fftw_free(enc->time);
+	fftw_free(enc->ext);
+	fftw_free(enc->signal);
+	fftw_free(enc->short_sequence);
+	fftw_free(enc->long_sequence);
+}
+
+void generate_ofdm_frame(struct OFDM_FRAME_ENCODER *enc, const char *psdu, int length, enum DATA_RATE data_rate, fftw_complex **samples, int *n_samples) {
+
+	//ofdm encoding parameters
+	struct OFDM_PARAMETERS params = get_ofdm_parameter(data_rate);
+	//transmission parameters
+	struct TX_PARAMETERS tx_params;
+	//psdu with swapped endianness
+	char *swapped_psdu;
+	//OFDM DATA field
+	char *data;
+	//length of the DATA field
+	int len;
+	//scrambled data field
+	char *scrambled_data;
+	//encoded data field
+	char *encoded_data;
+	//punctured data field
+	char *punctured_data;
+	//interleaved data field
+	char *interleaved_data;
+	//index of data symbol under processing
+	int symbol;
+	//profiler timer
+	nanotimer_t pt;
+
+	pt = profiler_begin(STAGE_DATA_FIELD);
+	//swap the endianness of the psdu
+	swapped_psdu = (char *)malloc(sizeof(char) * length);
+	change_array_endianness(psdu, length, swapped_psdu);
+	//generate the OFDM data field, adding service field and pad bits
+	generate_data_field(swapped_psdu, length, data_rate, &data, &len);
+
+	//get transmission params for the psdu
+	tx_params = get_tx_parameters(data_rate, length);
+	profiler_end(STAGE_DATA_FIELD, pt);
+
+	//alloc memory for modulation steps
+	scrambled_data = (char *)calloc(len, sizeof(char));
+	encoded_data = (char *)calloc(len * 2, sizeof(char));
+	punctured_data = (char *)calloc(tx_params.n_encoded_data_bytes, sizeof(char));
+	interleaved_data = (char *)calloc(tx_params.n_encoded_data_bytes, sizeof(char));
+
+	*n_samples = FRAME_SIZE(tx_params.n_sym);
+	*samples = fftw_alloc_complex(*n_samples);
+	zero_samples(*samples, *n_samples);
+
+	//first step, scrambling
+	pt = profiler_begin(STAGE_SCRAMBLE);
+	scramble_with_initial_state(data, scrambled_data, len, enc->scrambler_seed);
+	//reset tail bits. the unused bits of an incomplete last byte follow the padding
+	reset_tail_bits(scrambled_data, len, tx_params.n_pad + len * 8 - tx_params.n_data);
+	profiler_end(STAGE_SCRAMBLE, pt);
+	//encoding
+	pt = profiler_begin(STAGE_ENCODE);
+	convolutional_encoding(scrambled_data, encoded_data, len);
+	profiler_end(STAGE_ENCODE, pt);
+	//puncturing
+	pt = profiler_begin(STAGE_PUNCTURE);
+	puncturing(encoded_data, punctured_data, tx_params.n_data / 4, params.coding_rate);
+	profiler_end(STAGE_PUNCTURE, pt);
+	//interleaving
+	pt = profiler_begin(STAGE_INTERLEAVE);
+	interleave(punctured_data, interleaved_data, tx_params.n_encoded_data_bytes, params.n_cbps, params.n_bpsc);
+	profiler_end(STAGE_INTERLEAVE, pt);
+
+	//now perform modulation for each symbol
+	for (symbol = 0; symbol < tx_params.n_sym; symbol++) {
+
+		pt = profiler_begin(STAGE_MODULATE);
+		modulate(&interleaved_data[symbol * params.n_cbps / 8], params.n_cbps / 8, data_rate, enc->mod);
+		profiler_end(STAGE_MODULATE, pt);
+
+		pt = profiler_begin(STAGE_PILOTS);
+		insert_pilots(enc->mod, enc->pil, symbol + 1);
+		profiler_end(STAGE_PILOTS, pt);
+
+		pt = profiler_begin(STAGE_IFFT);
+		map_ofdm_to_ifft(enc->pil, enc->ifft);
+
+		perform_ifft(enc->ifft, enc->time);
+		normalize_ifft_output(enc->time, FFT_SIZE, FFT_SIZE);
+		profiler_end(STAGE_IFFT, pt);
+
+		pt = profiler_begin(STAGE_CP_WINDOW);
+		add_cyclic_prefix(enc->time, FFT_SIZE, enc->ext, EXT_OFDM_SYMBOL_SIZE, CYCLIC_PREFIX_SIZE);
+		apply_window_function(enc->ext, EXT_OFDM_SYMBOL_SIZE);
+
+		sum_samples(*samples, enc->ext, EXT_OFDM_SYMBOL_SIZE, (5 + symbol) * OFDM_SYMBOL_SIZE);
+		profiler_end(STAGE_CP_WINDOW, pt);
+
+	}
+
+	//generate signal field and insert it into the frame
+	pt = profiler_begin(STAGE_SIGNAL);
+	generate_signal_field(enc->signal, data_rate, length);
+	sum_samples(*samples, enc->signal, EXT_SIGNAL_SIZE, 4 * OFDM_SYMBOL_SIZE);
+	profiler_end(STAGE_SIGNAL, pt);
+
+	//insert preamble
+	pt = profiler_begin(STAGE_PREAMBLE);
+	sum_samples(*samples, enc->short_sequence, EXT_SHORT_TRAINING_SIZE, 0);
+	sum_samples(*samples, enc->long_sequence, EXT_LONG_TRAINING_SIZE, SHORT_TRAINING_SIZE);
+	profiler_end(STAGE_PREAMBLE, pt);
+
+	free(swapped_psdu);
+	free(data);
+	free(scrambled_data);
+	free(encoded_data);
+	free(punctured_data);
+	free(interleaved_data);
+
+}
+
 void zero_samples(fftw_complex *samples, int size) {
 	int i;
 	for (i = 0; i < size; i++) {
@@ -860,7 +1024,6 @@ int compute_autocorrelation(fftw_complex *samples, int size) {
 	//number of samples taken into account for computing the autocorrelation
 	int n_autocorrelation_samples = 48;
 	int L = 32;
-	double *norm = calloc(size, sizeof(double));
 	int i;
 	double upperProduct = 0, lowerProduct = 0;
 	double auto_correlation, threshold = 1.2;
@@ -875,10 +1038,6 @@ int compute_autocorrelation(fftw_complex *samples, int size) {
 		lowerProduct += pow(samples[i + 16][0], 2) + pow(samples[i + 16][1], 2);
 	}
 
-	for (i = 0; i < size; ++i) {
-		norm[i] = pow(samples[i][0], 2) + pow(samples[i][1], 2);
-	}
-
 	//compute first autocorrelation value
 	assert(lowerProduct != 0);
 	auto_correlation = upperProduct / lowerProduct;
@@ -954,6 +1113,7 @@ double compute_correlation(fftw_complex *samples, fftw_complex *known_samples, i
 
 int detect_long_training_start(fftw_complex *samples, int size) {
 
+	int long_training_start = -1;
 	int i;
 
 	nanotimer_t startt;
@@ -961,6 +1121,7 @@ int detect_long_training_start(fftw_complex *samples, int size) {
 
 	for (i = 0; i < size - 64; i++) {
 		if (compute_correlation(&samples[i], time_long_symbol, 64) > 2) {
+			long_training_start = i;
 			break;
 		}
 	}
@@ -969,6 +1130,8 @@ int detect_long_training_start(fftw_complex *samples, int size) {
 	double elapsed = ((double)elapsed_ns) / 1e9;
 //    printf("processed %d samples in %lu ns. speed: %f Msps\n", i, elapsed_ns, i / elapsed / 1e6);
 
+	return long_training_start;
+
 }
 
 int detect_short_training_start(fftw_complex *samples, int size, double correlation_threshold) {
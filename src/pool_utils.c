@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: parallel decoding of the frames of a capture
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool_utils.h"
+
+/**
+ * Decodes the frame of a job with the given decoder
+ */
+static void run_job(struct OFDM_FRAME_DECODER *dec, struct POOL_JOB *job) {
+	job->frame.err = ofdm_decode_frame(dec, job->samples, job->size, job->frame.psdu, &job->frame.length,
+	                                   &job->frame.stats);
+}
+
+/**
+ * Main loop of a worker thread: takes the oldest job waiting for a worker,
+ * decodes it and marks it as done, until the pool is stopped
+ */
+static void *worker(void *arg) {
+
+	struct DECODER_POOL *p = ((struct POOL_WORKER *)arg)->pool;
+	struct OFDM_FRAME_DECODER *dec = ((struct POOL_WORKER *)arg)->decoder;
+	struct POOL_JOB *job;
+
+	pthread_mutex_lock(&p->mutex);
+	while (1) {
+		while (!p->stop && p->taken == p->queued) {
+			pthread_cond_wait(&p->job_available, &p->mutex);
+		}
+		if (p->stop) {
+			break;
+		}
+		job = &p->jobs[p->taken % POOL_QUEUE_SIZE];
+		p->taken++;
+		pthread_mutex_unlock(&p->mutex);
+
+		run_job(dec, job);
+
+		pthread_mutex_lock(&p->mutex);
+		job->done = 1;
+		pthread_cond_broadcast(&p->job_done);
+	}
+	pthread_mutex_unlock(&p->mutex);
+
+	return NULL;
+
+}
+
+/**
+ * Waits for the oldest job not delivered yet, and gives it to the callback
+ */
+static void deliver_job(struct DECODER_POOL *p, decoded_frame_callback callback, void *arg) {
+	struct POOL_JOB *job = &p->jobs[p->delivered % POOL_QUEUE_SIZE];
+	pthread_mutex_lock(&p->mutex);
+	while (!job->done) {
+		pthread_cond_wait(&p->job_done, &p->mutex);
+	}
+	pthread_mutex_unlock(&p->mutex);
+	callback(&job->frame, arg);
+	p->delivered++;
+}
+
+/**
+ * Hands the samples [offset, offset + size) of the capture to the workers,
+ * first waiting for a free slot if the ring is full. Without workers, the
+ * frame is decoded and delivered right away
+ */
+static void queue_job(struct DECODER_POOL *p, const struct CAPTURE *c, long long offset, int size,
+                      decoded_frame_callback callback, void *arg) {
+
+	struct POOL_JOB *job;
+
+	if (p->queued - p->delivered == POOL_QUEUE_SIZE) {
+		deliver_job(p, callback, arg);
+	}
+	job = &p->jobs[p->queued % POOL_QUEUE_SIZE];
+	//the slot is not used by any worker, so its buffer can be replaced
+	if (job->capacity < size) {
+		fftw_free(job->samples);
+		job->samples = fftw_alloc_complex(size);
+		job->capacity = size;
+	}
+	job->size = read_capture_samples(c, offset, size, job->samples);
+	job->done = 0;
+	job->frame.offset = offset;
+
+	if (p->n_threads == 0) {
+		run_job(&p->decoders[0], job);
+		job->done = 1;
+		p->queued++;
+		deliver_job(p, callback, arg);
+		return;
+	}
+
+	pthread_mutex_lock(&p->mutex);
+	p->queued++;
+	pthread_cond_signal(&p->job_available);
+	pthread_mutex_unlock(&p->mutex);
+
+}
+
+/**
+ * Stops and joins the first n_threads threads of the pool
+ */
+static void stop_threads(struct DECODER_POOL *p, int n_threads) {
+	int i;
+	pthread_mutex_lock(&p->mutex);
+	p->stop = 1;
+	pthread_cond_broadcast(&p->job_available);
+	pthread_mutex_unlock(&p->mutex);
+	for (i = 0; i < n_threads; i++) {
+		pthread_join(p->workers[i].thread, NULL);
+	}
+}
+
+/**
+ * Frees the decoders and the buffers of the pool
+ */
+static void free_pool_memory(struct DECODER_POOL *p) {
+	int i;
+	for (i = 0; i <= p->n_threads; i++) {
+		free_ofdm_frame_decoder(&p->decoders[i]);
+	}
+	for (i = 0; i < POOL_QUEUE_SIZE; i++) {
+		fftw_free(p->jobs[i].samples);
+	}
+	free(p->decoders);
+	free(p->workers);
+	free(p->jobs);
+	fftw_free(p->buffer);
+	pthread_cond_destroy(&p->job_done);
+	pthread_cond_destroy(&p->job_available);
+	pthread_mutex_destroy(&p->mutex);
+}
+
+int init_decoder_pool(struct DECODER_POOL *p, int n_threads) {
+
+	int i;
+
+	if (n_threads < 0 || n_threads > POOL_MAX_THREADS) {
+		return ERR_POOL_THREADS;
+	}
+
+	p->n_threads = n_threads;
+	p->queued = 0;
+	p->taken = 0;
+	p->delivered = 0;
+	p->stop = 0;
+	pthread_mutex_init(&p->mutex, NULL);
+	pthread_cond_init(&p->job_available, NULL);
+	pthread_cond_init(&p->job_done, NULL);
+	p->jobs = (struct POOL_JOB *)malloc(sizeof(struct POOL_JOB) * POOL_QUEUE_SIZE);
+	for (i = 0; i < POOL_QUEUE_SIZE; i++) {
+		p->jobs[i].samples = NULL;
+		p->jobs[i].capacity = 0;
+	}
+	p->buffer = fftw_alloc_complex(POOL_SCAN_BUFFER);
+	p->workers = (struct POOL_WORKER *)malloc(sizeof(struct POOL_WORKER) * n_threads);
+
+	//all the decoders are initialized before any thread starts, as they
+	//plan FFTs and fill shared tables
+	p->decoders = (struct OFDM_FRAME_DECODER *)malloc(sizeof(struct OFDM_FRAME_DECODER) * (n_threads + 1));
+	for (i = 0; i <= n_threads; i++) {
+		init_ofdm_frame_decoder(&p->decoders[i]);
+	}
+	p->bw_10_mhz = p->decoders[0].bw_10_mhz;
+	p->smoothing = p->decoders[0].smoothing;
+	p->filter = p->decoders[0].filter;
+
+	for (i = 0; i < n_threads; i++) {
+		p->workers[i].pool = p;
+		p->workers[i].decoder = &p->decoders[i];
+		if (pthread_create(&p->workers[i].thread, NULL, worker, &p->workers[i]) != 0) {
+			stop_threads(p, i);
+			free_pool_memory(p);
+			return ERR_POOL_THREADS;
+		}
+	}
+
+	return 0;
+
+}
+
+void free_decoder_pool(struct DECODER_POOL *p) {
+	stop_threads(p, p->n_threads);
+	free_pool_memory(p);
+}
+
+int decode_capture(struct DECODER_POOL *p, const struct CAPTURE *c, decoded_frame_callback callback, void *arg) {
+
+	//the decoder used by the scan
+	struct OFDM_FRAME_DECODER *dec = &p->decoders[p->n_threads];
+	struct RX_STATS st;
+	long long n = c->n_samples, pos, first, start, end;
+	int size, err, i;
+
+	for (i = 0; i <= p->n_threads; i++) {
+		p->decoders[i].bw_10_mhz = p->bw_10_mhz;
+		p->decoders[i].smoothing = p->smoothing;
+		p->decoders[i].filter = p->filter;
+	}
+	//the scan only decodes SIGNAL fields
+	dec->filter = NULL;
+	first = p->queued;
+	p->buffer_start = 0;
+	p->buffered = 0;
+
+	pos = 0;
+	while (pos < n) {
+		size = n - pos < POOL_SCAN_WINDOW ? (int)(n - pos) : POOL_SCAN_WINDOW;
+		if (pos < p->buffer_start || pos + size > p->buffer_start + p->buffered) {
+			p->buffer_start = pos;
+			p->buffered = read_capture_samples(c, pos, n - pos < POOL_SCAN_BUFFER ? (int)(n - pos) : POOL_SCAN_BUFFER,
+			                                   p->buffer);
+		}
+		err = ofdm_locate_frame(dec, &p->buffer[pos - p->buffer_start], size, &st);
+
+		if (err == 0) {
+			start = pos + st.start - POOL_JOB_MARGIN;
+			end = pos + st.end + POOL_JOB_MARGIN;
+			start = start < 0 ? 0 : start;
+			end = end > n ? n : end;
+			queue_job(p, c, start, (int)(end - start), callback, arg);
+			pos += st.end;
+		}
+		else if (err == ERR_RX_NO_FRAME) {
+			//a preamble may be across the end of the window
+			if (pos + size == n) {
+				break;
+			}
+			pos += size - POOL_SCAN_OVERLAP;
+		}
+		else if (err == ERR_RX_TRUNCATED && pos + size < n && st.detection > POOL_JOB_MARGIN) {
+			//the frame goes beyond the window: locate it again from its beginning
+			pos += st.detection - POOL_JOB_MARGIN;
+		}
+		else {
+			pos += st.end;
+		}
+	}
+
+	while (p->delivered < p->queued) {
+		deliver_job(p, callback, arg);
+	}
+
+	return (int)(p->queued - first);
+
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: per-stage profiler for the OFDM encoding pipeline
+ *
+ */
+
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+//event id used in the trace for frames
+#define FRAME_EVENT -1
+
+/**
+ * Statistics collected for each stage
+ */
+struct STAGE_STATISTICS {
+	//number of calls
+	unsigned long calls;
+	//total time spent in the stage
+	nanotimer_t total;
+	//shortest and longest call
+	nanotimer_t min, max;
+};
+
+/**
+ * A single event of the trace
+ */
+struct TRACE_EVENT {
+	//stage, or FRAME_EVENT
+	int stage;
+	//frame the event belongs to
+	int frame;
+	//start time and duration
+	nanotimer_t start, duration;
+};
+
+//profiling mode. 0 means disabled
+static int mode = 0;
+//per-stage statistics
+static struct STAGE_STATISTICS statistics[N_PROFILER_STAGES];
+//recorded events
+static struct TRACE_EVENT *events = 0;
+//number of recorded events and size of the events array
+static int n_events = 0, events_size = 0;
+//frame currently being processed (-1 if none)
+static int current_frame = -1;
+//number of frames seen so far
+static int n_frames = 0;
+//start time of the current frame
+static nanotimer_t frame_start;
+//stage begun and not ended yet (-1 if none)
+static int open_stage = -1;
+
+static void record_event(int stage, nanotimer_t start, nanotimer_t duration) {
+
+	if (n_events == events_size) {
+		events_size = events_size ? events_size * 2 : 4096;
+		events = (struct TRACE_EVENT *)realloc(events, events_size * sizeof(struct TRACE_EVENT));
+	}
+
+	events[n_events].stage = stage;
+	events[n_events].frame = current_frame;
+	events[n_events].start = start;
+	events[n_events].duration = duration;
+	n_events++;
+
+}
+
+void profiler_enable(int m) {
+	mode = m;
+	open_stage = -1;
+}
+
+void profiler_reset() {
+
+	memset(statistics, 0, sizeof(statistics));
+	free(events);
+	events = 0;
+	n_events = 0;
+	events_size = 0;
+	current_frame = -1;
+	n_frames = 0;
+	open_stage = -1;
+
+}
+
+nanotimer_t profiler_begin(enum PROFILER_STAGE stage) {
+
+	if (!mode) {
+		return 0;
+	}
+	assert(open_stage == -1);
+	open_stage = stage;
+	return start_timer();
+
+}
+
+void profiler_end(enum PROFILER_STAGE stage, nanotimer_t timer) {
+
+	nanotimer_t elapsed;
+	struct STAGE_STATISTICS *s = &statistics[stage];
+
+	if (!mode || !timer) {
+		return;
+	}
+
+	elapsed = elapsed_nanosecond(timer);
+	assert(open_stage == (int)stage);
+	open_stage = -1;
+
+	if (s->calls == 0 || elapsed < s->min) {
+		s->min = elapsed;
+	}
+	if (elapsed > s->max) {
+		s->max = elapsed;
+	}
+	s->total += elapsed;
+	s->calls++;
+
+	if (mode & PROFILER_TRACE) {
+		record_event(stage, timer, elapsed);
+	}
+
+}
+
+void profiler_frame_begin() {
+
+	if (!mode) {
+		return;
+	}
+
+	current_frame = n_frames++;
+	frame_start = start_timer();
+
+}
+
+void profiler_frame_end() {
+
+	if (!mode || current_frame == -1) {
+		return;
+	}
+
+	if (mode & PROFILER_TRACE) {
+		record_event(FRAME_EVENT, frame_start, elapsed_nanosecond(frame_start));
+	}
+	current_frame = -1;
+
+}
+
+void profiler_print_summary(FILE *f) {
+
+	int i;
+	//time spent in all stages
+	nanotimer_t total = 0;
+
+	for (i = 0; i < N_PROFILER_STAGES; i++) {
+		total += statistics[i].total;
+	}
+
+	fprintf(f, "%-12s %10s %14s %12s %12s %12s %7s\n", "stage", "calls", "total (ns)", "avg (ns)", "min (ns)", "max (ns)", "share");
+
+	for (i = 0; i < N_PROFILER_STAGES; i++) {
+
+		struct STAGE_STATISTICS *s = &statistics[i];
+
+		if (s->calls == 0) {
+			fprintf(f, "%-12s %10d %14s %12s %12s %12s %7s\n", STR_PROFILER_STAGE[i], 0, "-", "-", "-", "-", "-");
+			continue;
+		}
+
+		fprintf(f, "%-12s %10lu %14lu %12.1f %12lu %12lu %6.2f%%\n", STR_PROFILER_STAGE[i], s->calls, s->total,
+		        (double)s->total / s->calls, s->min, s->max, total ? 100.0 * s->total / total : 0);
+
+	}
+
+	fprintf(f, "%-12s %10d %14lu\n", "total", n_frames, total);
+
+}
+
+int profiler_write_trace(FILE *f) {
+
+	int i;
+	//earliest event, used as time origin of the trace
+	nanotimer_t origin = 0;
+
+	for (i = 0; i < n_events; i++) {
+		if (i == 0 || events[i].start < origin) {
+			origin = events[i].start;
+		}
+	}
+
+	fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+
+	for (i = 0; i < n_events; i++) {
+
+		struct TRACE_EVENT *e = &events[i];
+
+		//trace-event timestamps and durations are expressed in microseconds
+		if (e->stage == FRAME_EVENT) {
+			fprintf(f, "{\"name\": \"frame %d\", \"cat\": \"frame\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": 1}",
+			        e->frame, (e->start - origin) / 1e3, e->duration / 1e3);
+		}
+		else {
+			fprintf(f, "{\"name\": \"%s\", \"cat\": \"stage\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": 1, \"args\": {\"frame\": %d}}",
+			        STR_PROFILER_STAGE[e->stage], (e->start - origin) / 1e3, e->duration / 1e3, e->frame);
+		}
+
+		fprintf(f, i != n_events - 1 ? ",\n" : "\n");
+
+	}
+
+	fprintf(f, "]}\n");
+
+	return n_events;
+
+}
@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: decoding of received OFDM frames
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "receiver_utils.h"
+#include "soft_utils.h"
+#include "viterbi_utils.h"
+#include "bit_utils.h"
+#include "mac_utils.h"
+#include "detector_utils.h"
+
+//size of the SIGNAL field in bytes, and position of its bits
+#define SIGNAL_BYTES            (VITERBI_SIGNAL_BITS / 8)
+#define SIGNAL_RATE_BITS        4
+#define SIGNAL_RESERVED_BIT     4
+#define SIGNAL_LENGTH_BIT       5
+#define SIGNAL_LENGTH_BITS      12
+#define SIGNAL_PARITY_BIT       17
+//number of data rates for each channel spacing
+#define N_RATES_PER_BANDWIDTH   8
+//offset of the first long training symbol from the beginning of the frame
+#define LTS_OFFSET              (SHORT_TRAINING_SIZE + 2 * CYCLIC_PREFIX_SIZE)
+//size of the SERVICE field and of the frame check sequence, in bytes
+#define SERVICE_BYTES           2
+#define FCS_BYTES               4
+//size of the chunks given to the short training detector
+#define RX_DETECTION_CHUNK      256
+//bytes of the MAC header checked by the address filter: frame control,
+//duration and address 1
+#define FILTER_HEADER_BYTES     10
+#define ADDRESS1_OFFSET         4
+//trellis steps after which the Viterbi decoder has decided those bytes
+#define FILTER_STEPS            (8 * (SERVICE_BYTES + FILTER_HEADER_BYTES) + VITERBI_TRACEBACK)
+//maximum number of long training peaks collected while searching
+#define MAX_LONG_EVENTS         8
+
+int decode_signal_field(const fftw_complex *data, const double *gain, int bw_10_mhz,
+                        struct TX_PARAMETERS *tx_params) {
+
+	signed char soft[N_DATA_SUBCARRIERS], deinterleaved[N_DATA_SUBCARRIERS];
+	char header[SIGNAL_BYTES], encoded[2 * SIGNAL_BYTES];
+	int i, rate = -1, length = 0, errors = 0;
+	char signal_rate = 0;
+
+	//the SIGNAL field is always BPSK, rate 1/2
+	demap_soft(data, gain, N_DATA_SUBCARRIERS, BPSK, DEMAP_DEFAULT_SCALE, soft);
+	deinterleave_soft(soft, deinterleaved, N_DATA_SUBCARRIERS, N_DATA_SUBCARRIERS, 1);
+	viterbi_decode_signal(deinterleaved, header);
+
+	//cheapest checks first, so that false detections are discarded early
+	if (compute_even_parity(header, 0, SIGNAL_PARITY_BIT + 1) != 0) {
+		return ERR_SIGNAL_PARITY;
+	}
+
+	//a noise symbol is decoded into some field, but far from the received bits
+	convolutional_encoding(header, encoded, SIGNAL_BYTES);
+	for (i = 0; i < N_DATA_SUBCARRIERS; i++) {
+		errors += (deinterleaved[i] > 0) != get_ith_bit(encoded, i);
+	}
+	if (errors > SIGNAL_MAX_CODE_ERRORS) {
+		return ERR_SIGNAL_CODE;
+	}
+
+	//the first transmitted bit is the most significant of the rate
+	for (i = 0; i < SIGNAL_RATE_BITS; i++) {
+		signal_rate = (char)(signal_rate << 1 | get_ith_bit(header, i));
+	}
+	for (i = 0; i < N_RATES_PER_BANDWIDTH; i++) {
+		if (get_ofdm_parameter((enum DATA_RATE)(BW_20_DR_6_MBPS + i)).signal_rate == signal_rate) {
+			rate = i;
+			break;
+		}
+	}
+	if (rate == -1) {
+		return ERR_SIGNAL_RATE;
+	}
+
+	if (get_ith_bit(header, SIGNAL_RESERVED_BIT)) {
+		return ERR_SIGNAL_RESERVED;
+	}
+
+	//the length is transmitted starting from the least significant bit
+	for (i = 0; i < SIGNAL_LENGTH_BITS; i++) {
+		length |= get_ith_bit(header, SIGNAL_LENGTH_BIT + i) << i;
+	}
+	if (length == 0) {
+		return ERR_SIGNAL_LENGTH;
+	}
+
+	*tx_params = get_tx_parameters((enum DATA_RATE)((bw_10_mhz ? BW_10_DR_3_MBPS : BW_20_DR_6_MBPS) + rate), length);
+	return 0;
+
+}
+
+void init_address_filter(struct RX_ADDRESS_FILTER *f, int types) {
+	f->n_addresses = 0;
+	f->types = types;
+}
+
+int add_watched_address(struct RX_ADDRESS_FILTER *f, const char *mac) {
+	if (f->n_addresses == RX_MAX_WATCHED_ADDRESSES) {
+		return ERR_RX_FILTER_FULL;
+	}
+	str_to_mac_address(mac, &f->addresses[f->n_addresses++]);
+	return 0;
+}
+
+/**
+ * Checks the first FILTER_HEADER_BYTES bytes of a MAC header against a filter
+ */
+static int match_address_filter(const struct RX_ADDRESS_FILTER *f, const char *header) {
+
+	dbyte frame_control;
+	int i;
+
+	construct_dbyte(header[0], header[1], &frame_control);
+	if (f->types != 0 && !(f->types & (1 << get_frame_control_type(frame_control, 0)))) {
+		return 0;
+	}
+	if (f->n_addresses == 0) {
+		return 1;
+	}
+	for (i = 0; i < f->n_addresses; i++) {
+		if (memcmp(f->addresses[i], &header[ADDRESS1_OFFSET], sizeof(mac_address_t)) == 0) {
+			return 1;
+		}
+	}
+	return 0;
+
+}
+
+/**
+ * Descrambles the beginning of the decoded DATA field and checks the MAC
+ * header against the filter of the decoder
+ */
+static int check_address_filter(struct OFDM_FRAME_DECODER *dec) {
+	char header[FILTER_HEADER_BYTES];
+	scramble_with_initial_state(dec->decoded, dec->descrambled, SERVICE_BYTES + FILTER_HEADER_BYTES,
+	                            get_scrambler_initial_state(dec->decoded));
+	change_array_endianness(&dec->descrambled[SERVICE_BYTES], FILTER_HEADER_BYTES, header);
+	return match_address_filter(dec->filter, header);
+}
+
+/**
+ * Fills the tables that the functions used by the receiver compute at their
+ * first call, so that decoders initialized beforehand can then be used by
+ * several threads at the same time
+ */
+static void init_receiver_tables(struct OFDM_FRAME_DECODER *dec) {
+	signed char soft[N_DATA_SUBCARRIERS * 6], deinterleaved[N_DATA_SUBCARRIERS * 6];
+	int n_bpsc;
+	memset(soft, 0, sizeof(soft));
+	for (n_bpsc = 1; n_bpsc <= 6; n_bpsc += n_bpsc == 1 ? 1 : 2) {
+		deinterleave_soft(soft, deinterleaved, N_DATA_SUBCARRIERS * n_bpsc, N_DATA_SUBCARRIERS * n_bpsc, n_bpsc);
+	}
+	init_viterbi_decoder(&dec->viterbi, RATE_1_2);
+	init_nco(&dec->nco, 0);
+	crc32(dec->decoded, 0);
+}
+
+void init_ofdm_frame_decoder(struct OFDM_FRAME_DECODER *dec) {
+	dec->bw_10_mhz = 0;
+	dec->smoothing = 0;
+	dec->filter = NULL;
+	init_ofdm_demodulator(&dec->demodulator);
+	init_nco(&dec->nco, 0);
+	dec->corrected = fftw_alloc_complex(RX_SEARCH_SIZE);
+	dec->decoded = (char *)malloc(sizeof(char) * RX_MAX_DATA_BYTES);
+	dec->descrambled = (char *)malloc(sizeof(char) * RX_MAX_DATA_BYTES);
+	init_receiver_tables(dec);
+}
+
+void free_ofdm_frame_decoder(struct OFDM_FRAME_DECODER *dec) {
+	free_ofdm_demodulator(&dec->demodulator);
+	fftw_free(dec->corrected);
+	free(dec->decoded);
+	free(dec->descrambled);
+}
+
+/**
+ * Removes the frequency offset from the next OFDM symbol and demodulates it.
+ * The NCO runs over the cyclic prefix as well, so that its phase follows
+ * the samples
+ */
+static void receive_symbol(struct OFDM_FRAME_DECODER *dec, const fftw_complex *samples, fftw_complex *out) {
+	derotate(&dec->nco, samples, dec->corrected, OFDM_SYMBOL_SIZE);
+	demodulate_symbol(&dec->demodulator, &dec->corrected[CYCLIC_PREFIX_SIZE], out);
+}
+
+/**
+ * Body of ofdm_locate_frame(), storing the information about the frame into
+ * st as soon as it is known. On success, lts_start is the first sample of the
+ * FFT window of the first long training symbol, the NCO is at the first
+ * sample of the first DATA symbol and the channel estimate is ready
+ */
+static int locate_frame(struct OFDM_FRAME_DECODER *dec, const fftw_complex *samples, int n, struct RX_STATS *st,
+                        int *lts_start) {
+
+	struct SHORT_TRAINING_DETECTOR short_detector;
+	struct LONG_TRAINING_DETECTOR long_detector;
+	struct DETECTION_EVENT events[MAX_LONG_EVENTS];
+	struct TX_PARAMETERS tx_params;
+	fftw_complex subcarriers[N_TOTAL_SUBCARRIERS], data[N_DATA_SUBCARRIERS];
+	double coarse;
+	int detection, search, lts, n_events, err, i;
+
+	//detection of the short training sequence. The detector consumes whole
+	//chunks, so samples are given in chunks to stop soon after the detection
+	init_short_training_detector(&short_detector);
+	detection = -1;
+	for (i = 0; i < n && detection == -1; i += RX_DETECTION_CHUNK) {
+		detection = update_short_training_detector(&short_detector, &samples[i],
+		                                           n - i < RX_DETECTION_CHUNK ? n - i : RX_DETECTION_CHUNK,
+		                                           RX_SHORT_THRESHOLD, NULL);
+		if (detection != -1) {
+			detection += i;
+		}
+	}
+	if (detection == -1 || n - detection < RX_SEARCH_SIZE) {
+		return ERR_RX_NO_FRAME;
+	}
+	st->detection = detection;
+	//on failure, skip the whole preamble, like the event based detector does
+	st->end = detection + SC_HOLDOFF < n ? detection + SC_HOLDOFF : n;
+
+	//the samples following the detection belong to the short training
+	//sequence, which gives the coarse offset
+	coarse = estimate_coarse_cfo(&samples[detection], RX_COARSE_CFO_SIZE);
+
+	//search the first long training symbol, after removing the coarse offset
+	init_nco(&dec->nco, coarse);
+	derotate(&dec->nco, &samples[detection], dec->corrected, RX_SEARCH_SIZE);
+	init_long_training_detector(&long_detector);
+	n_events = detect_long_training_events(&long_detector, dec->corrected, RX_SEARCH_SIZE, RX_LONG_THRESHOLD, events,
+	                                       MAX_LONG_EVENTS);
+	search = -1;
+	for (i = 0; i < n_events; i++) {
+		//the first symbol is followed by the second one, which must be
+		//within the window as well
+		if (events[i].sample >= RX_TIMING_BACKOFF && events[i].sample + 2 * FFT_SIZE <= RX_SEARCH_SIZE) {
+			search = (int)events[i].sample - RX_TIMING_BACKOFF;
+			break;
+		}
+	}
+	if (search == -1) {
+		return ERR_RX_NO_LONG_TRAINING;
+	}
+	lts = detection + search;
+	st->start = lts + RX_TIMING_BACKOFF - LTS_OFFSET;
+	st->cfo = coarse + estimate_fine_cfo(&dec->corrected[search]);
+
+	//from now on, the whole offset is removed
+	init_nco(&dec->nco, st->cfo);
+	derotate(&dec->nco, &samples[lts], dec->corrected, 2 * FFT_SIZE);
+	estimate_channel(&dec->demodulator, dec->corrected, dec->smoothing, &dec->channel);
+	st->snr = dec->channel.snr;
+
+	//SIGNAL field
+	if (lts + 2 * FFT_SIZE + OFDM_SYMBOL_SIZE > n) {
+		return ERR_RX_TRUNCATED;
+	}
+	receive_symbol(dec, &samples[lts + 2 * FFT_SIZE], subcarriers);
+	equalize_symbol_with_pilots(&dec->channel, subcarriers, 0, 0, subcarriers, NULL, NULL);
+	extract_data_subcarriers(subcarriers, data, NULL);
+	err = decode_signal_field(data, dec->channel.data_gain, dec->bw_10_mhz, &tx_params);
+	if (err != 0) {
+		return err;
+	}
+	st->tx_params = tx_params;
+	if (lts + 2 * FFT_SIZE + (tx_params.n_sym + 1) * OFDM_SYMBOL_SIZE > n) {
+		return ERR_RX_TRUNCATED;
+	}
+	st->end = lts + RX_TIMING_BACKOFF + 2 * FFT_SIZE + (tx_params.n_sym + 1) * OFDM_SYMBOL_SIZE;
+	*lts_start = lts;
+
+	return 0;
+
+}
+
+/**
+ * Body of ofdm_decode_frame()
+ */
+static int decode_frame(struct OFDM_FRAME_DECODER *dec, const fftw_complex *samples, int n, char *psdu, int *length,
+                        struct RX_STATS *st) {
+
+	struct TX_PARAMETERS tx_params;
+	struct OFDM_PARAMETERS params;
+	fftw_complex subcarriers[N_TOTAL_SUBCARRIERS], data[N_DATA_SUBCARRIERS];
+	signed char soft[N_DATA_SUBCARRIERS * 6], deinterleaved[N_DATA_SUBCARRIERS * 6];
+	int lts, symbol, err;
+	//whether the MAC header still has to be checked by the address filter
+	int filtering;
+	unsigned int fcs;
+
+	err = locate_frame(dec, samples, n, st, &lts);
+	if (err != 0) {
+		return err;
+	}
+	tx_params = st->tx_params;
+
+	//DATA field, one symbol at a time
+	params = get_ofdm_parameter(tx_params.data_rate);
+	init_viterbi_decoder(&dec->viterbi, params.coding_rate);
+	memset(dec->decoded, 0, tx_params.n_data_bytes + 1);
+	filtering = dec->filter != NULL && tx_params.psdu_size >= FILTER_HEADER_BYTES;
+	for (symbol = 0; symbol < tx_params.n_sym; symbol++) {
+		receive_symbol(dec, &samples[lts + 2 * FFT_SIZE + (symbol + 1) * OFDM_SYMBOL_SIZE], subcarriers);
+		equalize_symbol_with_pilots(&dec->channel, subcarriers, symbol + 1, 1, subcarriers, NULL, NULL);
+		extract_data_subcarriers(subcarriers, data, NULL);
+		demap_soft(data, dec->channel.data_gain, N_DATA_SUBCARRIERS, params.modulation, DEMAP_DEFAULT_SCALE, soft);
+		deinterleave_soft(soft, deinterleaved, params.n_cbps, params.n_cbps, params.n_bpsc);
+		viterbi_decoder_push(&dec->viterbi, deinterleaved, params.n_cbps, dec->decoded);
+		st->n_decoded_symbols = symbol + 1;
+		//drop the frame as soon as the header can be decided
+		if (filtering && dec->viterbi.steps >= FILTER_STEPS) {
+			viterbi_decoder_peek(&dec->viterbi, dec->decoded);
+			if (!check_address_filter(dec)) {
+				return ERR_RX_FILTERED;
+			}
+			filtering = 0;
+		}
+	}
+	//pad bits follow the tail, so the encoder does not end in the zero state
+	viterbi_decoder_finish(&dec->viterbi, 0, dec->decoded);
+	//frames too short for the check to be done while decoding
+	if (filtering && !check_address_filter(dec)) {
+		return ERR_RX_FILTERED;
+	}
+
+	//descrambling, and PSDU back to the byte order of the MAC layer
+	st->scrambler_seed = get_scrambler_initial_state(dec->decoded);
+	scramble_with_initial_state(dec->decoded, dec->descrambled, tx_params.n_data_bytes, st->scrambler_seed);
+	change_array_endianness(&dec->descrambled[SERVICE_BYTES], tx_params.psdu_size, psdu);
+	*length = tx_params.psdu_size;
+
+	//the frame check sequence is stored as by generate_mac_data_frame()
+	if (tx_params.psdu_size < FCS_BYTES) {
+		return ERR_RX_FCS;
+	}
+	fcs = crc32(psdu, tx_params.psdu_size - FCS_BYTES);
+	if (memcmp(&fcs, &psdu[tx_params.psdu_size - FCS_BYTES], FCS_BYTES) != 0) {
+		return ERR_RX_FCS;
+	}
+
+	return 0;
+
+}
+
+int ofdm_decode_frame(struct OFDM_FRAME_DECODER *dec, const fftw_complex *samples, int n, char *psdu, int *length,
+                      struct RX_STATS *stats) {
+
+	struct RX_STATS st;
+	int err;
+
+	memset(&st, 0, sizeof(st));
+	st.detection = -1;
+	st.end = n;
+	err = decode_frame(dec, samples, n, psdu, length, &st);
+	if (stats != NULL) {
+		*stats = st;
+	}
+	return err;
+
+}
+
+int ofdm_locate_frame(struct OFDM_FRAME_DECODER *dec, const fftw_complex *samples, int n, struct RX_STATS *stats) {
+
+	struct RX_STATS st;
+	int lts, err;
+
+	memset(&st, 0, sizeof(st));
+	st.detection = -1;
+	st.end = n;
+	err = locate_frame(dec, samples, n, &st, &lts);
+	if (stats != NULL) {
+		*stats = st;
+	}
+	return err;
+
+}
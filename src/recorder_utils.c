@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: triggered recording of the frames of a sample stream
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "recorder_utils.h"
+
+//samples given to the decoder before a detection and after the end of a frame
+#define DECODER_MARGIN 32
+//samples given to the decoder to locate a frame, which include its SIGNAL field
+#define LOCATE_SIZE 1024
+//scale of sc16 samples
+#define SC16_SCALE (1.0f / 32768)
+
+int init_triggered_recorder(struct TRIGGERED_RECORDER *r, enum CAPTURE_FORMAT format, const char *filename,
+                            const char *indexfile) {
+
+	r->out = fopen(filename, "wb");
+	if (r->out == NULL) {
+		return ERR_RECORDER_CANNOT_WRITE;
+	}
+	r->has_index = indexfile != NULL;
+	if (r->has_index && create_frame_index(&r->index, indexfile, format) != 0) {
+		fclose(r->out);
+		return ERR_INDEX_CANNOT_WRITE;
+	}
+
+	r->threshold = RX_SHORT_THRESHOLD;
+	r->pre_trigger = RECORDER_DEFAULT_PRE_TRIGGER;
+	r->post_trigger = RECORDER_DEFAULT_POST_TRIGGER;
+	r->decode = 0;
+	r->condition = 0;
+	r->format = format;
+	r->sample_size = format == CAPTURE_SC16 ? sizeof(sample_sc16_t) : sizeof(sample_cf32_t);
+	init_energy_gate(&r->gate);
+	init_signal_conditioner(&r->conditioner);
+	init_short_training_detector_f(&r->detector);
+	init_ofdm_frame_decoder(&r->decoder);
+	r->ring = (unsigned char *)malloc(r->sample_size * RECORDER_RING_SIZE);
+	r->block = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * RECORDER_BLOCK_SIZE);
+	r->frame = fftw_alloc_complex(RX_MAX_FRAME_SIZE + 2 * DECODER_MARGIN);
+	r->n_pending = 0;
+	r->written_end = 0;
+	r->n_samples = 0;
+	r->n_written = 0;
+	r->n_frames = 0;
+	r->n_dropped = 0;
+
+	return 0;
+
+}
+
+void free_triggered_recorder(struct TRIGGERED_RECORDER *r) {
+	fclose(r->out);
+	if (r->has_index) {
+		close_frame_index_writer(&r->index);
+	}
+	free_ofdm_frame_decoder(&r->decoder);
+	free(r->ring);
+	free(r->block);
+	fftw_free(r->frame);
+}
+
+/**
+ * Returns the part of the ring holding the samples from the given one on,
+ * and sets n to the number of them that are contiguous, up to the given n
+ */
+static const unsigned char *ring_samples(struct TRIGGERED_RECORDER *r, long long sample, int *n) {
+	int index = (int)(sample & (RECORDER_RING_SIZE - 1));
+	if (index + *n > RECORDER_RING_SIZE) {
+		*n = RECORDER_RING_SIZE - index;
+	}
+	return &r->ring[index * r->sample_size];
+}
+
+/**
+ * Copies samples of the stream from the ring to a double precision array
+ */
+static void read_ring(struct TRIGGERED_RECORDER *r, long long sample, int size, fftw_complex *out) {
+	const unsigned char *in;
+	int n, i;
+	while (size > 0) {
+		n = size;
+		in = ring_samples(r, sample, &n);
+		for (i = 0; i < n; i++) {
+			if (r->format == CAPTURE_SC16) {
+				out[i][0] = ((const sample_sc16_t *)in)[i][0] * SC16_SCALE;
+				out[i][1] = ((const sample_sc16_t *)in)[i][1] * SC16_SCALE;
+			}
+			else {
+				out[i][0] = ((const sample_cf32_t *)in)[i][0];
+				out[i][1] = ((const sample_cf32_t *)in)[i][1];
+			}
+		}
+		sample += n;
+		out += n;
+		size -= n;
+	}
+}
+
+/**
+ * Writes samples of the stream from the ring to the recorded file
+ */
+static int write_ring(struct TRIGGERED_RECORDER *r, long long sample, long long size) {
+	const unsigned char *in;
+	int n;
+	while (size > 0) {
+		n = size < RECORDER_RING_SIZE ? (int)size : RECORDER_RING_SIZE;
+		in = ring_samples(r, sample, &n);
+		if (fwrite(in, r->sample_size, n, r->out) != (size_t)n) {
+			return ERR_RECORDER_CANNOT_WRITE;
+		}
+		sample += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/**
+ * Removes the oldest pending detection
+ */
+static void pop_trigger(struct TRIGGERED_RECORDER *r) {
+	r->n_pending--;
+	memmove(&r->pending[0], &r->pending[1], sizeof(struct RECORDER_TRIGGER) * r->n_pending);
+}
+
+/**
+ * Decodes the SIGNAL field of the oldest pending detection, which gives where
+ * its frame ends. Returns 0 if the detection is not a frame
+ */
+static int locate_trigger(struct TRIGGERED_RECORDER *r, struct RECORDER_TRIGGER *t) {
+
+	long long base = t->detection > DECODER_MARGIN ? t->detection - DECODER_MARGIN : 0;
+	int err;
+
+	read_ring(r, base, LOCATE_SIZE, r->frame);
+	err = ofdm_locate_frame(&r->decoder, r->frame, LOCATE_SIZE, &t->stats);
+	//the frame is longer than the samples given to the decoder, but the
+	//SIGNAL field is within them
+	if (err != 0 && (err != ERR_RX_TRUNCATED || t->stats.tx_params.n_sym == 0)) {
+		return 0;
+	}
+	t->located = 1;
+	t->start = base + t->stats.start;
+	t->end = t->start + FRAME_SIZE(t->stats.tx_params.n_sym);
+	//the end of the frame as the decoder would give it
+	t->stats.end = t->stats.start + FRAME_SIZE(t->stats.tx_params.n_sym) - 1;
+
+	return 1;
+
+}
+
+/**
+ * Writes the window of the oldest pending detection, whose frame is
+ * complete, and appends its record to the index
+ */
+static int record_trigger(struct TRIGGERED_RECORDER *r, struct RECORDER_TRIGGER *t) {
+
+	struct FRAME_INDEX_RECORD record;
+	long long window_start, window_end, base;
+	char psdu[RX_MAX_PSDU_SIZE];
+	int size, length, status, err;
+
+	window_start = t->start - r->pre_trigger;
+	window_start = window_start > r->written_end ? window_start : r->written_end;
+	window_end = t->end + r->post_trigger;
+
+	//the position of the frame is the one found with the SIGNAL field,
+	//unless the whole frame is decoded
+	base = t->start - t->stats.start;
+	status = FRAME_INDEX_NOT_DECODED;
+	if (r->decode) {
+		base = t->start > DECODER_MARGIN ? t->start - DECODER_MARGIN : 0;
+		size = (int)(t->end + DECODER_MARGIN < r->n_samples ? t->end + DECODER_MARGIN - base : r->n_samples - base);
+		read_ring(r, base, size, r->frame);
+		status = ofdm_decode_frame(&r->decoder, r->frame, size, psdu, &length, &t->stats);
+	}
+
+	err = write_ring(r, window_start, window_end - window_start);
+	if (err != 0) {
+		return err;
+	}
+	if (r->has_index) {
+		make_frame_index_record(r->n_written + base - window_start, status, &t->stats, &record);
+		err = append_frame_index_record(&r->index, &record);
+		if (err != 0) {
+			return err;
+		}
+	}
+	r->n_written += window_end - window_start;
+	r->written_end = window_end;
+	r->n_frames++;
+
+	return 0;
+
+}
+
+/**
+ * Handles the pending detections, in order, as far as the samples received
+ * allow. Returns the number of frames written, or an error
+ */
+static int process_triggers(struct TRIGGERED_RECORDER *r) {
+
+	struct RECORDER_TRIGGER *t;
+	int n_frames = 0, err;
+
+	while (r->n_pending > 0) {
+		t = &r->pending[0];
+		if (!t->located) {
+			if (r->n_samples < t->detection + LOCATE_SIZE) {
+				break;
+			}
+			if (!locate_trigger(r, t)) {
+				r->n_dropped++;
+				pop_trigger(r);
+				continue;
+			}
+			//detections within the frame are dropped
+			while (r->n_pending > 1 && r->pending[1].detection < t->end) {
+				r->n_dropped++;
+				r->n_pending--;
+				memmove(&r->pending[1], &r->pending[2], sizeof(struct RECORDER_TRIGGER) * (r->n_pending - 1));
+			}
+		}
+		if (r->n_samples < t->end + r->post_trigger + DECODER_MARGIN) {
+			break;
+		}
+		err = record_trigger(r, t);
+		if (err != 0) {
+			return err;
+		}
+		pop_trigger(r);
+		n_frames++;
+	}
+
+	return n_frames;
+
+}
+
+int push_recorder_samples(struct TRIGGERED_RECORDER *r, const void *samples, int size) {
+
+	struct DETECTION_EVENT events[RECORDER_BLOCK_SIZE / SC_HOLDOFF + 2];
+	const unsigned char *in = (const unsigned char *)samples;
+	const sample_cf32_t *block;
+	unsigned char *ring;
+	struct RECORDER_TRIGGER *t;
+	int n, copied, n_events, n_frames = 0, err, i;
+
+	while (size > 0) {
+		n = size < RECORDER_BLOCK_SIZE ? size : RECORDER_BLOCK_SIZE;
+
+		//into the ring, possibly in two parts
+		for (i = 0; i < n; i += copied) {
+			copied = n - i;
+			ring = (unsigned char *)ring_samples(r, r->n_samples + i, &copied);
+			memcpy(ring, &in[i * r->sample_size], copied * r->sample_size);
+		}
+
+		if (r->format == CAPTURE_SC16) {
+			for (i = 0; i < n; i++) {
+				r->block[i][0] = ((const sample_sc16_t *)in)[i][0] * SC16_SCALE;
+				r->block[i][1] = ((const sample_sc16_t *)in)[i][1] * SC16_SCALE;
+			}
+			block = r->block;
+		}
+		else {
+			block = (const sample_cf32_t *)in;
+		}
+		if (r->condition) {
+			condition_samples(&r->conditioner, block, r->block, n);
+			block = r->block;
+		}
+		n_events = detect_short_training_events_gated_f(&r->gate, &r->detector, block, n, (float)r->threshold, events,
+		                                                RECORDER_BLOCK_SIZE / SC_HOLDOFF + 2);
+		for (i = 0; i < n_events; i++) {
+			if (r->n_pending == RECORDER_MAX_PENDING) {
+				r->n_dropped++;
+				continue;
+			}
+			t = &r->pending[r->n_pending++];
+			t->detection = events[i].sample > 0 ? events[i].sample : 0;
+			t->located = 0;
+		}
+		r->n_samples += n;
+
+		err = process_triggers(r);
+		if (err < 0) {
+			return err;
+		}
+		n_frames += err;
+		in += n * r->sample_size;
+		size -= n;
+	}
+
+	return n_frames;
+
+}
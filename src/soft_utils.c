@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: soft bit processing of the receive chain
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "soft_utils.h"
+
+/**
+ * Deinterleaving tables of BPSK, QPSK, QAM16 and QAM64, indexed by
+ * n_bpsc / 2: the soft bit k of an OFDM symbol comes from the interleaved
+ * soft bit deinterleave_table[k]. Each table is filled at its first use
+ */
+static short deinterleave_table[4][N_DATA_SUBCARRIERS * 6];
+static int deinterleave_table_ready[4] = {0, 0, 0, 0};
+
+/**
+ * Depuncturing patterns: each period of soft_bits input values gives
+ * coded_bits output values, where output k is the input index[k] of the
+ * period, or an erasure if index[k] is -1. The dropped bits are the same of
+ * puncturing()
+ */
+struct DEPUNCTURING_PATTERN {
+	int soft_bits;
+	int coded_bits;
+	signed char index[6];
+};
+static const struct DEPUNCTURING_PATTERN pattern_2_3 = {3, 4, {0, 1, 2, -1}};
+static const struct DEPUNCTURING_PATTERN pattern_3_4 = {4, 6, {0, 1, 2, -1, -1, 3}};
+
+/**
+ * Saturates a soft value and truncates it toward zero. Rounding to the
+ * nearest integer would keep the loops from being vectorized with SSE2
+ */
+static inline signed char quantize(float v) {
+	v = v > SOFT_MAX ? SOFT_MAX : v;
+	v = v < -SOFT_MAX ? -SOFT_MAX : v;
+	return (signed char)v;
+}
+
+/**
+ * Interleaves the planes of the soft bits of a block of subcarriers
+ */
+#define INTERLEAVE_PLANES(n_bpsc) \
+	for (k = 0; k < n; k++) { \
+		for (j = 0; j < (n_bpsc); j++) { \
+			out[(base + k) * (n_bpsc) + j] = plane[j][k]; \
+		} \
+	}
+
+void demap_soft(const fftw_complex *in, const double *gain, int size, enum MODULATION_TYPE modulation, double scale,
+                signed char *out) {
+
+	//components normalized to the constellation step, and weights, of a
+	//block of subcarriers. single precision is enough for 8 bit outputs, and
+	//doubles the number of subcarriers per vector
+	float x[N_DATA_SUBCARRIERS], y[N_DATA_SUBCARRIERS], w[N_DATA_SUBCARRIERS];
+	//soft values of each bit of a subcarrier, for the block
+	signed char plane[6][N_DATA_SUBCARRIERS];
+	double norm;
+	int n_bpsc, base, n, k, j;
+
+	switch (modulation) {
+		case QPSK:
+			norm = 1 / QPSK_NORMALIZATION;
+			n_bpsc = 2;
+			break;
+		case QAM16:
+			norm = 1 / QAM16_NORMALIZATION;
+			n_bpsc = 4;
+			break;
+		case QAM64:
+			norm = 1 / QAM64_NORMALIZATION;
+			n_bpsc = 6;
+			break;
+		default:
+			norm = 1 / BPSK_NORMALIZATION;
+			n_bpsc = 1;
+			break;
+	}
+
+	//blocks of one OFDM symbol, so that working arrays live on the stack.
+	//each loop works on planar arrays, which the compiler can vectorize
+	for (base = 0; base < size; base += N_DATA_SUBCARRIERS) {
+
+		n = size - base < N_DATA_SUBCARRIERS ? size - base : N_DATA_SUBCARRIERS;
+
+		for (k = 0; k < n; k++) {
+			x[k] = (float)(in[base + k][0] * norm);
+			y[k] = (float)(in[base + k][1] * norm);
+		}
+		if (gain) {
+			for (k = 0; k < n; k++) {
+				w[k] = (float)(scale * gain[base + k]);
+			}
+		}
+		else {
+			for (k = 0; k < n; k++) {
+				w[k] = (float)scale;
+			}
+		}
+
+		switch (modulation) {
+
+			case BPSK:
+				for (k = 0; k < n; k++) {
+					plane[0][k] = quantize(w[k] * x[k]);
+				}
+				break;
+
+			case QPSK:
+				for (k = 0; k < n; k++) {
+					plane[0][k] = quantize(w[k] * x[k]);
+					plane[1][k] = quantize(w[k] * y[k]);
+				}
+				break;
+
+			case QAM16:
+				for (k = 0; k < n; k++) {
+					plane[0][k] = quantize(w[k] * x[k]);
+					plane[1][k] = quantize(w[k] * (2 - fabsf(x[k])));
+					plane[2][k] = quantize(w[k] * y[k]);
+					plane[3][k] = quantize(w[k] * (2 - fabsf(y[k])));
+				}
+				break;
+
+			case QAM64:
+				for (k = 0; k < n; k++) {
+					plane[0][k] = quantize(w[k] * x[k]);
+					plane[1][k] = quantize(w[k] * (4 - fabsf(x[k])));
+					plane[2][k] = quantize(w[k] * (2 - fabsf(4 - fabsf(x[k]))));
+					plane[3][k] = quantize(w[k] * y[k]);
+					plane[4][k] = quantize(w[k] * (4 - fabsf(y[k])));
+					plane[5][k] = quantize(w[k] * (2 - fabsf(4 - fabsf(y[k]))));
+				}
+				break;
+
+		}
+
+		//interleave the bits of each subcarrier. the stride is known for each
+		//modulation, so that the loops can be unrolled
+		switch (n_bpsc) {
+			case 1:
+				memcpy(&out[base], plane[0], n);
+				break;
+			case 2:
+				INTERLEAVE_PLANES(2);
+				break;
+			case 4:
+				INTERLEAVE_PLANES(4);
+				break;
+			default:
+				INTERLEAVE_PLANES(6);
+				break;
+		}
+
+	}
+
+}
+
+/**
+ * Fills the deinterleaving table for the given parameters, with the same
+ * permutations used by interleave()
+ */
+static void init_deinterleave_table(short *table, int n_cbps, int n_bpsc) {
+
+	int k, i, j;
+	int s = n_bpsc > 1 ? n_bpsc / 2 : 1;
+
+	for (k = 0; k < n_cbps; k++) {
+		//first permutation
+		i = (n_cbps / 16) * (k % 16) + k / 16;
+		//second permutation
+		j = s * (i / s) + (i + n_cbps - 16 * i / n_cbps) % s;
+		table[k] = (short)j;
+	}
+
+}
+
+int deinterleave_soft(const signed char *in, signed char *out, int size, int n_cbps, int n_bpsc) {
+
+	int t = n_bpsc / 2;
+	short *table = deinterleave_table[t];
+	int base, k;
+
+	//the tables are only keyed by n_bpsc
+	if ((n_bpsc != 1 && n_bpsc != 2 && n_bpsc != 4 && n_bpsc != 6) || n_cbps != N_DATA_SUBCARRIERS * n_bpsc) {
+		return ERR_SOFT_INTERLEAVER;
+	}
+	if (!deinterleave_table_ready[t]) {
+		init_deinterleave_table(table, n_cbps, n_bpsc);
+		deinterleave_table_ready[t] = 1;
+	}
+
+	for (base = 0; base < size; base += n_cbps) {
+		for (k = 0; k < n_cbps; k++) {
+			out[base + k] = in[base + table[k]];
+		}
+	}
+
+	return 0;
+
+}
+
+int depuncture_soft(const signed char *in, int size, enum CODING_RATE rate, signed char *out) {
+
+	const struct DEPUNCTURING_PATTERN *p;
+	int i = 0, o = 0, k;
+
+	switch (rate) {
+		case RATE_2_3:
+			p = &pattern_2_3;
+			break;
+		case RATE_3_4:
+			p = &pattern_3_4;
+			break;
+		default:
+			memcpy(out, in, size);
+			return size;
+	}
+
+	//whole periods
+	for (; i + p->soft_bits <= size; i += p->soft_bits, o += p->coded_bits) {
+		for (k = 0; k < p->coded_bits; k++) {
+			out[o + k] = p->index[k] < 0 ? 0 : in[i + p->index[k]];
+		}
+	}
+	//last partial period, up to the last input value
+	for (k = 0; i < size; k++) {
+		out[o++] = p->index[k] < 0 ? 0 : in[i++];
+	}
+
+	return o;
+
+}
@@ -21,22 +21,156 @@
 
 #include "utils.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_TSC
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+#ifndef CLOCK_MONOTONIC_RAW
+#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+
+//backend currently in use
+static enum TIMER_BACKEND backend = TIMER_MONOTONIC_RAW;
+
+#ifdef HAVE_TSC
+//conversion factor from TSC ticks to nanoseconds, as a 32.32 fixed point value
+static unsigned long long tsc_mult = 0;
+#endif
+
+#ifdef __APPLE__
+//conversion factor from mach ticks to nanoseconds
+static mach_timebase_info_data_t timebase;
+#endif
+
+/**
+ * Reads the given clock as an integer number of nanoseconds. Computing the
+ * value through a double (tv_sec * 1e9) would cost precision
+ */
+static inline nanotimer_t read_clock(clockid_t clock) {
+	struct timespec current_time;
+	clock_gettime(clock, &current_time);
+	return (nanotimer_t)current_time.tv_sec * 1000000000UL + (nanotimer_t)current_time.tv_nsec;
+}
+
+#ifdef HAVE_TSC
+
+static inline nanotimer_t tsc_to_nanosecond(unsigned long long ticks) {
+#ifdef __x86_64__
+	return (nanotimer_t)(((unsigned __int128)ticks * tsc_mult) >> 32);
+#else
+	return (nanotimer_t)((long double)ticks * tsc_mult / 4294967296.0L);
+#endif
+}
+
+/**
+ * Calibrates the TSC frequency against CLOCK_MONOTONIC_RAW. Returns 0 on
+ * success, or ERR_TIMER_NOT_SUPPORTED if the TSC is not invariant, i.e., if
+ * its frequency might change with the frequency of the core
+ */
+static int calibrate_tsc() {
+
+	unsigned int eax, ebx, ecx, edx;
+	unsigned long long tsc_start, tsc_end;
+	nanotimer_t ns_start, ns_end;
+	struct timespec wait = {0, 20000000};
+
+	//check for the invariant TSC bit (CPUID.80000007H:EDX[8])
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8))) {
+		return ERR_TIMER_NOT_SUPPORTED;
+	}
+
+	ns_start = read_clock(CLOCK_MONOTONIC_RAW);
+	tsc_start = __rdtsc();
+	nanosleep(&wait, 0);
+	ns_end = read_clock(CLOCK_MONOTONIC_RAW);
+	tsc_end = __rdtsc();
+
+	if (tsc_end <= tsc_start) {
+		return ERR_TIMER_NOT_SUPPORTED;
+	}
+
+	tsc_mult = (unsigned long long)(((long double)(ns_end - ns_start) * 4294967296.0L) / (tsc_end - tsc_start));
+
+	return 0;
+
+}
+
+#endif
+
+int set_timer_backend(enum TIMER_BACKEND b) {
+
+	if (b == TIMER_TSC) {
+#ifdef HAVE_TSC
+		if (!tsc_mult && calibrate_tsc() != 0) {
+			return ERR_TIMER_NOT_SUPPORTED;
+		}
+#else
+		return ERR_TIMER_NOT_SUPPORTED;
+#endif
+	}
+
+	backend = b;
+	return 0;
+
+}
+
+enum TIMER_BACKEND get_timer_backend() {
+	return backend;
+}
+
 nanotimer_t start_timer() {
 #ifdef __APPLE__
-	return mach_absolute_time();
+	if (timebase.denom == 0) {
+		mach_timebase_info(&timebase);
+	}
+	return mach_absolute_time() * timebase.numer / timebase.denom;
 #else
-	struct timespec current_time;
-	clock_gettime(CLOCK_REALTIME, &current_time);
-	return current_time.tv_sec * 1e9 + current_time.tv_nsec;
+	switch (backend) {
+#ifdef HAVE_TSC
+		case TIMER_TSC:
+			//avoid the read being executed before preceding instructions
+			_mm_lfence();
+			return tsc_to_nanosecond(__rdtsc());
+#endif
+		case TIMER_REALTIME:
+			return read_clock(CLOCK_REALTIME);
+		default:
+			return read_clock(CLOCK_MONOTONIC_RAW);
+	}
 #endif
 }
 
 nanotimer_t elapsed_nanosecond(nanotimer_t timer) {
 #ifdef __APPLE__
-	return mach_absolute_time() - timer;
+	return start_timer() - timer;
 #else
-	struct timespec current_time;
-	clock_gettime(CLOCK_REALTIME, &current_time);
-	return current_time.tv_sec * 1e9 + current_time.tv_nsec - timer;
+	switch (backend) {
+#ifdef HAVE_TSC
+		case TIMER_TSC: {
+			//rdtscp waits for all the preceding instructions to be executed
+			unsigned int aux;
+			return tsc_to_nanosecond(__rdtscp(&aux)) - timer;
+		}
+#endif
+		case TIMER_REALTIME:
+			return read_clock(CLOCK_REALTIME) - timer;
+		default:
+			return read_clock(CLOCK_MONOTONIC_RAW) - timer;
+	}
 #endif
 }
+
+double measure_timer_overhead(int iterations) {
+
+	int i;
+	nanotimer_t total = 0;
+
+	for (i = 0; i < iterations; i++) {
+		total += elapsed_nanosecond(start_timer());
+	}
+
+	return (double)total / iterations;
+
+}
@@ -0,0 +1,984 @@
+/*
+ * Copyright (c) 2012 Michele Segata
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Michele Segata <michele.segata@uibk.ac.at>
+ * Description: soft decision Viterbi decoder for the 802.11 convolutional code
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "viterbi_utils.h"
+#include "bit_utils.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/**
+ * States are labelled with the last input bit in the least significant
+ * position, i.e., bit j of the label is the input bit of j + 1 steps before.
+ * With this labelling, new states 2i and 2i+1 both come from old states i
+ * and i+32, so the add-compare-select reads two contiguous halves of the
+ * metrics. Since both generator polynomials tap the newest and the oldest
+ * bit of the register, the four branch metrics of such a butterfly are
+ * b, -b, -b and b, where b is the metric of the transition from state i
+ * with input 0.
+ *
+ * b is computed as (y0 ^ s0[i]) - s0[i] + (y1 ^ s1[i]) - s1[i], where the
+ * masks are 0 if the expected coded bit is 1, and -1 (i.e., negate) if it is 0
+ */
+static short bm_sign0[VITERBI_STATES / 2];
+static short bm_sign1[VITERBI_STATES / 2];
+//for the batched decoder, b is one of -(y0+y1), y1-y0, y0-y1 and y0+y1,
+//selected by the two expected coded bits
+static int bm_select[VITERBI_STATES / 2];
+static int tables_ready = 0;
+
+/**
+ * Layout of the 8 bit metrics of the streaming decoder. The metrics of
+ * states 0..31 and 32..63 are held in two registers of 32 bytes, and new
+ * states 2i and 2i+1 come out of the add-compare-select in two registers
+ * as well. Interleaving them back within 128 bit lanes moves the bits of
+ * the state label around, so the order of the states within a register
+ * depends on the phase k of the step, out of VITERBI_PHASES: position p
+ * holds state bit k of the label in bit 4 of p, the bits below k in place
+ * and the bits above k shifted down by one. After VITERBI_PHASES steps, the
+ * states are back in label order with a single exchange of 128 bit lanes,
+ * so that the other steps do not need any cross lane permutation.
+ *
+ * Bits 0-31 of the decision word of a step are for even new states, bits
+ * 32-63 for odd ones, in the order of the registers at that step
+ */
+static unsigned char state_position[VITERBI_PHASES][VITERBI_STATES / 2];
+static unsigned char position_state[VITERBI_PHASES][VITERBI_STATES / 2];
+//for each phase and position, the index of the branch metric within a
+//branch word (see viterbi_decoder_push()), and its SSE2 equivalent: swap
+//a+c for a-c, then negate
+static signed char bm_shuffle[VITERBI_PHASES][VITERBI_STATES / 2] __attribute__((aligned(32)));
+static signed char bm_swap[VITERBI_PHASES][VITERBI_STATES / 2] __attribute__((aligned(16)));
+static signed char bm_negate[VITERBI_PHASES][VITERBI_STATES / 2] __attribute__((aligned(16)));
+
+/**
+ * Position, in the decision word of the previous step, of the decision of
+ * the predecessor of the state whose decision is at position p in the step
+ * of phase k, given the decision word d of that step. The state of position
+ * p has its last input bit in bit 5 of p, and its decision in bit p of d
+ */
+#define PREVIOUS_POSITION(p, d, k) ((k) == 0 ? \
+                                    (((p) & 0x10) << 1) | ((p) & 0x0F) | \
+                                    ((int)((d) >> (p)) & 1) << 4 : \
+                                    (((p) & 1) << 5) | ((p) & 0x10) | (((p) >> 1) & 7) | \
+                                    ((int)((d) >> (p)) & 1) << 3)
+
+/**
+ * Puncturing patterns: for each bit of the mother code within a period, the
+ * index of the soft bit within the received ones, or -1 if the bit has been
+ * removed, together with the number of trellis steps and of soft bits of a
+ * period
+ */
+struct PUNCTURING_MAP {
+	int steps;
+	int soft_bits;
+	signed char index[6];
+};
+static const struct PUNCTURING_MAP map_1_2 = {1, 2, {0, 1}};
+static const struct PUNCTURING_MAP map_2_3 = {2, 3, {0, 1, 2, -1}};
+static const struct PUNCTURING_MAP map_3_4 = {3, 4, {0, 1, 2, -1, -1, 3}};
+
+//backend in use, selected at the first initialization if not set explicitly
+static int backend = -1;
+
+/**
+ * Add-compare-select of n steps of the streaming decoder. Each branch word
+ * holds the four branch metrics -a-c, c-a, a-c and a+c of a step, one per
+ * byte, where a and c are the quantized soft values
+ */
+typedef void (*acs_function)(struct VITERBI_DECODER *v, const unsigned int *branches, int n);
+static acs_function acs = 0;
+
+/**
+ * Add-compare-select of one step of the batched decoder. Metrics are stored
+ * per state, with one frame per lane, so no shuffling is needed. Bit
+ * BATCH_DECISION_BIT(l, u) of decisions[i] is the decision of frame l for
+ * the new state 2i+u. Metrics are re-normalized if renorm is not 0
+ */
+typedef void (*acs_batch_function)(short (*metrics)[VITERBI_LANES], short (*next)[VITERBI_LANES], const short *y0,
+                                   const short *y1, unsigned int *decisions, int renorm);
+static acs_batch_function acs_batch = 0;
+
+/**
+ * Traceback of the batched decoder, for the given starting state of each
+ * frame. Writes the decoded bits of the first lanes frames into out
+ */
+typedef void (*traceback_batch_function)(const unsigned int *decisions, int n_steps, const int *state, int lanes,
+                                         char **out);
+static traceback_batch_function traceback_batch = 0;
+
+//order given by packing even and odd decisions within 128 bit lanes
+#define BATCH_DECISION_BIT(l, u) (((l) & 7) | ((u) << 3) | (((l) >> 3) << 4))
+
+static void init_tables() {
+
+	int i, j, k;
+	//generator polynomials, as in convolutional_encoding()
+	char g_0 = 0x5B;
+	char g_1 = 0x79;
+
+	for (i = 0; i < VITERBI_STATES / 2; i++) {
+		//register of the encoder for a transition from state i with input 0
+		char reg = 0;
+		for (j = 0; j < 6; j++) {
+			set_bit(&reg, 5 - j, get_bit(i, j));
+		}
+		bm_sign0[i] = get_polynomial(reg, g_0, 7) ? 0 : -1;
+		bm_sign1[i] = get_polynomial(reg, g_1, 7) ? 0 : -1;
+		bm_select[i] = (bm_sign0[i] ? 0 : 2) | (bm_sign1[i] ? 0 : 1);
+	}
+
+	for (k = 0; k < VITERBI_PHASES; k++) {
+		for (i = 0; i < VITERBI_STATES / 2; i++) {
+			j = (((i >> k) & 1) << 4) | (i & ((1 << k) - 1)) | ((i >> (k + 1)) << k);
+			state_position[k][i] = (unsigned char)j;
+			position_state[k][j] = (unsigned char)i;
+		}
+		for (j = 0; j < VITERBI_STATES / 2; j++) {
+			i = bm_select[position_state[k][j]];
+			bm_shuffle[k][j] = (signed char)i;
+			bm_swap[k][j] = (i == 1 || i == 2) ? -1 : 0;
+			bm_negate[k][j] = i < 2 ? -1 : 0;
+		}
+	}
+	tables_ready = 1;
+
+}
+
+//saturating 8 bit addition, as done by the SIMD backends
+static signed char adds_8(int a, int b) {
+
+	int s = a + b;
+	return (signed char)(s > 127 ? 127 : (s < -128 ? -128 : s));
+
+}
+
+static void acs_scalar(struct VITERBI_DECODER *v, const unsigned int *branches, int n) {
+
+	int k, i, p, phase = (int)(v->steps % VITERBI_PHASES);
+	signed char next[VITERBI_STATES];
+	signed char *metrics = v->metrics;
+
+	for (k = 0; k < n; k++) {
+
+		//layout of the next step
+		int following = phase == VITERBI_PHASES - 1 ? 0 : phase + 1;
+		unsigned long long d = 0;
+
+		for (p = 0; p < VITERBI_STATES / 2; p++) {
+
+			int s = position_state[phase][p];
+			int b = (signed char)(branches[k] >> (8 * bm_shuffle[phase][p]));
+			int m0 = adds_8(metrics[p], b), m1 = adds_8(metrics[p + 32], -b);
+			int m2 = adds_8(metrics[p], -b), m3 = adds_8(metrics[p + 32], b);
+
+			//new states 2s and 2s+1
+			next[((2 * s) & 32) | state_position[following][(2 * s) & 31]] = (signed char)(m1 > m0 ? m1 : m0);
+			next[((2 * s) & 32) | state_position[following][(2 * s + 1) & 31]] = (signed char)(m3 > m2 ? m3 : m2);
+			d |= (unsigned long long)(m1 > m0) << p;
+			d |= (unsigned long long)(m3 > m2) << (p + 32);
+
+		}
+
+		v->decisions[(v->steps + k) & (VITERBI_RING - 1)] = d;
+
+		if (following == 0) {
+			int best = -128;
+			for (i = 0; i < VITERBI_STATES; i++) {
+				best = next[i] > best ? next[i] : best;
+			}
+			best = adds_8(best, -VITERBI_METRIC_TARGET);
+			for (i = 0; i < VITERBI_STATES; i++) {
+				next[i] = adds_8(next[i], -best);
+			}
+		}
+		memcpy(metrics, next, sizeof(next));
+		phase = following;
+
+	}
+
+}
+
+static void acs_batch_scalar(short (*metrics)[VITERBI_LANES], short (*next)[VITERBI_LANES], const short *y0,
+                             const short *y1, unsigned int *decisions, int renorm) {
+
+	int i, l;
+
+	for (i = 0; i < VITERBI_STATES / 2; i++) {
+
+		unsigned int d = 0;
+
+		for (l = 0; l < VITERBI_LANES; l++) {
+
+			short b = ((y0[l] ^ bm_sign0[i]) - bm_sign0[i]) + ((y1[l] ^ bm_sign1[i]) - bm_sign1[i]);
+			short m0 = metrics[i][l] + b, m1 = metrics[i + 32][l] - b;
+			short m2 = metrics[i][l] - b, m3 = metrics[i + 32][l] + b;
+
+			next[2 * i][l] = m1 > m0 ? m1 : m0;
+			next[2 * i + 1][l] = m3 > m2 ? m3 : m2;
+			d |= (unsigned int)(m1 > m0) << BATCH_DECISION_BIT(l, 0);
+			d |= (unsigned int)(m3 > m2) << BATCH_DECISION_BIT(l, 1);
+
+		}
+
+		decisions[i] = d;
+
+	}
+
+	if (renorm) {
+		for (l = 0; l < VITERBI_LANES; l++) {
+			short base = next[0][l];
+			for (i = 0; i < VITERBI_STATES; i++) {
+				next[i][l] -= base;
+			}
+		}
+	}
+
+}
+
+static void traceback_batch_scalar(const unsigned int *decisions, int n_steps, const int *start, int lanes,
+                                   char **out) {
+
+	int state[VITERBI_LANES], byte[VITERBI_LANES];
+	int l, t;
+
+	for (l = 0; l < lanes; l++) {
+		state[l] = start[l];
+		byte[l] = 0;
+	}
+
+	//the frames are traced back together, so that the chains of the lanes
+	//overlap
+	for (t = n_steps - 1; t >= 0; t--) {
+		const unsigned int *d = &decisions[t * (VITERBI_STATES / 2)];
+		for (l = 0; l < lanes; l++) {
+			int st = state[l];
+			byte[l] |= (st & 1) << (7 - t % 8);
+			state[l] = (st >> 1) | (int)((d[st >> 1] >> BATCH_DECISION_BIT(l, st & 1)) & 1) << 5;
+		}
+		if (t % 8 == 0) {
+			for (l = 0; l < lanes; l++) {
+				out[l][t / 8] = (char)byte[l];
+				byte[l] = 0;
+			}
+		}
+	}
+
+}
+
+#ifdef HAVE_X86_SIMD
+
+__attribute__((target("sse2")))
+static void acs_sse2(struct VITERBI_DECODER *v, const unsigned int *branches, int n) {
+
+	int k, j, phase = (int)(v->steps % VITERBI_PHASES);
+	//metrics of states 0..31 and 32..63, one register per 128 bit lane of
+	//the layout, so that exchanging lanes is only a matter of naming
+	__m128i lo[2], hi[2];
+	__m128i target = _mm_set1_epi8(VITERBI_METRIC_TARGET), sign = _mm_set1_epi8(-128);
+
+	for (j = 0; j < 2; j++) {
+		lo[j] = _mm_loadu_si128((const __m128i *)&v->metrics[16 * j]);
+		hi[j] = _mm_loadu_si128((const __m128i *)&v->metrics[32 + 16 * j]);
+	}
+
+	for (k = 0; k < n; k++) {
+
+		//no byte shuffle in SSE2: a+c or a-c, then negated
+		__m128i plus = _mm_set1_epi8((char)(branches[k] >> 24)), minus = _mm_set1_epi8((char)(branches[k] >> 16));
+		__m128i even[2], odd[2];
+		unsigned long long d = 0;
+
+		for (j = 0; j < 2; j++) {
+
+			__m128i swap = _mm_load_si128((const __m128i *)&bm_swap[phase][16 * j]);
+			__m128i negate = _mm_load_si128((const __m128i *)&bm_negate[phase][16 * j]);
+			__m128i b = _mm_xor_si128(plus, _mm_and_si128(_mm_xor_si128(plus, minus), swap));
+			__m128i m0, m1, m2, m3, d_even, d_odd;
+
+			b = _mm_sub_epi8(_mm_xor_si128(b, negate), negate);
+			m0 = _mm_adds_epi8(lo[j], b);
+			m1 = _mm_subs_epi8(hi[j], b);
+			m2 = _mm_subs_epi8(lo[j], b);
+			m3 = _mm_adds_epi8(hi[j], b);
+			d_even = _mm_cmpgt_epi8(m1, m0);
+			d_odd = _mm_cmpgt_epi8(m3, m2);
+			//no signed 8 bit maximum in SSE2 either
+			even[j] = _mm_or_si128(_mm_and_si128(d_even, m1), _mm_andnot_si128(d_even, m0));
+			odd[j] = _mm_or_si128(_mm_and_si128(d_odd, m3), _mm_andnot_si128(d_odd, m2));
+			d |= (unsigned long long)(unsigned int)_mm_movemask_epi8(d_even) << (16 * j);
+			d |= (unsigned long long)(unsigned int)_mm_movemask_epi8(d_odd) << (32 + 16 * j);
+
+		}
+
+		v->decisions[(v->steps + k) & (VITERBI_RING - 1)] = d;
+
+		if (phase == VITERBI_PHASES - 1) {
+
+			//back to label order
+			__m128i m;
+			lo[0] = even[0];
+			lo[1] = odd[0];
+			hi[0] = even[1];
+			hi[1] = odd[1];
+
+			//signed maximum through the unsigned one
+			m = _mm_max_epu8(_mm_max_epu8(_mm_xor_si128(lo[0], sign), _mm_xor_si128(lo[1], sign)),
+			                 _mm_max_epu8(_mm_xor_si128(hi[0], sign), _mm_xor_si128(hi[1], sign)));
+			m = _mm_max_epu8(m, _mm_srli_si128(m, 8));
+			m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+			m = _mm_max_epu8(m, _mm_srli_si128(m, 2));
+			m = _mm_max_epu8(m, _mm_srli_si128(m, 1));
+			m = _mm_set1_epi8((char)(_mm_cvtsi128_si32(m) ^ 0x80));
+			m = _mm_subs_epi8(m, target);
+			for (j = 0; j < 2; j++) {
+				lo[j] = _mm_subs_epi8(lo[j], m);
+				hi[j] = _mm_subs_epi8(hi[j], m);
+			}
+			phase = 0;
+
+		}
+		else {
+			lo[0] = _mm_unpacklo_epi8(even[0], odd[0]);
+			lo[1] = _mm_unpacklo_epi8(even[1], odd[1]);
+			hi[0] = _mm_unpackhi_epi8(even[0], odd[0]);
+			hi[1] = _mm_unpackhi_epi8(even[1], odd[1]);
+			phase++;
+		}
+
+	}
+
+	for (j = 0; j < 2; j++) {
+		_mm_storeu_si128((__m128i *)&v->metrics[16 * j], lo[j]);
+		_mm_storeu_si128((__m128i *)&v->metrics[32 + 16 * j], hi[j]);
+	}
+
+}
+
+__attribute__((target("avx2")))
+static void acs_avx2(struct VITERBI_DECODER *v, const unsigned int *branches, int n) {
+
+	int k, phase = (int)(v->steps % VITERBI_PHASES);
+	//metrics of states 0..31 and 32..63
+	__m256i lo = _mm256_loadu_si256((const __m256i *)&v->metrics[0]);
+	__m256i hi = _mm256_loadu_si256((const __m256i *)&v->metrics[32]);
+	__m256i target = _mm256_set1_epi8(VITERBI_METRIC_TARGET);
+	__m256i shuffle[VITERBI_PHASES];
+
+	for (k = 0; k < VITERBI_PHASES; k++) {
+		shuffle[k] = _mm256_load_si256((const __m256i *)bm_shuffle[k]);
+	}
+
+	for (k = 0; k < n; k++) {
+
+		__m256i b = _mm256_shuffle_epi8(_mm256_set1_epi32((int)branches[k]), shuffle[phase]);
+		__m256i m0 = _mm256_adds_epi8(lo, b), m1 = _mm256_subs_epi8(hi, b);
+		__m256i m2 = _mm256_subs_epi8(lo, b), m3 = _mm256_adds_epi8(hi, b);
+		__m256i even = _mm256_max_epi8(m0, m1), odd = _mm256_max_epi8(m2, m3);
+
+		v->decisions[(v->steps + k) & (VITERBI_RING - 1)] =
+			(unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_cmpgt_epi8(m1, m0)) |
+			(unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_cmpgt_epi8(m3, m2)) << 32;
+
+		if (phase == VITERBI_PHASES - 1) {
+
+			//the maximum is taken while the lanes are exchanged, and it ends
+			//up in every byte, so the shuffle with zero indices broadcasts it
+			__m256i m = _mm256_max_epi8(even, odd);
+			m = _mm256_max_epi8(m, _mm256_permute2x128_si256(m, m, 1));
+			m = _mm256_max_epi8(m, _mm256_srli_si256(m, 8));
+			m = _mm256_max_epi8(m, _mm256_srli_si256(m, 4));
+			m = _mm256_max_epi8(m, _mm256_srli_si256(m, 2));
+			m = _mm256_max_epi8(m, _mm256_srli_si256(m, 1));
+			m = _mm256_subs_epi8(_mm256_shuffle_epi8(m, _mm256_setzero_si256()), target);
+
+			//back to label order, with the only exchange of lanes
+			lo = _mm256_subs_epi8(_mm256_permute2x128_si256(even, odd, 0x20), m);
+			hi = _mm256_subs_epi8(_mm256_permute2x128_si256(even, odd, 0x31), m);
+			phase = 0;
+
+		}
+		else {
+			//within 128 bit lanes
+			lo = _mm256_unpacklo_epi8(even, odd);
+			hi = _mm256_unpackhi_epi8(even, odd);
+			phase++;
+		}
+
+	}
+
+	_mm256_storeu_si256((__m256i *)&v->metrics[0], lo);
+	_mm256_storeu_si256((__m256i *)&v->metrics[32], hi);
+
+}
+
+__attribute__((target("sse2")))
+static void acs_batch_sse2(short (*metrics)[VITERBI_LANES], short (*next)[VITERBI_LANES], const short *y0,
+                           const short *y1, unsigned int *decisions, int renorm) {
+
+	int i, h;
+	//branch metrics of the two halves of the lanes, indexed by bm_select
+	__m128i b[2][4];
+
+	for (h = 0; h < 2; h++) {
+		__m128i a = _mm_loadu_si128((const __m128i *)&y0[8 * h]);
+		__m128i c = _mm_loadu_si128((const __m128i *)&y1[8 * h]);
+		b[h][3] = _mm_add_epi16(a, c);
+		b[h][2] = _mm_sub_epi16(a, c);
+		b[h][1] = _mm_sub_epi16(c, a);
+		b[h][0] = _mm_sub_epi16(_mm_setzero_si128(), b[h][3]);
+	}
+
+	for (i = 0; i < VITERBI_STATES / 2; i++) {
+
+		unsigned int d = 0;
+
+		for (h = 0; h < 2; h++) {
+
+			__m128i lo = _mm_loadu_si128((const __m128i *)&metrics[i][8 * h]);
+			__m128i hi = _mm_loadu_si128((const __m128i *)&metrics[i + 32][8 * h]);
+			__m128i bm = b[h][bm_select[i]];
+			__m128i m0 = _mm_adds_epi16(lo, bm), m1 = _mm_subs_epi16(hi, bm);
+			__m128i m2 = _mm_subs_epi16(lo, bm), m3 = _mm_adds_epi16(hi, bm);
+
+			_mm_storeu_si128((__m128i *)&next[2 * i][8 * h], _mm_max_epi16(m0, m1));
+			_mm_storeu_si128((__m128i *)&next[2 * i + 1][8 * h], _mm_max_epi16(m2, m3));
+			d |= (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpgt_epi16(m1, m0), _mm_cmpgt_epi16(m3, m2))) << (16 * h);
+
+		}
+
+		decisions[i] = d;
+
+	}
+
+	if (renorm) {
+		for (h = 0; h < 2; h++) {
+			__m128i base = _mm_loadu_si128((const __m128i *)&next[0][8 * h]);
+			for (i = 0; i < VITERBI_STATES; i++) {
+				__m128i m = _mm_loadu_si128((const __m128i *)&next[i][8 * h]);
+				_mm_storeu_si128((__m128i *)&next[i][8 * h], _mm_sub_epi16(m, base));
+			}
+		}
+	}
+
+}
+
+__attribute__((target("avx2")))
+static void acs_batch_avx2(short (*metrics)[VITERBI_LANES], short (*next)[VITERBI_LANES], const short *y0,
+                           const short *y1, unsigned int *decisions, int renorm) {
+
+	int i;
+	__m256i a = _mm256_loadu_si256((const __m256i *)y0);
+	__m256i c = _mm256_loadu_si256((const __m256i *)y1);
+	//branch metrics, indexed by bm_select
+	__m256i b[4];
+
+	b[3] = _mm256_add_epi16(a, c);
+	b[2] = _mm256_sub_epi16(a, c);
+	b[1] = _mm256_sub_epi16(c, a);
+	b[0] = _mm256_sub_epi16(_mm256_setzero_si256(), b[3]);
+
+	for (i = 0; i < VITERBI_STATES / 2; i++) {
+
+		__m256i lo = _mm256_loadu_si256((const __m256i *)metrics[i]);
+		__m256i hi = _mm256_loadu_si256((const __m256i *)metrics[i + 32]);
+		__m256i bm = b[bm_select[i]];
+		__m256i m0 = _mm256_adds_epi16(lo, bm), m1 = _mm256_subs_epi16(hi, bm);
+		__m256i m2 = _mm256_subs_epi16(lo, bm), m3 = _mm256_adds_epi16(hi, bm);
+
+		_mm256_storeu_si256((__m256i *)next[2 * i], _mm256_max_epi16(m0, m1));
+		_mm256_storeu_si256((__m256i *)next[2 * i + 1], _mm256_max_epi16(m2, m3));
+		decisions[i] = (unsigned int)_mm256_movemask_epi8(_mm256_packs_epi16(_mm256_cmpgt_epi16(m1, m0),
+		                                                                     _mm256_cmpgt_epi16(m3, m2)));
+
+	}
+
+	if (renorm) {
+		__m256i base = _mm256_loadu_si256((const __m256i *)next[0]);
+		for (i = 0; i < VITERBI_STATES; i++) {
+			__m256i m = _mm256_loadu_si256((const __m256i *)next[i]);
+			_mm256_storeu_si256((__m256i *)next[i], _mm256_sub_epi16(m, base));
+		}
+	}
+
+}
+
+__attribute__((target("avx2")))
+static void traceback_batch_avx2(const unsigned int *decisions, int n_steps, const int *start, int lanes,
+                                 char **out) {
+
+	int h, l, t;
+	//starting states, and then output bytes, of all the lanes
+	int lane[VITERBI_LANES];
+	//states of lanes 0-7 and 8-15, and the bits decoded so far
+	__m256i state[2], byte[2];
+	//position of the decisions of the even states of each lane
+	const __m256i base[2] = {_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+	                         _mm256_setr_epi32(16, 17, 18, 19, 20, 21, 22, 23)};
+	const __m256i one = _mm256_set1_epi32(1);
+
+	for (l = 0; l < VITERBI_LANES; l++) {
+		lane[l] = l < lanes ? start[l] : 0;
+	}
+	for (h = 0; h < 2; h++) {
+		state[h] = _mm256_loadu_si256((const __m256i *)&lane[8 * h]);
+		byte[h] = _mm256_setzero_si256();
+	}
+
+	for (t = n_steps - 1; t >= 0; t--) {
+
+		const int *d = (const int *)&decisions[t * (VITERBI_STATES / 2)];
+		__m128i shift = _mm_cvtsi32_si128(7 - t % 8);
+
+		for (h = 0; h < 2; h++) {
+			__m256i bit = _mm256_and_si256(state[h], one);
+			__m256i w = _mm256_i32gather_epi32(d, _mm256_srli_epi32(state[h], 1), 4);
+			__m256i dec = _mm256_srlv_epi32(w, _mm256_add_epi32(base[h], _mm256_slli_epi32(bit, 3)));
+			byte[h] = _mm256_or_si256(byte[h], _mm256_sll_epi32(bit, shift));
+			state[h] = _mm256_or_si256(_mm256_srli_epi32(state[h], 1), _mm256_slli_epi32(_mm256_and_si256(dec, one), 5));
+		}
+
+		if (t % 8 == 0) {
+			for (h = 0; h < 2; h++) {
+				_mm256_storeu_si256((__m256i *)&lane[8 * h], byte[h]);
+				byte[h] = _mm256_setzero_si256();
+			}
+			for (l = 0; l < lanes; l++) {
+				out[l][t / 8] = (char)lane[l];
+			}
+		}
+
+	}
+
+}
+
+#endif
+
+int set_viterbi_backend(enum VITERBI_BACKEND b) {
+
+	switch (b) {
+
+		case VITERBI_SCALAR:
+			acs = acs_scalar;
+			acs_batch = acs_batch_scalar;
+			traceback_batch = traceback_batch_scalar;
+			break;
+
+#ifdef HAVE_X86_SIMD
+		case VITERBI_SSE2:
+			if (!__builtin_cpu_supports("sse2")) {
+				return ERR_VITERBI_NOT_SUPPORTED;
+			}
+			acs = acs_sse2;
+			acs_batch = acs_batch_sse2;
+			traceback_batch = traceback_batch_scalar;
+			break;
+
+		case VITERBI_AVX2:
+			if (!__builtin_cpu_supports("avx2")) {
+				return ERR_VITERBI_NOT_SUPPORTED;
+			}
+			acs = acs_avx2;
+			acs_batch = acs_batch_avx2;
+			traceback_batch = traceback_batch_avx2;
+			break;
+#endif
+
+		default:
+			return ERR_VITERBI_NOT_SUPPORTED;
+
+	}
+
+	backend = b;
+	return 0;
+
+}
+
+enum VITERBI_BACKEND get_viterbi_backend() {
+
+	if (backend == -1) {
+		//pick the fastest one
+		if (set_viterbi_backend(VITERBI_AVX2) != 0 && set_viterbi_backend(VITERBI_SSE2) != 0) {
+			set_viterbi_backend(VITERBI_SCALAR);
+		}
+	}
+	return (enum VITERBI_BACKEND)backend;
+
+}
+
+void init_viterbi_decoder(struct VITERBI_DECODER *v, enum CODING_RATE rate) {
+
+	int i;
+
+	if (!tables_ready) {
+		init_tables();
+	}
+	get_viterbi_backend();
+
+	memset(v, 0, sizeof(struct VITERBI_DECODER));
+	v->rate = rate;
+	//the encoder starts in state 0, which is at position 0 in every phase:
+	//make every other state unlikely
+	for (i = 1; i < VITERBI_STATES; i++) {
+		v->metrics[i] = -128;
+	}
+
+}
+
+/**
+ * Returns the state with the highest path metric
+ */
+static int best_state(struct VITERBI_DECODER *v) {
+
+	int i, best = 0;
+	for (i = 1; i < VITERBI_STATES; i++) {
+		if (v->metrics[i] > v->metrics[best]) {
+			best = i;
+		}
+	}
+	return position_state[v->steps % VITERBI_PHASES][best & 31] | (best & 32);
+
+}
+
+/**
+ * Returns the puncturing map of a coding rate
+ */
+static const struct PUNCTURING_MAP *get_puncturing_map(enum CODING_RATE rate) {
+
+	switch (rate) {
+		case RATE_2_3:
+			return &map_2_3;
+		case RATE_3_4:
+			return &map_3_4;
+		default:
+			return &map_1_2;
+	}
+
+}
+
+/**
+ * Returns the index of the soft bit carrying the j-th bit of the mother code,
+ * or -1 if the bit has been removed by puncturing
+ */
+static int get_soft_index(const struct PUNCTURING_MAP *map, int j) {
+
+	int k = map->index[j % (2 * map->steps)];
+	return k < 0 ? -1 : j / (2 * map->steps) * map->soft_bits + k;
+
+}
+
+/**
+ * Traces back from the given state at the last step down to the first step
+ * not yet output, writing the bits of the oldest n_out steps. The first step
+ * not yet output is always at a byte boundary
+ */
+static void traceback(struct VITERBI_DECODER *v, int state, int n_out, char *out) {
+
+	long long t = (long long)v->steps - 1;
+	long long first = (long long)v->decoded;
+	int k = (int)(t % VITERBI_PHASES);
+	int p = ((state & 1) << 5) | state_position[k][state >> 1];
+	//decoded bits, one per byte, so that writing them is off the chain
+	unsigned char bits[VITERBI_RING + 8];
+	unsigned long long d, x;
+	int i, j;
+
+	//the most recent steps only lead to the right path
+	for (; t >= first + n_out; t--) {
+		d = v->decisions[t & (VITERBI_RING - 1)];
+		p = PREVIOUS_POSITION(p, d, k);
+		k = k == 0 ? VITERBI_PHASES - 1 : k - 1;
+	}
+
+	for (; t >= first; t--) {
+		bits[t - first] = (unsigned char)(p >> 5);
+		d = v->decisions[t & (VITERBI_RING - 1)];
+		p = PREVIOUS_POSITION(p, d, k);
+		k = k == 0 ? VITERBI_PHASES - 1 : k - 1;
+	}
+
+	//8 bits at a time, the first one in the most significant position: the
+	//product moves byte j of x to bit 7 - j of its top byte, without carries
+	memset(&bits[n_out], 0, 8);
+	for (j = 0; j < n_out; j += 8) {
+		x = 0;
+		for (i = 0; i < 8; i++) {
+			x |= (unsigned long long)bits[j + i] << (8 * i);
+		}
+		out[(first + j) / 8] = (char)((x * 0x8040201008040201ULL) >> 56);
+	}
+
+}
+
+int viterbi_decoder_push(struct VITERBI_DECODER *v, const signed char *soft, int size, char *out) {
+
+	//soft values of the next trellis steps, with erasures re-inserted
+	short y0[VITERBI_BLOCK], y1[VITERBI_BLOCK];
+	unsigned int branches[VITERBI_BLOCK];
+	const struct PUNCTURING_MAP *map = get_puncturing_map(v->rate);
+	int i = 0, n, j, k, p;
+
+	do {
+
+		n = 0;
+
+		//whole periods of the puncturing pattern, one bit of the period at a
+		//time, so that the copies are strided loops
+		if (v->phase == 0) {
+			int periods = (size - i) / map->soft_bits;
+			if (periods > VITERBI_BLOCK / map->steps) {
+				periods = VITERBI_BLOCK / map->steps;
+			}
+			for (j = 0; j < 2 * map->steps; j++) {
+				short *y = j % 2 ? y1 : y0;
+				k = map->index[j];
+				for (p = 0; p < periods; p++) {
+					y[p * map->steps + j / 2] = k < 0 ? 0 : soft[i + p * map->soft_bits + k];
+				}
+			}
+			n = periods * map->steps;
+			i += periods * map->soft_bits;
+		}
+
+		//one soft bit at a time, at the end of the input or of the batch
+		for (; n < VITERBI_BLOCK; n++) {
+
+			if (!v->has_y0) {
+				if (map->index[v->phase] >= 0) {
+					if (i == size) {
+						break;
+					}
+					v->y0 = soft[i++];
+				}
+				else {
+					v->y0 = 0;
+				}
+				if (++v->phase == 2 * map->steps) {
+					v->phase = 0;
+				}
+				v->has_y0 = 1;
+			}
+
+			if (map->index[v->phase] >= 0) {
+				if (i == size) {
+					break;
+				}
+				y1[n] = soft[i++];
+			}
+			else {
+				y1[n] = 0;
+			}
+			if (++v->phase == 2 * map->steps) {
+				v->phase = 0;
+			}
+			y0[n] = v->y0;
+			v->has_y0 = 0;
+
+		}
+
+		//quantized soft values, so that the branch metrics fit the 8 bit
+		//path metrics
+		for (j = 0; j < n; j++) {
+			int a = (y0[j] + (1 << (VITERBI_SOFT_SHIFT - 1))) >> VITERBI_SOFT_SHIFT;
+			int c = (y1[j] + (1 << (VITERBI_SOFT_SHIFT - 1))) >> VITERBI_SOFT_SHIFT;
+			a = a > VITERBI_SOFT_MAX ? VITERBI_SOFT_MAX : (a < -VITERBI_SOFT_MAX ? -VITERBI_SOFT_MAX : a);
+			c = c > VITERBI_SOFT_MAX ? VITERBI_SOFT_MAX : (c < -VITERBI_SOFT_MAX ? -VITERBI_SOFT_MAX : c);
+			branches[j] = (unsigned int)(unsigned char)(-a - c) | (unsigned int)(unsigned char)(c - a) << 8 |
+			              (unsigned int)(unsigned char)(a - c) << 16 | (unsigned int)(unsigned char)(a + c) << 24;
+		}
+
+		if (n > 0) {
+			acs(v, branches, n);
+			v->steps += n;
+		}
+
+		while (v->steps - v->decoded >= VITERBI_TRACEBACK + VITERBI_BLOCK) {
+			traceback(v, best_state(v), VITERBI_BLOCK, out);
+			v->decoded += VITERBI_BLOCK;
+		}
+
+	}
+	while (n == VITERBI_BLOCK);
+
+	return (int)v->decoded;
+
+}
+
+int viterbi_decoder_finish(struct VITERBI_DECODER *v, int terminated, char *out) {
+
+	traceback(v, terminated ? 0 : best_state(v), (int)(v->steps - v->decoded), out);
+	v->decoded = v->steps;
+
+	return (int)v->decoded;
+
+}
+
+int viterbi_decoder_peek(struct VITERBI_DECODER *v, char *out) {
+
+	long long reliable = (long long)v->steps - VITERBI_TRACEBACK - (long long)v->decoded;
+
+	if (reliable <= 0) {
+		return (int)v->decoded;
+	}
+	traceback(v, best_state(v), (int)reliable, out);
+
+	return (int)(v->decoded + reliable);
+
+}
+
+int viterbi_decode(const signed char *soft, int size, enum CODING_RATE rate, int terminated, char *out) {
+
+	struct VITERBI_DECODER v;
+
+	init_viterbi_decoder(&v, rate);
+	viterbi_decoder_push(&v, soft, size, out);
+	return viterbi_decoder_finish(&v, terminated, out);
+
+}
+
+int viterbi_decode_batch(const signed char **soft, int n_frames, int size, enum CODING_RATE rate, int terminated,
+                         char **out) {
+
+	const struct PUNCTURING_MAP *map = get_puncturing_map(rate);
+	short metrics[2][VITERBI_STATES][VITERBI_LANES];
+	short y0[VITERBI_LANES], y1[VITERBI_LANES];
+	unsigned int *decisions;
+	//starting state of the traceback of each frame
+	int state[VITERBI_LANES];
+	int n_steps = 0;
+	int f, l, i, k, i0, i1;
+
+	if (!tables_ready) {
+		init_tables();
+	}
+	get_viterbi_backend();
+
+	//a step is done if none of its soft bits is beyond the end of the input
+	while (get_soft_index(map, 2 * n_steps) < size && get_soft_index(map, 2 * n_steps + 1) < size) {
+		n_steps++;
+	}
+	//frames are short, so decisions are kept for the whole frame
+	decisions = (unsigned int *)malloc(sizeof(unsigned int) * (VITERBI_STATES / 2) * n_steps);
+
+	for (f = 0; f < n_frames; f += VITERBI_LANES) {
+
+		int lanes = n_frames - f < VITERBI_LANES ? n_frames - f : VITERBI_LANES;
+
+		//the encoder starts in state 0, as in init_viterbi_decoder()
+		for (i = 0; i < VITERBI_STATES; i++) {
+			for (l = 0; l < VITERBI_LANES; l++) {
+				metrics[0][i][l] = i == 0 ? 0 : -4096;
+			}
+		}
+		//unused lanes decode erasures
+		memset(y0, 0, sizeof(y0));
+		memset(y1, 0, sizeof(y1));
+
+		for (k = 0; k < n_steps; k++) {
+			i0 = get_soft_index(map, 2 * k);
+			i1 = get_soft_index(map, 2 * k + 1);
+			for (l = 0; l < lanes; l++) {
+				y0[l] = i0 < 0 ? 0 : soft[f + l][i0];
+				y1[l] = i1 < 0 ? 0 : soft[f + l][i1];
+			}
+			acs_batch(metrics[k & 1], metrics[(k + 1) & 1], y0, y1, &decisions[k * (VITERBI_STATES / 2)],
+			          ((k + 1) & (VITERBI_RENORM_INTERVAL - 1)) == 0);
+		}
+
+		//start from the zero state, or from the best state of each frame
+		for (l = 0; l < lanes; l++) {
+			short (*last)[VITERBI_LANES] = metrics[n_steps & 1];
+			state[l] = 0;
+			if (!terminated) {
+				for (i = 1; i < VITERBI_STATES; i++) {
+					if (last[i][l] > last[state[l]][l]) {
+						state[l] = i;
+					}
+				}
+			}
+		}
+
+		traceback_batch(decisions, n_steps, state, lanes, &out[f]);
+
+	}
+
+	free(decisions);
+	return n_steps;
+
+}
+
+int viterbi_decode_signal(const signed char *soft, char *out) {
+
+	short metrics[VITERBI_STATES], next[VITERBI_STATES];
+	unsigned long long decisions[VITERBI_SIGNAL_BITS];
+	int i, k, st;
+
+	if (!tables_ready) {
+		init_tables();
+	}
+
+	//the encoder starts in state 0. The metrics cannot overflow in so few
+	//steps, so they are never re-normalized
+	metrics[0] = 0;
+	for (i = 1; i < VITERBI_STATES; i++) {
+		metrics[i] = -4096;
+	}
+
+	for (k = 0; k < VITERBI_SIGNAL_BITS; k++) {
+
+		short y0 = soft[2 * k], y1 = soft[2 * k + 1];
+		unsigned long long d = 0;
+
+		for (i = 0; i < VITERBI_STATES / 2; i++) {
+
+			short b = ((y0 ^ bm_sign0[i]) - bm_sign0[i]) + ((y1 ^ bm_sign1[i]) - bm_sign1[i]);
+			short m0 = metrics[i] + b, m1 = metrics[i + 32] - b;
+			short m2 = metrics[i] - b, m3 = metrics[i + 32] + b;
+
+			next[2 * i] = m1 > m0 ? m1 : m0;
+			next[2 * i + 1] = m3 > m2 ? m3 : m2;
+			d |= (unsigned long long)(m1 > m0) << (2 * i);
+			d |= (unsigned long long)(m3 > m2) << (2 * i + 1);
+
+		}
+
+		decisions[k] = d;
+		memcpy(metrics, next, sizeof(next));
+
+	}
+
+	//bit s of a decision word is the decision of state s, whose last input
+	//bit is bit 0. The tail bits bring the encoder to state 0
+	memset(out, 0, VITERBI_SIGNAL_BITS / 8);
+	st = 0;
+	for (k = VITERBI_SIGNAL_BITS - 1; k >= 0; k--) {
+		out[k / 8] |= (char)((st & 1) << (7 - k % 8));
+		st = (st >> 1) | (int)((decisions[k] >> st) & 1) << 5;
+	}
+
+	return VITERBI_SIGNAL_BITS;
+
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fftw3.h>
+
+#include "receiver_utils.h"
+#include "mac_utils.h"
+#include "bit_utils.h"
+
+//address 1 of the example frame, and an address not used by any frame
+#define EXAMPLE_ADDRESS "00:60:08:cd:37:a6"
+#define OTHER_ADDRESS "00:11:22:33:44:55"
+//size of the MSDU of the long frame
+#define MSDU_SIZE 1500
+//size of a frame made of frame control, duration, address 1 and FCS only (e.g., an ACK)
+#define SHORT_PSDU_SIZE 14
+
+/**
+ * Decodes a frame with the given filter, and prints the result and the
+ * number of DATA symbols that have been decoded
+ */
+void decode(struct OFDM_FRAME_DECODER *dec, const struct RX_ADDRESS_FILTER *filter, const char *description,
+            fftw_complex *samples, int n) {
+	struct RX_STATS stats;
+	char psdu[RX_MAX_PSDU_SIZE];
+	int length, err;
+	dec->filter = filter;
+	err = ofdm_decode_frame(dec, samples, n, psdu, &length, &stats);
+	printf("%s: result %d, %d of %d symbols decoded\n", description, err, stats.n_decoded_symbols,
+	       stats.tx_params.n_sym);
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), and decodes it without filter and with filters
+ * on address 1 and on the frame type, printing whether the frame has been
+ * dropped and after how many DATA symbols. It then does the same for a long
+ * frame at 6 Mbps generated by the framer, and for a short frame that ends
+ * before the header can be checked while decoding
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	struct OFDM_FRAME_ENCODER enc;
+	struct OFDM_FRAME_DECODER dec;
+	struct RX_ADDRESS_FILTER none, example, other, both, management, data;
+	fftw_complex *samples;
+	char msdu[MSDU_SIZE], short_psdu[SHORT_PSDU_SIZE];
+	char *psdu;
+	dbyte frame_control, duration;
+	unsigned int fcs;
+	int n, psdu_size;
+
+	samples = fftw_alloc_complex(1000);
+	n = read_complex_from_file(argv[1], samples, 1000);
+
+	if (n == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	init_address_filter(&none, 0);
+	init_address_filter(&example, 0);
+	add_watched_address(&example, EXAMPLE_ADDRESS);
+	init_address_filter(&other, 0);
+	add_watched_address(&other, OTHER_ADDRESS);
+	init_address_filter(&both, 1 << TYPE_DATA);
+	add_watched_address(&both, OTHER_ADDRESS);
+	add_watched_address(&both, EXAMPLE_ADDRESS);
+	init_address_filter(&management, 1 << TYPE_MANAGEMENT);
+	init_address_filter(&data, 1 << TYPE_DATA);
+	init_ofdm_frame_decoder(&dec);
+	init_ofdm_frame_encoder(&enc);
+
+	//the filter can hold RX_MAX_WATCHED_ADDRESSES addresses
+	while (add_watched_address(&none, OTHER_ADDRESS) == 0);
+	printf("watched addresses: %d\n", none.n_addresses);
+	init_address_filter(&none, 0);
+
+	//example frame, a data frame
+	decode(&dec, NULL, "example, no filter", samples, n);
+	decode(&dec, &none, "example, empty filter", samples, n);
+	decode(&dec, &example, "example, its address", samples, n);
+	decode(&dec, &other, "example, other address", samples, n);
+	decode(&dec, &both, "example, data frames to both addresses", samples, n);
+	decode(&dec, &management, "example, management frames", samples, n);
+	decode(&dec, &data, "example, data frames", samples, n);
+	fftw_free(samples);
+
+	//long frame to the other address
+	memset(msdu, 0x55, MSDU_SIZE);
+	construct_dbyte(0xFF, 0xFF, &frame_control);
+	construct_dbyte(0xFF, 0xFF, &duration);
+	generate_mac_data_frame(msdu, MSDU_SIZE, generate_mac_header(frame_control, duration, OTHER_ADDRESS, 0, 0, 0),
+	                        &psdu, &psdu_size);
+	generate_ofdm_frame(&enc, psdu, psdu_size, BW_20_DR_6_MBPS, &samples, &n);
+	decode(&dec, NULL, "long frame, no filter", samples, n);
+	decode(&dec, &example, "long frame, example address", samples, n);
+	decode(&dec, &other, "long frame, its address", samples, n);
+	fftw_free(samples);
+	free(psdu);
+
+	//short management frame to the example address
+	construct_dbyte(0, 0, &frame_control);
+	set_frame_control_type(&frame_control, TYPE_MANAGEMENT, 0);
+	memset(short_psdu, 0, SHORT_PSDU_SIZE);
+	memcpy(short_psdu, frame_control, sizeof(dbyte));
+	str_to_mac_address(EXAMPLE_ADDRESS, (mac_address_t *)&short_psdu[4]);
+	fcs = crc32(short_psdu, SHORT_PSDU_SIZE - 4);
+	memcpy(&short_psdu[SHORT_PSDU_SIZE - 4], &fcs, 4);
+	generate_ofdm_frame(&enc, short_psdu, SHORT_PSDU_SIZE, BW_20_DR_54_MBPS, &samples, &n);
+	decode(&dec, &example, "short frame, its address", samples, n);
+	decode(&dec, &other, "short frame, other address", samples, n);
+	decode(&dec, &management, "short frame, management frames", samples, n);
+	decode(&dec, &data, "short frame, data frames", samples, n);
+	fftw_free(samples);
+
+	free_ofdm_frame_encoder(&enc);
+	free_ofdm_frame_decoder(&dec);
+
+	return 0;
+
+}
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <fftw3.h>
+
+#include "capture_utils.h"
+#include "receiver_utils.h"
+#include "mac_utils.h"
+#include "bit_utils.h"
+#include "test_utils.h"
+
+//size of the chunks used by the test, and number of chunks of the capture
+#define CHUNK_SIZE 65536
+#define N_CHUNKS 8
+#define CAPTURE_SIZE (N_CHUNKS * CHUNK_SIZE)
+//position of the frames with respect to the boundaries between chunks: across the boundary, with the
+//event generated in the lookahead, right at the boundary, and within the overlap of the next chunk
+#define N_SEAM_POSITIONS 4
+static const int seam_positions[N_SEAM_POSITIONS] = {-100, -30, 0, -1100};
+#define THRESHOLD 0.8
+#define N_FRAMES_MAX (3 * N_CHUNKS)
+
+/**
+ * Runs a single detector over the whole capture: the fixed point one over
+ * sc16 samples, or the single precision one over the samples converted by
+ * the reader
+ */
+int detect_all(const struct CAPTURE *c, struct DETECTION_EVENT *events, int max_events) {
+	struct SHORT_TRAINING_DETECTOR_F detector;
+	struct SHORT_TRAINING_DETECTOR_S16 detector_s16;
+	fftw_complex block[CAPTURE_BLOCK_SIZE];
+	sample_cf32_t samples[CAPTURE_BLOCK_SIZE];
+	long long pos;
+	int n_events = 0, size, i;
+	if (c->format == CAPTURE_SC16) {
+		init_short_training_detector_s16(&detector_s16);
+		return detect_short_training_events_s16(&detector_s16, (const sample_sc16_t *)c->data, (int)c->n_samples,
+		                                        THRESHOLD, events, max_events);
+	}
+	init_short_training_detector_f(&detector);
+	for (pos = 0; pos < c->n_samples; pos += size) {
+		size = read_capture_samples(c, pos, CAPTURE_BLOCK_SIZE, block);
+		for (i = 0; i < size; i++) {
+			samples[i][0] = block[i][0];
+			samples[i][1] = block[i][1];
+		}
+		n_events += detect_short_training_events_f(&detector, samples, size, THRESHOLD, &events[n_events],
+		                                           max_events - n_events);
+	}
+	return n_events;
+}
+
+/**
+ * Checks a capture file: the samples read back, and the events of parallel
+ * scans with different numbers of threads and chunk sizes, which must be the
+ * ones of a single detector
+ */
+void check_capture(const char *filename, enum CAPTURE_FORMAT format, const fftw_complex *capture,
+                   const long long *starts, int n_frames) {
+
+	struct CAPTURE c;
+	struct DETECTION_EVENT reference[4 * N_FRAMES_MAX], *events;
+	fftw_complex samples[1000];
+	double error = 0, scale = format == CAPTURE_SC16 ? SC16_AMPLITUDE * 32768 / 32767 : 1;
+	long long n;
+	int n_reference, found, i, j, err;
+	static const int threads[3] = {1, 4, 8};
+	static const int chunk_sizes[3] = {CHUNK_SIZE, 100000, CAPTURE_CHUNK_SIZE};
+
+	err = open_capture(&c, filename, format);
+	if (err != 0) {
+		printf("%s: cannot open the capture (%d)\n", STR_CAPTURE_FORMAT[format], err);
+		return;
+	}
+	printf("%s: %lld samples\n", STR_CAPTURE_FORMAT[format], c.n_samples);
+
+	n = read_capture_samples(&c, CHUNK_SIZE - 500, 1000, samples);
+	for (i = 0; i < n; i++) {
+		error = fmax(error, fabs(samples[i][0] * scale - capture[CHUNK_SIZE - 500 + i][0]));
+		error = fmax(error, fabs(samples[i][1] * scale - capture[CHUNK_SIZE - 500 + i][1]));
+	}
+	printf("%s: read %lld samples, error below 1e-4: %s\n", STR_CAPTURE_FORMAT[format], n,
+	       error < 1e-4 ? "yes" : "no");
+	printf("%s: read at the end: %d samples\n", STR_CAPTURE_FORMAT[format],
+	       read_capture_samples(&c, c.n_samples - 10, 1000, samples));
+
+	//frames found by a single detector
+	n_reference = detect_all(&c, reference, 4 * N_FRAMES_MAX);
+	found = 0;
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_reference; j++) {
+			if (reference[j].sample >= starts[i] - SC_WINDOW && reference[j].sample <= starts[i] + SC_WINDOW) {
+				found++;
+				break;
+			}
+		}
+	}
+	printf("%s: single detector: %d events, %d of %d frames\n", STR_CAPTURE_FORMAT[format], n_reference, found,
+	       n_frames);
+
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			n = scan_capture(&c, threads[i], chunk_sizes[j], THRESHOLD, &events);
+			printf("%s: %d threads, chunks of %d samples: %lld events, %s\n", STR_CAPTURE_FORMAT[format],
+			       threads[i], chunk_sizes[j], n, n == n_reference &&
+			       memcmp(events, reference, sizeof(struct DETECTION_EVENT) * n) == 0 ?
+			       "same as a single detector" : "different from a single detector");
+			free(events);
+		}
+	}
+	printf("%s: chunks of 0 samples: %lld\n", STR_CAPTURE_FORMAT[format],
+	       scan_capture(&c, 4, 0, THRESHOLD, &events));
+
+	close_capture(&c);
+
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), and builds a capture with copies of it and frames
+ * generated by the framer, several of them placed around the boundaries
+ * between chunks. The capture is written as cf32 and sc16 files, which are
+ * read back through the memory mapped reader and scanned with several
+ * numbers of threads and chunk sizes, checking that the detections are
+ * the ones of a single detector run over the whole capture. Finally, it
+ * checks the errors for a missing file and for a file of the wrong size
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	struct OFDM_FRAME_ENCODER enc;
+	struct CAPTURE c;
+	fftw_complex *frame, *example, *capture;
+	long long starts[N_FRAMES_MAX];
+	struct DETECTION_EVENT *events;
+	char msdu[100], *psdu, *filename, *sc16_filename;
+	FILE *f;
+	long long pos, n_events;
+	int i, k, n, n_example, n_frames, psdu_size;
+	//state of a linear congruential generator, for reproducible noise and data
+	unsigned int lcg = 777;
+
+	example = fftw_alloc_complex(1000);
+	n_example = read_complex_from_file(argv[1], example, 1000);
+
+	if (n_example == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n_example == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	capture = fftw_alloc_complex(CAPTURE_SIZE);
+	generate_noise(capture, CAPTURE_SIZE, 0.01, &lcg);
+	init_ofdm_frame_encoder(&enc);
+	for (k = 0; k < 100; k++) {
+		msdu[k] = (char)k;
+	}
+	generate_mac_data_frame(msdu, 100, generate_default_mac_header(), &psdu, &psdu_size);
+	generate_ofdm_frame(&enc, psdu, psdu_size, BW_20_DR_54_MBPS, &frame, &n);
+
+	//two frames within each chunk, and one around each boundary between chunks
+	n_frames = 0;
+	for (i = 0; i < N_CHUNKS; i++) {
+		starts[n_frames++] = (long long)i * CHUNK_SIZE + 8000 + next_random(&lcg) % 20000;
+		starts[n_frames++] = (long long)i * CHUNK_SIZE + 35000 + next_random(&lcg) % 20000;
+		if (i > 0) {
+			starts[n_frames++] = (long long)i * CHUNK_SIZE + seam_positions[i % N_SEAM_POSITIONS];
+		}
+	}
+	for (i = 0; i < n_frames; i++) {
+		add_frame(capture, starts[i], i % 2 ? example : frame, i % 2 ? n_example : n, 1);
+	}
+	//positions sorted, for the output
+	for (i = 0; i < n_frames; i++) {
+		for (k = i + 1; k < n_frames; k++) {
+			if (starts[k] < starts[i]) {
+				pos = starts[i];
+				starts[i] = starts[k];
+				starts[k] = pos;
+			}
+		}
+	}
+
+	//the first fixed point detectors are initialized by the threads of a
+	//scan, which must select the same backend
+	sc16_filename = write_capture(capture, CAPTURE_SIZE, CAPTURE_SC16);
+	if (open_capture(&c, sc16_filename, CAPTURE_SC16) == 0) {
+		n_events = scan_capture(&c, 8, CHUNK_SIZE, THRESHOLD, &events);
+		printf("sc16: 8 threads before any other detector: %lld events\n", n_events);
+		free(events);
+		close_capture(&c);
+	}
+
+	filename = write_capture(capture, CAPTURE_SIZE, CAPTURE_CF32);
+	check_capture(filename, CAPTURE_CF32, capture, starts, n_frames);
+	unlink(filename);
+	free(filename);
+	filename = sc16_filename;
+	check_capture(filename, CAPTURE_SC16, capture, starts, n_frames);
+
+	//an sc16 capture is not a valid cf32 capture if its size is not a multiple of 8 bytes
+	f = fopen(filename, "ab");
+	fwrite(capture, sizeof(sample_sc16_t), 1, f);
+	fclose(f);
+	printf("wrong size: %d\n", open_capture(&c, filename, CAPTURE_CF32));
+	unlink(filename);
+	printf("missing file: %d\n", open_capture(&c, filename, CAPTURE_CF32));
+	free(filename);
+
+	free_ofdm_frame_encoder(&enc);
+	fftw_free(frame);
+	free(psdu);
+	fftw_free(example);
+	fftw_free(capture);
+
+	return 0;
+
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <fftw3.h>
+
+#include "cfo_utils.h"
+#include "channel_utils.h"
+#include "soft_utils.h"
+#include "bit_utils.h"
+
+//carrier frequency offset applied to the frame (rad/sample), i.e., about 255 kHz at 20 MHz
+#define CFO 0.08
+//maximum error on the estimates (rad/sample)
+#define MAX_COARSE_ERROR 1e-3
+#define MAX_FINE_ERROR 1e-4
+//maximum difference between the NCO and a direct computation of the rotation
+#define MAX_NCO_ERROR 1e-9
+//size of the chunks given to the NCO
+#define CHUNK_SIZE 37
+//samples of the short training sequence used by the coarse estimate, skipping the first symbol
+#define STS_START 16
+#define STS_SIZE (SHORT_TRAINING_SIZE - STS_START)
+//first sample of the long training symbols, and of the first DATA symbol
+#define LTS_START (SHORT_TRAINING_SIZE + 2 * CYCLIC_PREFIX_SIZE)
+#define DATA_START (5 * OFDM_SYMBOL_SIZE + CYCLIC_PREFIX_SIZE)
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), applies a carrier frequency offset, and estimates
+ * it with the coarse and fine estimators and with a short training detector.
+ * It then removes the offset with the NCO, feeding it in chunks and changing
+ * its frequency in the middle of a block, and reports estimates too far from
+ * the actual offset and samples differing from a direct computation of the
+ * rotation. Finally, it prints the hard decisions of the first DATA symbol
+ * after correction, which are its interleaved bits
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	fftw_complex *frame, *samples, *corrected;
+	struct SHORT_TRAINING_DETECTOR detector;
+	struct NCO nco;
+	struct OFDM_DEMODULATOR d;
+	struct CHANNEL_ESTIMATE ch;
+	fftw_complex symbol[N_TOTAL_SUBCARRIERS], data[N_DATA_SUBCARRIERS];
+	signed char soft[N_DATA_SUBCARRIERS * 4];
+	char bits[N_DATA_SUBCARRIERS * 4 / 8];
+	double coarse, fine, detector_cfo, phase, re, im;
+	int i, n, size;
+
+	frame = fftw_alloc_complex(1000);
+	n = read_complex_from_file(argv[1], frame, 1000);
+
+	if (n == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	samples = fftw_alloc_complex(n);
+	corrected = fftw_alloc_complex(n);
+	for (i = 0; i < n; i++) {
+		samples[i][0] = frame[i][0] * cos(CFO * i) - frame[i][1] * sin(CFO * i);
+		samples[i][1] = frame[i][0] * sin(CFO * i) + frame[i][1] * cos(CFO * i);
+	}
+
+	//coarse estimate, from the samples and from the detector within the short training sequence
+	coarse = estimate_coarse_cfo(&samples[STS_START], STS_SIZE);
+	if (fabs(coarse - CFO) > MAX_COARSE_ERROR) {
+		printf("wrong coarse estimate: %f instead of %f\n", coarse, CFO);
+	}
+	init_short_training_detector(&detector);
+	update_short_training_detector(&detector, samples, SHORT_TRAINING_SIZE - CYCLIC_PREFIX_SIZE, 2, NULL);
+	detector_cfo = get_short_training_cfo(&detector);
+	if (fabs(detector_cfo - CFO) > MAX_COARSE_ERROR) {
+		printf("wrong detector estimate: %f instead of %f\n", detector_cfo, CFO);
+	}
+
+	//fine estimate, after removing the coarse one
+	init_nco(&nco, coarse);
+	derotate(&nco, samples, corrected, n);
+	fine = estimate_fine_cfo(&corrected[LTS_START]);
+	if (fabs(coarse + fine - CFO) > MAX_FINE_ERROR) {
+		printf("wrong fine estimate: %f instead of %f\n", coarse + fine, CFO);
+	}
+
+	//remove the whole offset, in chunks, switching from the coarse estimate
+	//to the final one in the middle of a block
+	init_nco(&nco, coarse);
+	size = LTS_START + NCO_BLOCK / 2;
+	for (i = 0; i < size; i += CHUNK_SIZE) {
+		derotate(&nco, &samples[i], &corrected[i], size - i < CHUNK_SIZE ? size - i : CHUNK_SIZE);
+	}
+	set_nco_frequency(&nco, coarse + fine);
+	for (i = size; i < n; i += CHUNK_SIZE) {
+		derotate(&nco, &samples[i], &corrected[i], n - i < CHUNK_SIZE ? n - i : CHUNK_SIZE);
+	}
+	for (i = 0; i < n; i++) {
+		phase = i < size ? coarse * i : coarse * size + (coarse + fine) * (i - size);
+		re = samples[i][0] * cos(phase) + samples[i][1] * sin(phase);
+		im = samples[i][1] * cos(phase) - samples[i][0] * sin(phase);
+		if (hypot(corrected[i][0] - re, corrected[i][1] - im) > MAX_NCO_ERROR) {
+			printf("wrong NCO output at sample %d\n", i);
+			break;
+		}
+	}
+
+	//decode the first DATA symbol
+	init_ofdm_demodulator(&d);
+	estimate_channel(&d, &corrected[LTS_START], 0, &ch);
+	demodulate_symbol(&d, &corrected[DATA_START], symbol);
+	equalize_symbol(&ch, symbol, symbol);
+	extract_data_subcarriers(symbol, data, NULL);
+	demap_soft(data, ch.data_gain, N_DATA_SUBCARRIERS, QAM16, DEMAP_DEFAULT_SCALE, soft);
+	memset(bits, 0, sizeof(bits));
+	for (i = 0; i < N_DATA_SUBCARRIERS * 4; i++) {
+		set_bit(&bits[i / 8], 7 - i % 8, soft[i] > 0);
+	}
+	print_bits_array(bits, sizeof(bits), '\n');
+
+	free_ofdm_demodulator(&d);
+	fftw_free(frame);
+	fftw_free(samples);
+	fftw_free(corrected);
+
+	return 0;
+
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <fftw3.h>
+
+#include "channel_utils.h"
+#include "soft_utils.h"
+#include "bit_utils.h"
+
+//taps of the multipath channel applied to the frame, all within the cyclic prefix
+#define N_TAPS 3
+static const double taps[N_TAPS][2] = {{0.9, 0.2}, {0.2, -0.15}, {0.0, 0.1}};
+//amplitude of the uniform noise added to each component of the samples
+#define NOISE_AMPLITUDE 0.005
+//maximum error on the channel response and on the SNR (dB)
+#define MAX_CHANNEL_ERROR 0.1
+#define MAX_SNR_ERROR 3.0
+//first sample of the long training symbols, and of the first DATA symbol
+#define LTS_START (SHORT_TRAINING_SIZE + 2 * CYCLIC_PREFIX_SIZE)
+#define DATA_START (5 * OFDM_SYMBOL_SIZE + CYCLIC_PREFIX_SIZE)
+
+/**
+ * Returns the frequency response of the channel on the subcarrier i, from -26 to 26
+ */
+void channel_response(int i, double *re, double *im) {
+	int t;
+	*re = 0;
+	*im = 0;
+	for (t = 0; t < N_TAPS; t++) {
+		double a = -2 * M_PI * i * t / FFT_SIZE;
+		*re += taps[t][0] * cos(a) - taps[t][1] * sin(a);
+		*im += taps[t][0] * sin(a) + taps[t][1] * cos(a);
+	}
+}
+
+/**
+ * Equalizes the first DATA symbol with the given estimate and returns the
+ * hard decisions of its 16-QAM subcarriers
+ */
+void decode_first_symbol(struct OFDM_DEMODULATOR *d, struct CHANNEL_ESTIMATE *ch, fftw_complex *samples, char *bits) {
+	fftw_complex symbol[N_TOTAL_SUBCARRIERS], data[N_DATA_SUBCARRIERS];
+	signed char soft[N_DATA_SUBCARRIERS * 4];
+	int i;
+
+	demodulate_symbol(d, &samples[DATA_START], symbol);
+	equalize_symbol(ch, symbol, symbol);
+	extract_data_subcarriers(symbol, data, NULL);
+	demap_soft(data, ch->data_gain, N_DATA_SUBCARRIERS, QAM16, DEMAP_DEFAULT_SCALE, soft);
+
+	memset(bits, 0, N_DATA_SUBCARRIERS * 4 / 8);
+	for (i = 0; i < N_DATA_SUBCARRIERS * 4; i++) {
+		set_bit(&bits[i / 8], 7 - i % 8, soft[i] > 0);
+	}
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), passes them through a multipath channel with
+ * noise, and estimates the channel from the long training symbols. It
+ * reports estimates too far from the actual channel response or SNR, and
+ * prints the hard decisions of the first DATA symbol after equalization,
+ * which are its interleaved bits. The same is done with a smoothed estimate
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	fftw_complex *frame, *samples;
+	struct OFDM_DEMODULATOR d;
+	struct CHANNEL_ESTIMATE ch, smoothed;
+	char bits[N_DATA_SUBCARRIERS * 4 / 8], smoothed_bits[N_DATA_SUBCARRIERS * 4 / 8];
+	double re, im, noise_power, signal_power = 0, snr;
+	int i, t, n;
+	//state of a linear congruential generator, for reproducible noise
+	unsigned int lcg = 12345;
+
+	frame = fftw_alloc_complex(1000);
+	n = read_complex_from_file(argv[1], frame, 1000);
+
+	if (n == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	//multipath channel and noise
+	samples = fftw_alloc_complex(n);
+	for (i = 0; i < n; i++) {
+		samples[i][0] = 0;
+		samples[i][1] = 0;
+		for (t = 0; t < N_TAPS && t <= i; t++) {
+			samples[i][0] += taps[t][0] * frame[i - t][0] - taps[t][1] * frame[i - t][1];
+			samples[i][1] += taps[t][0] * frame[i - t][1] + taps[t][1] * frame[i - t][0];
+		}
+		lcg = lcg * 1103515245 + 12345;
+		samples[i][0] += ((int)(lcg >> 16) % 201 - 100) / 100.0 * NOISE_AMPLITUDE;
+		lcg = lcg * 1103515245 + 12345;
+		samples[i][1] += ((int)(lcg >> 16) % 201 - 100) / 100.0 * NOISE_AMPLITUDE;
+	}
+
+	init_ofdm_demodulator(&d);
+	estimate_channel(&d, &samples[LTS_START], 0, &ch);
+	estimate_channel(&d, &samples[LTS_START], 1, &smoothed);
+
+	//compare the estimate with the actual channel response
+	for (i = -26; i <= 26; i++) {
+		if (i == 0) {
+			continue;
+		}
+		channel_response(i, &re, &im);
+		signal_power += re * re + im * im;
+		if (hypot(ch.h[i + 26][0] - re, ch.h[i + 26][1] - im) > MAX_CHANNEL_ERROR) {
+			printf("wrong channel estimate on subcarrier %d\n", i);
+		}
+		if (hypot(smoothed.h[i + 26][0] - re, smoothed.h[i + 26][1] - im) > 2 * MAX_CHANNEL_ERROR) {
+			printf("wrong smoothed channel estimate on subcarrier %d\n", i);
+		}
+	}
+	signal_power /= N_USED_SUBCARRIERS;
+	//the noise of each component is uniform over 201 levels, and the FFT sums the
+	//power of FFT_SIZE samples
+	noise_power = FFT_SIZE * 2 * NOISE_AMPLITUDE * NOISE_AMPLITUDE * (101 * 100 / 3.0) / (100 * 100);
+	snr = 10 * log10(signal_power / noise_power);
+	if (fabs(ch.snr - snr) > MAX_SNR_ERROR) {
+		printf("wrong snr estimate: %.1f dB instead of %.1f dB\n", ch.snr, snr);
+	}
+
+	//decode the first DATA symbol with both estimates
+	decode_first_symbol(&d, &ch, samples, bits);
+	decode_first_symbol(&d, &smoothed, samples, smoothed_bits);
+	if (memcmp(bits, smoothed_bits, sizeof(bits)) != 0) {
+		printf("smoothed estimate gives different decisions\n");
+	}
+
+	print_bits_array(bits, sizeof(bits), '\n');
+
+	free_ofdm_demodulator(&d);
+	fftw_free(frame);
+	fftw_free(samples);
+
+	return 0;
+
+}
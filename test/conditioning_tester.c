@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <fftw3.h>
+
+#include "conditioning_utils.h"
+#include "bit_utils.h"
+#include "test_utils.h"
+
+//copies of the frame, at the given signal to noise ratio, separated by noise
+#define N_FRAMES 20
+#define SNR 15
+#define GAP_SIZE 80000
+#define NOISE_AMPLITUDE 0.01
+//impairments of the front end: DC offset, gain and phase imbalance of the Q branch, and gain, which
+//changes after half of the frames
+#define DC_RE 0.03
+#define DC_IM -0.02
+#define IQ_GAIN 1.25
+#define IQ_PHASE 0.15
+#define GAIN_STEP 8
+#define THRESHOLD 0.8
+//a busy channel, with long frames made of copies of the example (about 0.8 ms at 20 Msamples/s) taking
+//half of the time
+#define LONG_FRAME_SIZE 16384
+#define BUSY_PERIODS 32
+#define MAX_EVENTS (4 * N_FRAMES)
+
+/**
+ * Conditions the stream, in chunks of random sizes (or of the given size, if
+ * seed is 0)
+ */
+void condition(struct SIGNAL_CONDITIONER *c, const sample_cf32_t *in, sample_cf32_t *out, int size,
+               unsigned int seed, int chunk_size) {
+	int pos, n;
+	for (pos = 0; pos < size; pos += n) {
+		n = seed ? 1 + (int)(next_random(&seed) % 2000) : chunk_size;
+		n = pos + n < size ? n : size - pos;
+		condition_samples(c, &in[pos], &out[pos], n);
+	}
+}
+
+/**
+ * Runs the short training detector over the stream, and counts the frames
+ * detected and the other events after the first block, which the conditioner
+ * lets through unchanged
+ */
+void detect(const char *description, const sample_cf32_t *stream, int size, const long long *starts) {
+	struct SHORT_TRAINING_DETECTOR_F d;
+	struct DETECTION_EVENT events[MAX_EVENTS];
+	int n_events, found = 0, other = 0, i, j;
+	init_short_training_detector_f(&d);
+	n_events = detect_short_training_events_f(&d, stream, size, THRESHOLD, events, MAX_EVENTS);
+	for (j = 0; j < n_events; j++) {
+		for (i = 0; i < N_FRAMES; i++) {
+			if (events[j].sample >= starts[i] - SC_WINDOW && events[j].sample <= starts[i] + SC_WINDOW) {
+				found++;
+				break;
+			}
+		}
+		if (i == N_FRAMES && events[j].sample >= COND_BLOCK) {
+			other++;
+		}
+	}
+	printf("%s: %d of %d frames detected, %d other events\n", description, found, N_FRAMES, other);
+}
+
+/**
+ * Returns the mean power of the samples, in dB
+ */
+double power_db(const sample_cf32_t *samples, int size) {
+	double p = 0;
+	int k;
+	for (k = 0; k < size; k++) {
+		p += samples[k][0] * samples[k][0] + samples[k][1] * samples[k][1];
+	}
+	return 10 * log10(p / size);
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), and builds a stream with copies of it separated
+ * by noise, impaired by a DC offset, IQ imbalance and a gain that changes
+ * halfway. The short training detector is run over the impaired stream and
+ * over the stream conditioned in chunks of random sizes, printing how many
+ * frames are detected. It then checks the estimated corrections, the image
+ * rejection and the power of the output, that the output does not depend on
+ * the size of the chunks, that the samples go through unchanged when all
+ * the stages are disabled, and that the gain does not follow the single
+ * long frames of a busy channel
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	struct SIGNAL_CONDITIONER c;
+	fftw_complex *example;
+	sample_cf32_t *clean, *stream, *out, *rechunked;
+	long long starts[N_FRAMES];
+	double frame_power = 0, scale, gain, re, im, dc_error, gain_min = 0, gain_max = 0;
+	int i, k, n_example, size, pos, half;
+	//state of a linear congruential generator, for reproducible noise
+	unsigned int lcg = 1357;
+
+	example = fftw_alloc_complex(1000);
+	n_example = read_complex_from_file(argv[1], example, 1000);
+
+	if (n_example == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n_example == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	for (k = 0; k < n_example; k++) {
+		frame_power += example[k][0] * example[k][0] + example[k][1] * example[k][1];
+	}
+	frame_power /= n_example;
+
+	size = N_FRAMES * (n_example + GAP_SIZE) + GAP_SIZE;
+	clean = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * size);
+	stream = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * size);
+	out = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * size);
+	rechunked = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * size);
+	pos = GAP_SIZE;
+	for (i = 0; i < N_FRAMES; i++) {
+		starts[i] = pos;
+		pos += n_example + GAP_SIZE;
+	}
+	half = starts[N_FRAMES / 2] - GAP_SIZE / 2;
+	for (i = 0; i < size; i++) {
+		clean[i][0] = uniform_noise(&lcg, NOISE_AMPLITUDE);
+		clean[i][1] = uniform_noise(&lcg, NOISE_AMPLITUDE);
+	}
+	//uniform noise in [-a, a] on both components has power 2 a^2 / 3
+	scale = sqrt(pow(10, SNR / 10.0) * 2 * NOISE_AMPLITUDE * NOISE_AMPLITUDE / 3 / frame_power);
+	for (i = 0; i < N_FRAMES; i++) {
+		for (k = 0; k < n_example; k++) {
+			clean[starts[i] + k][0] += example[k][0] * scale;
+			clean[starts[i] + k][1] += example[k][1] * scale;
+		}
+	}
+	for (i = 0; i < size; i++) {
+		gain = i < half ? 1 : GAIN_STEP;
+		re = clean[i][0];
+		im = IQ_GAIN * (clean[i][1] * cos(IQ_PHASE) + clean[i][0] * sin(IQ_PHASE));
+		stream[i][0] = gain * re + DC_RE;
+		stream[i][1] = gain * im + DC_IM;
+	}
+
+	detect("impaired stream", stream, size, starts);
+	init_signal_conditioner(&c);
+	condition(&c, stream, out, size, 1, 0);
+	detect("conditioned stream", out, size, starts);
+	detect("clean stream", clean, size, starts);
+
+	dc_error = fmax(fabs(c.dc_re - DC_RE), fabs(c.dc_im - DC_IM));
+	printf("DC offset error below 5%%: %s\n", dc_error < 0.05 * hypot(DC_RE, DC_IM) ? "yes" : "no");
+	printf("image rejection before: %.0f dB\n", measure_image_rejection(stream, half));
+	printf("image rejection after, above 30 dB: before the gain step %s, after it %s\n",
+	       measure_image_rejection(&out[GAP_SIZE], half - GAP_SIZE) > 30 ? "yes" : "no",
+	       measure_image_rejection(&out[half + GAP_SIZE], size - half - GAP_SIZE) > 30 ? "yes" : "no");
+	printf("output power within 1 dB of the target: before the gain step %s, after it %s\n",
+	       fabs(power_db(&out[GAP_SIZE], half - GAP_SIZE) - 10 * log10(c.agc_target)) < 1 ? "yes" : "no",
+	       fabs(power_db(&out[half + GAP_SIZE], size - half - GAP_SIZE) - 10 * log10(c.agc_target)) < 1 ?
+	       "yes" : "no");
+
+	//the corrections change only at the boundaries of the blocks
+	init_signal_conditioner(&c);
+	condition(&c, stream, rechunked, size, 0, 1);
+	printf("output with chunks of 1 sample: %s\n",
+	       memcmp(rechunked, out, sizeof(sample_cf32_t) * size) == 0 ? "same" : "different");
+	init_signal_conditioner(&c);
+	memcpy(rechunked, stream, sizeof(sample_cf32_t) * size);
+	condition(&c, rechunked, rechunked, size, 0, size);
+	printf("output in place, in a single chunk: %s\n",
+	       memcmp(rechunked, out, sizeof(sample_cf32_t) * size) == 0 ? "same" : "different");
+
+	init_signal_conditioner(&c);
+	c.dc = c.iq = c.agc = 0;
+	condition(&c, stream, rechunked, size, 2, 0);
+	printf("all stages disabled: %s\n",
+	       memcmp(rechunked, stream, sizeof(sample_cf32_t) * size) == 0 ? "unchanged" : "changed");
+
+	//once the level has settled on the busy channel, the gain does not follow the single frames
+	for (i = 0; i < 2 * LONG_FRAME_SIZE; i++) {
+		rechunked[i][0] = uniform_noise(&lcg, NOISE_AMPLITUDE);
+		rechunked[i][1] = uniform_noise(&lcg, NOISE_AMPLITUDE);
+		if (i < LONG_FRAME_SIZE) {
+			rechunked[i][0] += example[i % n_example][0] * scale;
+			rechunked[i][1] += example[i % n_example][1] * scale;
+		}
+	}
+	init_signal_conditioner(&c);
+	for (i = 0; i < BUSY_PERIODS; i++) {
+		gain_min = gain_max = c.gain;
+		for (pos = 0; pos < 2 * LONG_FRAME_SIZE; pos += COND_BLOCK) {
+			condition_samples(&c, &rechunked[pos], &out[pos], COND_BLOCK);
+			if (pos < LONG_FRAME_SIZE) {
+				gain_min = fmin(gain_min, c.gain);
+				gain_max = fmax(gain_max, c.gain);
+			}
+		}
+	}
+	printf("gain within 1 dB across a long frame of a busy channel: %s\n",
+	       20 * log10(gain_max / gain_min) < 1 ? "yes" : "no");
+
+	free(clean);
+	free(stream);
+	free(out);
+	free(rechunked);
+	fftw_free(example);
+
+	return 0;
+
+}
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fftw3.h>
+
+#include "pool_utils.h"
+#include "mac_utils.h"
+#include "bit_utils.h"
+#include "test_utils.h"
+
+//number of frames generated by the framer
+#define N_FRAMES 48
+//the capture ends with noise, and has a long noise gap before frames GAP_FRAME_1 and GAP_FRAME_2,
+//placed so that the preamble of the first one is across the end of a scan window, and the second one
+//(at 6 Mbps, so at least 1280 samples long) is truncated by it
+#define GAP_FRAME_1 20
+#define GAP_FRAME_2 32
+#define CAPTURE_SIZE (3 * POOL_SCAN_WINDOW)
+#define MAX_MSDU_SIZE 1500
+
+/**
+ * A frame of the capture, as transmitted
+ */
+struct SENT_FRAME {
+	long long start;
+	char *psdu;
+	int psdu_size;
+};
+
+/**
+ * Frames received by the callback, and comparison with the transmitted ones
+ */
+struct RESULTS {
+	struct SENT_FRAME *sent;
+	int n_sent;
+	int n_frames;
+	int n_correct;
+	int in_order;
+	long long last_start;
+	long long starts[2 * N_FRAMES];
+	//whether to print each frame
+	int verbose;
+};
+
+/**
+ * Callback of decode_capture(): checks that the frame is the next transmitted
+ * one and that it has been decoded correctly
+ */
+void check_frame(const struct DECODED_FRAME *frame, void *arg) {
+	struct RESULTS *r = (struct RESULTS *)arg;
+	long long start = frame->offset + frame->stats.start;
+	int i;
+	if (start <= r->last_start) {
+		r->in_order = 0;
+	}
+	r->last_start = start;
+	if (r->n_frames < 2 * N_FRAMES) {
+		r->starts[r->n_frames] = start;
+	}
+	r->n_frames++;
+	for (i = 0; i < r->n_sent; i++) {
+		if (start >= r->sent[i].start - 2 && start <= r->sent[i].start + 2) {
+			if (frame->err == 0 && frame->length == r->sent[i].psdu_size &&
+			        memcmp(frame->psdu, r->sent[i].psdu, frame->length) == 0) {
+				r->n_correct++;
+			}
+			break;
+		}
+	}
+	if (r->verbose) {
+		printf("frame at %lld: result %d, %s, %d bytes\n", start, frame->err,
+		       STR_DATA_RATE[frame->stats.tx_params.data_rate], frame->length);
+	}
+}
+
+/**
+ * Decodes the capture with the given number of threads, and prints how many
+ * frames have been found and decoded. Without threads, the frames are printed
+ * and stored into reference, otherwise they are compared with it
+ */
+void decode(const struct CAPTURE *capture, struct SENT_FRAME *sent, int n_sent, int n_threads,
+            struct RESULTS *reference) {
+	struct DECODER_POOL pool;
+	struct RESULTS r;
+	int n;
+	memset(&r, 0, sizeof(r));
+	r.sent = sent;
+	r.n_sent = n_sent;
+	r.in_order = 1;
+	r.last_start = -1;
+	r.verbose = n_threads == 0;
+	if (init_decoder_pool(&pool, n_threads) != 0) {
+		printf("cannot start %d threads\n", n_threads);
+		return;
+	}
+	n = decode_capture(&pool, capture, check_frame, &r);
+	printf("%d threads: %d frames (%d delivered), %d correct, %s\n", n_threads, n, r.n_frames, r.n_correct,
+	       r.in_order ? "in capture order" : "out of order");
+	if (n_threads != 0) {
+		printf("%d threads: %s inline decoding\n", n_threads,
+		       r.n_frames == reference->n_frames && memcmp(r.starts, reference->starts, sizeof(r.starts)) == 0 ?
+		       "same frames as" : "different frames than");
+	}
+	else {
+		*reference = r;
+	}
+	free_decoder_pool(&pool);
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), and builds a capture of three scan windows with
+ * copies of it and frames generated by the framer at every data rate, with
+ * random sizes and noise gaps. Two long gaps place a preamble across the end
+ * of a scan window, and a frame truncated by it. The capture is written to a
+ * cf32 file, which is then decoded by decoder pools with 0, 1 and 4 worker
+ * threads, printing the frames found and checking that they are the
+ * transmitted ones, delivered in capture order, and the same whatever the
+ * number of threads
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	struct OFDM_FRAME_ENCODER enc;
+	struct OFDM_FRAME_DECODER dec;
+	struct SENT_FRAME sent[N_FRAMES];
+	struct RESULTS reference;
+	struct CAPTURE c;
+	fftw_complex *frame, *example, *capture;
+	char msdu[MAX_MSDU_SIZE], *psdu, *example_psdu, *filename;
+	long long pos, end;
+	int i, k, n, n_example, msdu_size, psdu_size, example_psdu_size;
+	//state of a linear congruential generator, for reproducible noise and data
+	unsigned int lcg = 4321;
+
+	example = fftw_alloc_complex(1000);
+	n_example = read_complex_from_file(argv[1], example, 1000);
+
+	if (n_example == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n_example == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	//the PSDU of the example frame, as decoded alone
+	init_ofdm_frame_decoder(&dec);
+	example_psdu = (char *)malloc(sizeof(char) * RX_MAX_PSDU_SIZE);
+	if (ofdm_decode_frame(&dec, example, n_example, example_psdu, &example_psdu_size, NULL) != 0) {
+		printf("cannot decode the example frame\n");
+		return 1;
+	}
+	free_ofdm_frame_decoder(&dec);
+
+	capture = fftw_alloc_complex(CAPTURE_SIZE);
+	generate_noise(capture, CAPTURE_SIZE, 0.01, &lcg);
+	init_ofdm_frame_encoder(&enc);
+
+	pos = 1000;
+	end = 0;
+	for (i = 0; i < N_FRAMES; i++) {
+		//the scan window following a frame starts at its end
+		if (i == GAP_FRAME_1) {
+			//the preamble is across the end of the window
+			pos = end + POOL_SCAN_WINDOW - 200;
+		}
+		else if (i == GAP_FRAME_2) {
+			//the SIGNAL field is within the window, the end of the frame is not
+			pos = end + POOL_SCAN_WINDOW - 1000;
+		}
+		if (i % 8 == 7) {
+			//example frame
+			sent[i].psdu = example_psdu;
+			sent[i].psdu_size = example_psdu_size;
+			n = n_example;
+			frame = example;
+		}
+		else {
+			msdu_size = next_random(&lcg) % MAX_MSDU_SIZE;
+			for (k = 0; k < msdu_size; k++) {
+				msdu[k] = (char)next_random(&lcg);
+			}
+			generate_mac_data_frame(msdu, msdu_size, generate_default_mac_header(), &psdu, &psdu_size);
+			sent[i].psdu = psdu;
+			sent[i].psdu_size = psdu_size;
+			generate_ofdm_frame(&enc, psdu, psdu_size, (enum DATA_RATE)(i % (N_DATA_RATES / 2)), &frame, &n);
+		}
+		if (pos + n > CAPTURE_SIZE) {
+			printf("capture too short\n");
+			return 1;
+		}
+		sent[i].start = pos;
+		add_frame(capture, pos, frame, n, 1);
+		if (frame != example) {
+			fftw_free(frame);
+		}
+		end = pos + n;
+		pos = end + 100 + next_random(&lcg) % 2000;
+	}
+
+	filename = write_capture(capture, CAPTURE_SIZE, CAPTURE_CF32);
+	open_capture(&c, filename, CAPTURE_CF32);
+	decode(&c, sent, N_FRAMES, 0, &reference);
+	decode(&c, sent, N_FRAMES, 1, &reference);
+	decode(&c, sent, N_FRAMES, 4, &reference);
+	close_capture(&c);
+	unlink(filename);
+	free(filename);
+
+	for (i = 0; i < N_FRAMES; i++) {
+		if (sent[i].psdu != example_psdu) {
+			free(sent[i].psdu);
+		}
+	}
+	free(example_psdu);
+	free_ofdm_frame_encoder(&enc);
+	fftw_free(example);
+	fftw_free(capture);
+
+	return 0;
+
+}
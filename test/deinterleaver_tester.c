@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fftw3.h>
+
+#include "soft_utils.h"
+#include "bit_utils.h"
+
+//soft value given to the bits read from file
+#define SOFT_VALUE 64
+//number of OFDM symbols used for the loopback tests
+#define N_SYMBOLS 3
+
+/**
+ * Converts packed bits into soft bits
+ */
+void bits_to_soft(const char *bits, int n_bits, signed char *soft) {
+	int i;
+	for (i = 0; i < n_bits; i++) {
+		soft[i] = get_bit(bits[i / 8], 7 - i % 8) ? SOFT_VALUE : -SOFT_VALUE;
+	}
+}
+
+/**
+ * Counts the soft bits whose sign differs from the corresponding packed bit
+ */
+int count_errors(const signed char *soft, const char *bits, int n_bits) {
+	int i, errors = 0;
+	for (i = 0; i < n_bits; i++) {
+		if ((soft[i] > 0) != (get_bit(bits[i / 8], 7 - i % 8) != 0)) {
+			errors++;
+		}
+	}
+	return errors;
+}
+
+/**
+ * This test application takes in input the interleaved bits of the first
+ * OFDM symbol of the 802.11-2012 example frame (annex L), turns them into
+ * soft bits, and deinterleaves them, printing the sign of the result, which
+ * must match the encoded bits. Then, it interleaves and punctures random bits
+ * for each modulation and coding rate, and checks that the soft
+ * deinterleaver and depuncturer recover them
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	char interleaved[1000];
+	signed char soft[8000], deinterleaved[8000], depunctured[8000];
+	char hard[1000];
+	int i, m, r, rb, n_bits, n_out;
+	//state of a linear congruential generator, for reproducible bits
+	unsigned int lcg = 12345;
+	//one data rate per modulation, and one per coding rate
+	const enum DATA_RATE modulations[] = {BW_20_DR_6_MBPS, BW_20_DR_12_MBPS, BW_20_DR_24_MBPS, BW_20_DR_48_MBPS};
+	const enum CODING_RATE rates[] = {RATE_1_2, RATE_2_3, RATE_3_4};
+	struct OFDM_PARAMETERS params = get_ofdm_parameter(BW_20_DR_36_MBPS);
+
+	rb = read_bits_from_file(argv[1], interleaved, 1000);
+
+	if (rb == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (rb == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	n_bits = rb * 8;
+	bits_to_soft(interleaved, n_bits, soft);
+	deinterleave_soft(soft, deinterleaved, n_bits, params.n_cbps, params.n_bpsc);
+
+	memset(hard, 0, rb);
+	for (i = 0; i < n_bits; i++) {
+		set_bit(&hard[i / 8], 7 - i % 8, deinterleaved[i] > 0);
+	}
+	print_bits_array(hard, rb, '\n');
+
+	//interleaving loopback, for every modulation
+	for (m = 0; m < sizeof(modulations) / sizeof(modulations[0]); m++) {
+		char *bits, *inter;
+		struct OFDM_PARAMETERS p = get_ofdm_parameter(modulations[m]);
+		n_bits = N_SYMBOLS * p.n_cbps;
+		bits = (char *)malloc(n_bits / 8);
+		inter = (char *)calloc(n_bits / 8, sizeof(char));
+		for (i = 0; i < n_bits / 8; i++) {
+			lcg = lcg * 1103515245 + 12345;
+			bits[i] = (char)(lcg >> 16);
+		}
+		interleave(bits, inter, n_bits / 8, p.n_cbps, p.n_bpsc);
+		bits_to_soft(inter, n_bits, soft);
+		deinterleave_soft(soft, deinterleaved, n_bits, p.n_cbps, p.n_bpsc);
+		if (count_errors(deinterleaved, bits, n_bits) != 0) {
+			printf("deinterleaving mismatch for n_cbps %d\n", p.n_cbps);
+			return 1;
+		}
+		free(bits);
+		free(inter);
+	}
+	//the tables of the deinterleaver are only valid for the symbol size of each modulation
+	if (deinterleave_soft(soft, deinterleaved, 2 * N_DATA_SUBCARRIERS, 2 * N_DATA_SUBCARRIERS, 1) !=
+	        ERR_SOFT_INTERLEAVER) {
+		printf("deinterleaving accepted n_cbps %d for BPSK\n", 2 * N_DATA_SUBCARRIERS);
+		return 1;
+	}
+
+	//puncturing loopback, for every coding rate
+	for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+		char bits[72], punctured[72];
+		int n_punctured;
+		//72 bytes are a multiple of every puncturing period
+		n_bits = sizeof(bits) * 8;
+		for (i = 0; i < sizeof(bits); i++) {
+			lcg = lcg * 1103515245 + 12345;
+			bits[i] = (char)(lcg >> 16);
+		}
+		n_punctured = rates[r] == RATE_1_2 ? sizeof(bits) :
+		              rates[r] == RATE_2_3 ? sizeof(bits) * 3 / 4 : sizeof(bits) * 2 / 3;
+		if (rates[r] == RATE_1_2) {
+			memcpy(punctured, bits, sizeof(bits));
+		}
+		else {
+			puncturing(bits, punctured, sizeof(bits), rates[r]);
+		}
+		bits_to_soft(punctured, n_punctured * 8, soft);
+		n_out = depuncture_soft(soft, n_punctured * 8, rates[r], depunctured);
+		if (n_out != n_bits) {
+			printf("depunctured size %d instead of %d\n", n_out, n_bits);
+			return 1;
+		}
+		//erasures must be exactly where puncturing() dropped the bits
+		for (i = 0; i < n_bits; i++) {
+			int dropped = (rates[r] == RATE_2_3 && i % 4 == 3) ||
+			              (rates[r] == RATE_3_4 && (i % 6 == 3 || i % 6 == 4));
+			if (dropped ? depunctured[i] != 0 :
+			    (depunctured[i] > 0) != (get_bit(bits[i / 8], 7 - i % 8) != 0)) {
+				printf("depuncturing mismatch at bit %d, rate %d\n", i, rates[r]);
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+
+}
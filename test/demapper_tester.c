@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fftw3.h>
+
+#include "soft_utils.h"
+#include "bit_utils.h"
+
+//number of random OFDM symbols of the loopback test
+#define N_SYMBOLS 4
+
+/**
+ * Returns the data subcarriers (-26 to 26, without DC and pilots) of a
+ * symbol given as 64 subcarriers from -32 to 31
+ */
+void get_data_subcarriers(fftw_complex *symbol, fftw_complex *data) {
+	int i, n = 0;
+	for (i = -26; i <= 26; i++) {
+		if (i != 0 && i != -21 && i != -7 && i != 7 && i != 21) {
+			data[n][0] = symbol[i + 32][0];
+			data[n][1] = symbol[i + 32][1];
+			n++;
+		}
+	}
+}
+
+/**
+ * Turns soft bits into packed hard decisions
+ */
+void hard_decisions(const signed char *soft, int size, char *bits) {
+	int i;
+	memset(bits, 0, (size + 7) / 8);
+	for (i = 0; i < size; i++) {
+		if (soft[i] > 0) {
+			bits[i / 8] |= (char)(0x80 >> (i % 8));
+		}
+	}
+}
+
+/**
+ * This test application takes in input the frequency domain representation
+ * of the first DATA symbol of the 802.11-2012 example frame (annex L, 16-QAM),
+ * demaps its data subcarriers into soft bits and prints the hard decisions,
+ * which are the interleaved bits of the first symbol. It then modulates random
+ * bits with every modulation, demaps them with a different gain on each
+ * subcarrier, and reports wrong decisions and soft values not weighted by the
+ * gain
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	fftw_complex symbol[FFT_SIZE];
+	fftw_complex *data;
+	double gain[N_SYMBOLS * N_DATA_SUBCARRIERS];
+	signed char soft[N_SYMBOLS * N_DATA_SUBCARRIERS * 6];
+	char bits[N_SYMBOLS * N_DATA_SUBCARRIERS * 6 / 8], decided[N_SYMBOLS * N_DATA_SUBCARRIERS * 6 / 8];
+	enum DATA_RATE rates[] = {BW_20_DR_6_MBPS, BW_20_DR_12_MBPS, BW_20_DR_24_MBPS, BW_20_DR_48_MBPS};
+	//state of a linear congruential generator, for reproducible bits
+	unsigned int lcg = 12345;
+	int i, r, n;
+
+	n = read_complex_from_file(argv[1], symbol, FFT_SIZE);
+
+	if (n == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	data = fftw_alloc_complex(N_SYMBOLS * N_DATA_SUBCARRIERS);
+
+	//loopback through modulate(), for every modulation
+	for (i = 0; i < N_SYMBOLS * N_DATA_SUBCARRIERS; i++) {
+		gain[i] = 0.25 + (i % 8) * 0.25;
+	}
+	for (r = 0; r < sizeof(rates) / sizeof(enum DATA_RATE); r++) {
+		struct OFDM_PARAMETERS params = get_ofdm_parameter(rates[r]);
+		int size = N_SYMBOLS * params.n_cbps / 8;
+		for (i = 0; i < size; i++) {
+			lcg = lcg * 1103515245 + 12345;
+			bits[i] = (char)(lcg >> 16);
+		}
+		modulate(bits, size, rates[r], data);
+		demap_soft(data, gain, N_SYMBOLS * N_DATA_SUBCARRIERS, params.modulation, DEMAP_DEFAULT_SCALE, soft);
+		hard_decisions(soft, size * 8, decided);
+		if (memcmp(bits, decided, size) != 0) {
+			printf("wrong decisions for %s\n", STR_DATA_RATE[rates[r]]);
+		}
+		//the first bit of each subcarrier is the sign of the I component,
+		//whose magnitude is at least one step
+		for (i = 0; i < N_SYMBOLS * N_DATA_SUBCARRIERS; i++) {
+			int expected = (int)(DEMAP_DEFAULT_SCALE * gain[i]);
+			int value = abs(soft[i * params.n_bpsc]);
+			if (value < expected && value != SOFT_MAX) {
+				printf("soft value %d of subcarrier %d too small for %s\n", value, i, STR_DATA_RATE[rates[r]]);
+			}
+		}
+	}
+
+	//first DATA symbol of the example frame
+	get_data_subcarriers(symbol, data);
+	demap_soft(data, 0, N_DATA_SUBCARRIERS, QAM16, DEMAP_DEFAULT_SCALE, soft);
+	hard_decisions(soft, N_DATA_SUBCARRIERS * 4, decided);
+	print_bits_array(decided, N_DATA_SUBCARRIERS * 4 / 8, '\n');
+
+	fftw_free(data);
+
+	return 0;
+
+}
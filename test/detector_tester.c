@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <fftw3.h>
+
+#include "detector_utils.h"
+#include "bit_utils.h"
+
+//number of noise samples before the frame, and between the two frames
+#define N_NOISE 200
+#define N_GAP 300
+//fractional delay of the second frame, in samples
+#define DELAY 0.3
+//maximum number of events per chunk
+#define MAX_EVENTS 16
+//size of the chunks given to the detectors
+#define CHUNK_SIZE 50
+//threshold on the timing metric
+#define THRESHOLD 0.8
+//threshold on the long training metric
+#define LONG_THRESHOLD 0.5
+
+/**
+ * Fill the samples with low level noise
+ */
+void add_noise(fftw_complex *samples, int size, unsigned int *lcg) {
+	int i;
+	for (i = 0; i < size; i++) {
+		*lcg = *lcg * 1103515245 + 12345;
+		samples[i][0] = ((int)(*lcg >> 16) % 201 - 100) / 10000.0;
+		*lcg = *lcg * 1103515245 + 12345;
+		samples[i][1] = ((int)(*lcg >> 16) % 201 - 100) / 10000.0;
+	}
+}
+
+/**
+ * Print the events generated by a detector
+ */
+void print_events(const char *detector, struct DETECTION_EVENT *events, int n_events) {
+	int i;
+	for (i = 0; i < n_events; i++) {
+		//round the offset, adding 0 to turn a negative zero into a positive one
+		printf("%s event: sample %lld offset %.2f metric %.3f\n", detector, events[i].sample,
+		       round(events[i].offset * 100) / 100 + 0.0, events[i].metric);
+	}
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), builds a stream with two copies of the frame
+ * separated by low level noise, the second one delayed by a fraction of a sample, and feeds it in chunks to the double and
+ * single precision streaming short training detectors and to the long
+ * training detector and correlator. It prints the sample where a frame is first detected,
+ * the events generated by each detector, and the timing metric of the short
+ * training detectors every 16 samples
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	fftw_complex *samples;
+	sample_cf32_t *samples_f;
+	double *metric;
+	float *metric_f;
+	struct SHORT_TRAINING_DETECTOR d;
+	struct SHORT_TRAINING_DETECTOR_F df;
+	struct LONG_TRAINING_DETECTOR dl;
+	struct LONG_TRAINING_CORRELATOR cl;
+	struct DETECTION_EVENT events[MAX_EVENTS];
+	int detected = -1, detected_f = -1;
+	int i, n, size, r;
+	//state of a linear congruential generator, for reproducible noise
+	unsigned int lcg = 12345;
+
+	samples = fftw_alloc_complex(2 * N_NOISE + N_GAP + 2000);
+	n = read_complex_from_file(argv[1], &samples[N_NOISE], 1000);
+
+	if (n == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	//noise, frame, gap, frame, noise
+	add_noise(samples, N_NOISE, &lcg);
+	add_noise(&samples[N_NOISE + n], N_GAP, &lcg);
+	//the second frame is delayed by a fraction of a sample, through linear interpolation
+	for (i = 0; i < n; i++) {
+		fftw_complex *out = &samples[N_NOISE + n + N_GAP + i];
+		(*out)[0] = (1 - DELAY) * samples[N_NOISE + i][0] + (i > 0 ? DELAY * samples[N_NOISE + i - 1][0] : 0);
+		(*out)[1] = (1 - DELAY) * samples[N_NOISE + i][1] + (i > 0 ? DELAY * samples[N_NOISE + i - 1][1] : 0);
+	}
+	add_noise(&samples[N_NOISE + 2 * n + N_GAP], N_NOISE, &lcg);
+	size = 2 * N_NOISE + N_GAP + 2 * n;
+
+	samples_f = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * size);
+	for (i = 0; i < size; i++) {
+		samples_f[i][0] = (float)samples[i][0];
+		samples_f[i][1] = (float)samples[i][1];
+	}
+	metric = (double *)malloc(sizeof(double) * size);
+	metric_f = (float *)malloc(sizeof(float) * size);
+
+	init_short_training_detector(&d);
+	init_short_training_detector_f(&df);
+
+	printf("frame starts: %d %d\n", N_NOISE, N_NOISE + n + N_GAP);
+
+	for (i = 0; i < size; i += CHUNK_SIZE) {
+		int chunk = size - i < CHUNK_SIZE ? size - i : CHUNK_SIZE;
+		r = update_short_training_detector(&d, &samples[i], chunk, THRESHOLD, &metric[i]);
+		if (r != -1 && detected == -1) {
+			detected = i + r;
+		}
+		r = update_short_training_detector_f(&df, &samples_f[i], chunk, THRESHOLD, &metric_f[i]);
+		if (r != -1 && detected_f == -1) {
+			detected_f = i + r;
+		}
+	}
+
+	//same stream, through the event based interface
+	init_short_training_detector(&d);
+	init_short_training_detector_f(&df);
+	init_long_training_detector(&dl);
+	for (i = 0; i < size; i += CHUNK_SIZE) {
+		int chunk = size - i < CHUNK_SIZE ? size - i : CHUNK_SIZE;
+		r = detect_short_training_events(&d, &samples[i], chunk, THRESHOLD, events, MAX_EVENTS);
+		print_events("short (double)", events, r);
+		r = detect_short_training_events_f(&df, &samples_f[i], chunk, THRESHOLD, events, MAX_EVENTS);
+		print_events("short (float)", events, r);
+		r = detect_long_training_events(&dl, &samples[i], chunk, LONG_THRESHOLD, events, MAX_EVENTS);
+		print_events("long", events, r);
+	}
+
+	//long training peaks through the FFT correlator, in the same chunks
+	init_long_training_correlator(&cl);
+	for (i = 0; i < size; i += CHUNK_SIZE) {
+		int chunk = size - i < CHUNK_SIZE ? size - i : CHUNK_SIZE;
+		r = correlate_long_training(&cl, &samples[i], chunk, LONG_THRESHOLD, events, MAX_EVENTS);
+		print_events("long (fft)", events, r);
+	}
+	r = flush_long_training_correlator(&cl, LONG_THRESHOLD, events, MAX_EVENTS);
+	print_events("long (fft)", events, r);
+	free_long_training_correlator(&cl);
+
+	printf("detected (double): %d\n", detected);
+	printf("detected (float): %d\n", detected_f);
+	for (i = 0; i < size; i += 16) {
+		printf("%d %.3f %.3f\n", i, metric[i], metric_f[i]);
+	}
+
+	fftw_free(samples);
+	free(samples_f);
+	free(metric);
+	free(metric_f);
+
+	return 0;
+
+}
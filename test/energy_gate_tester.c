@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <fftw3.h>
+
+#include "detector_utils.h"
+#include "bit_utils.h"
+#include "test_utils.h"
+
+//signal to noise ratios of the frames, in dB, and copies of the frame at each of them
+#define N_SNRS 6
+static const int snrs[N_SNRS] = {20, 15, 12, 9, 6, 3};
+#define N_COPIES 10
+#define N_FRAMES (N_SNRS * N_COPIES)
+//noise between the frames. The amplitude of the noise changes after half of the frames, as
+//after a change of the gain of the radio
+#define GAP_SIZE 20000
+#define NOISE_AMPLITUDE 0.01
+#define NOISE_STEP 4
+#define THRESHOLD 0.8
+#define MAX_EVENTS (4 * N_FRAMES)
+
+/**
+ * Runs the short training detector over the stream, through an energy gate
+ * or in bypass mode, feeding it in chunks of random sizes. Returns the number
+ * of events, and the fraction of blocks given to the detector
+ */
+int detect(const sample_cf32_t *stream, int size, int bypass, unsigned int seed, struct DETECTION_EVENT *events,
+           double *open) {
+	struct ENERGY_GATE g;
+	struct SHORT_TRAINING_DETECTOR_F d;
+	int pos, n, n_events = 0;
+	init_energy_gate(&g);
+	init_short_training_detector_f(&d);
+	g.bypass = bypass;
+	for (pos = 0; pos < size; pos += n) {
+		n = 1 + next_random(&seed) % 2000;
+		n = pos + n < size ? n : size - pos;
+		n_events += detect_short_training_events_gated_f(&g, &d, &stream[pos], n, THRESHOLD, &events[n_events],
+		                                                 MAX_EVENTS - n_events);
+	}
+	*open = (double)g.n_open / g.n_blocks;
+	return n_events;
+}
+
+/**
+ * Returns whether there is an event for the frame starting at the given sample
+ */
+int detected(const struct DETECTION_EVENT *events, int n_events, long long start) {
+	int i;
+	for (i = 0; i < n_events; i++) {
+		if (events[i].sample >= start - SC_WINDOW && events[i].sample <= start + SC_WINDOW) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), and builds a stream with copies of it at several
+ * signal to noise ratios, separated by noise whose level changes halfway.
+ * The short training detector is run over the stream through the energy
+ * gate and in bypass mode, printing for each signal to noise ratio how many
+ * frames are detected, and which fraction of the stream has gone through
+ * the detector. It then checks that the gated events do not depend on the
+ * size of the chunks, and that they are the events of the bypass mode for
+ * all the frames above the noise floor
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	fftw_complex *example;
+	sample_cf32_t *stream;
+	struct DETECTION_EVENT gated[MAX_EVENTS], bypass[MAX_EVENTS], rechunked[MAX_EVENTS];
+	long long starts[N_FRAMES];
+	double frame_power = 0, noise, scale, open_gated, open_bypass;
+	int i, j, k, n_example, size, pos, n_gated, n_bypass, n_rechunked, found_gated, found_bypass, same;
+	//state of a linear congruential generator, for reproducible noise
+	unsigned int lcg = 8642;
+
+	example = fftw_alloc_complex(1000);
+	n_example = read_complex_from_file(argv[1], example, 1000);
+
+	if (n_example == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n_example == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	for (k = 0; k < n_example; k++) {
+		frame_power += example[k][0] * example[k][0] + example[k][1] * example[k][1];
+	}
+	frame_power /= n_example;
+
+	//frames at all the signal to noise ratios, in turn
+	size = N_FRAMES * (n_example + GAP_SIZE) + GAP_SIZE;
+	stream = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * size);
+	pos = GAP_SIZE;
+	for (i = 0; i < N_FRAMES; i++) {
+		starts[i] = pos;
+		pos += n_example + GAP_SIZE;
+	}
+	for (i = 0; i < size; i++) {
+		noise = i < starts[N_FRAMES / 2] - GAP_SIZE / 2 ? NOISE_AMPLITUDE : NOISE_AMPLITUDE * NOISE_STEP;
+		stream[i][0] = uniform_noise(&lcg, noise);
+		stream[i][1] = uniform_noise(&lcg, noise);
+	}
+	for (i = 0; i < N_FRAMES; i++) {
+		//uniform noise in [-a, a] on both components has power 2 a^2 / 3
+		noise = i < N_FRAMES / 2 ? NOISE_AMPLITUDE : NOISE_AMPLITUDE * NOISE_STEP;
+		scale = sqrt(pow(10, snrs[i % N_SNRS] / 10.0) * 2 * noise * noise / 3 / frame_power);
+		for (k = 0; k < n_example; k++) {
+			stream[starts[i] + k][0] += example[k][0] * scale;
+			stream[starts[i] + k][1] += example[k][1] * scale;
+		}
+	}
+
+	n_gated = detect(stream, size, 0, 1, gated, &open_gated);
+	n_bypass = detect(stream, size, 1, 1, bypass, &open_bypass);
+	for (j = 0; j < N_SNRS; j++) {
+		found_gated = found_bypass = 0;
+		for (i = j; i < N_FRAMES; i += N_SNRS) {
+			found_gated += detected(gated, n_gated, starts[i]);
+			found_bypass += detected(bypass, n_bypass, starts[i]);
+		}
+		printf("%d dB: %d of %d frames detected with the gate, %d in bypass mode\n", snrs[j], found_gated, N_COPIES,
+		       found_bypass);
+	}
+	printf("stream through the detector: %.0f%% with the gate, %.0f%% in bypass mode\n", open_gated * 100,
+	       open_bypass * 100);
+
+	n_rechunked = detect(stream, size, 0, 2, rechunked, &open_gated);
+	printf("gated events with other chunks: %s\n", n_rechunked == n_gated &&
+	       memcmp(rechunked, gated, sizeof(struct DETECTION_EVENT) * n_gated) == 0 ? "same" : "different");
+
+	//events of the frames at 9 dB or more, which are always above the margin
+	same = 1;
+	for (i = 0; i < N_FRAMES; i++) {
+		if (snrs[i % N_SNRS] < 9) {
+			continue;
+		}
+		for (j = 0; j < n_bypass; j++) {
+			if (detected(&bypass[j], 1, starts[i])) {
+				for (k = 0; k < n_gated && gated[k].sample != bypass[j].sample; k++);
+				if (k == n_gated || fabs(gated[k].metric - bypass[j].metric) > 1e-3) {
+					same = 0;
+				}
+			}
+		}
+	}
+	printf("events of the frames at 9 dB or more: %s bypass mode\n", same ? "same as" : "different from");
+
+	free(stream);
+	fftw_free(example);
+
+	return 0;
+
+}
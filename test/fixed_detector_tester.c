@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <fftw3.h>
+
+#include "detector_utils.h"
+#include "bit_utils.h"
+#include "test_utils.h"
+
+//copies of the frame, separated by noise, and amplitude of each of them. The last one is clipped
+#define N_FRAMES 4
+static const double amplitudes[N_FRAMES] = {30000, 3000, 300, 200000};
+#define GAP_SIZE 700
+#define NOISE_AMPLITUDE 20
+#define STREAM_SIZE (N_FRAMES * (1000 + GAP_SIZE) + GAP_SIZE)
+#define THRESHOLD 0.8
+#define LONG_THRESHOLD 0.5
+#define MAX_EVENTS 32
+//size of the chunks given to the detectors
+#define CHUNK_SIZE 77
+//samples of full scale noise
+#define FULL_SCALE_SIZE 65536
+
+/**
+ * Runs the fixed point detectors over the stream in chunks of the given size
+ */
+void detect(const sample_sc16_t *stream, int size, int chunk_size, struct DETECTION_EVENT *short_events,
+            int *n_short, struct DETECTION_EVENT *long_events, int *n_long) {
+	struct SHORT_TRAINING_DETECTOR_S16 sd;
+	struct LONG_TRAINING_DETECTOR_S16 ld;
+	int pos, n;
+	init_short_training_detector_s16(&sd);
+	init_long_training_detector_s16(&ld);
+	*n_short = *n_long = 0;
+	for (pos = 0; pos < size; pos += n) {
+		n = size - pos < chunk_size ? size - pos : chunk_size;
+		*n_short += detect_short_training_events_s16(&sd, &stream[pos], n, THRESHOLD, &short_events[*n_short],
+		                                             MAX_EVENTS - *n_short);
+		*n_long += detect_long_training_events_s16(&ld, &stream[pos], n, LONG_THRESHOLD, &long_events[*n_long],
+		                                           MAX_EVENTS - *n_long);
+	}
+}
+
+/**
+ * Returns whether two lists of events have the same samples, and metrics
+ * within the given tolerance
+ */
+int same_events(const struct DETECTION_EVENT *a, int n_a, const struct DETECTION_EVENT *b, int n_b, double tolerance) {
+	int i;
+	if (n_a != n_b) {
+		return 0;
+	}
+	for (i = 0; i < n_a; i++) {
+		if (a[i].sample != b[i].sample || fabs(a[i].metric - b[i].metric) > tolerance) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), and builds an sc16 stream with copies of it at
+ * several amplitudes, down to a few units above the noise, the last one
+ * clipped at full scale. The fixed point short and long training detectors
+ * are run over the stream, printing their events, and checking that they
+ * are the same with every backend and chunk size, and that they match the
+ * events of the floating point detectors run over the same samples. The
+ * short training detectors are also run over full scale noise
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	struct SHORT_TRAINING_DETECTOR_F sdf;
+	struct LONG_TRAINING_DETECTOR ld;
+	struct DETECTION_EVENT short_events[MAX_EVENTS], long_events[MAX_EVENTS];
+	struct DETECTION_EVENT other_short[MAX_EVENTS], other_long[MAX_EVENTS];
+	fftw_complex *example, *stream;
+	sample_sc16_t *stream_s16, *noise_s16;
+	sample_cf32_t *stream_f, *noise_f;
+	double v;
+	int i, k, b, n_example, pos, n_short, n_long, n_other_short, n_other_long;
+	//state of a linear congruential generator, for reproducible noise
+	unsigned int lcg = 3579;
+
+	example = fftw_alloc_complex(1000);
+	n_example = read_complex_from_file(argv[1], example, 1000);
+
+	if (n_example == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n_example == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	stream = fftw_alloc_complex(STREAM_SIZE);
+	for (i = 0; i < STREAM_SIZE; i++) {
+		stream[i][0] = (int)next_random(&lcg) % (2 * NOISE_AMPLITUDE + 1) - NOISE_AMPLITUDE;
+		stream[i][1] = (int)next_random(&lcg) % (2 * NOISE_AMPLITUDE + 1) - NOISE_AMPLITUDE;
+	}
+	pos = GAP_SIZE;
+	for (i = 0; i < N_FRAMES; i++) {
+		printf("frame %d: sample %d, amplitude %.0f\n", i, pos, amplitudes[i]);
+		add_frame(stream, pos, example, n_example, amplitudes[i]);
+		pos += n_example + GAP_SIZE;
+	}
+	//sc16 samples, clipped at full scale, and the same samples in floating point
+	stream_s16 = (sample_sc16_t *)malloc(sizeof(sample_sc16_t) * STREAM_SIZE);
+	stream_f = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * STREAM_SIZE);
+	for (i = 0; i < STREAM_SIZE; i++) {
+		for (k = 0; k < 2; k++) {
+			v = round(stream[i][k]);
+			stream_s16[i][k] = (short)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+			//the fixed point detectors take -32768 as -32767
+			stream[i][k] = stream_s16[i][k] == -32768 ? -32767 : stream_s16[i][k];
+			stream_f[i][k] = (float)stream[i][k];
+		}
+	}
+
+	set_detector_backend(DETECTOR_SCALAR);
+	detect(stream_s16, STREAM_SIZE, CHUNK_SIZE, short_events, &n_short, long_events, &n_long);
+	for (i = 0; i < n_short; i++) {
+		printf("short training event: sample %lld metric %.3f\n", short_events[i].sample, short_events[i].metric);
+	}
+	for (i = 0; i < n_long; i++) {
+		printf("long training event: sample %lld metric %.3f\n", long_events[i].sample, long_events[i].metric);
+	}
+
+	//every backend, with the whole stream at once
+	for (b = DETECTOR_SCALAR; b <= DETECTOR_AVX2; b++) {
+		if (set_detector_backend(b) != 0) {
+			continue;
+		}
+		detect(stream_s16, STREAM_SIZE, STREAM_SIZE, other_short, &n_other_short, other_long, &n_other_long);
+		if (!same_events(short_events, n_short, other_short, n_other_short, 0) ||
+		        !same_events(long_events, n_long, other_long, n_other_long, 0)) {
+			printf("backend %s differs from scalar\n", STR_DETECTOR_BACKEND[b]);
+		}
+	}
+
+	//floating point detectors
+	init_short_training_detector_f(&sdf);
+	n_other_short = detect_short_training_events_f(&sdf, stream_f, STREAM_SIZE, THRESHOLD, other_short, MAX_EVENTS);
+	printf("short training events: %s single precision detector\n",
+	       same_events(short_events, n_short, other_short, n_other_short, 1e-4) ? "same as" : "different from");
+	init_long_training_detector(&ld);
+	n_other_long = detect_long_training_events(&ld, stream, STREAM_SIZE, LONG_THRESHOLD, other_long, MAX_EVENTS);
+	printf("long training events: %s double precision detector\n",
+	       same_events(long_events, n_long, other_long, n_other_long, 1e-2) ? "same as" : "different from");
+
+	//full scale noise, whose products and energies are close to the limits of 32 bits
+	noise_s16 = (sample_sc16_t *)malloc(sizeof(sample_sc16_t) * FULL_SCALE_SIZE);
+	noise_f = (sample_cf32_t *)malloc(sizeof(sample_cf32_t) * FULL_SCALE_SIZE);
+	for (i = 0; i < FULL_SCALE_SIZE; i++) {
+		for (k = 0; k < 2; k++) {
+			noise_s16[i][k] = (short)((int)next_random(&lcg) - 32768);
+			noise_f[i][k] = noise_s16[i][k] == -32768 ? -32767 : noise_s16[i][k];
+		}
+	}
+	set_detector_backend(DETECTOR_SCALAR);
+	detect(noise_s16, FULL_SCALE_SIZE, FULL_SCALE_SIZE, short_events, &n_short, long_events, &n_long);
+	for (b = DETECTOR_SCALAR; b <= DETECTOR_AVX2; b++) {
+		if (set_detector_backend(b) != 0) {
+			continue;
+		}
+		detect(noise_s16, FULL_SCALE_SIZE, FULL_SCALE_SIZE, other_short, &n_other_short, other_long, &n_other_long);
+		if (!same_events(short_events, n_short, other_short, n_other_short, 0)) {
+			printf("backend %s differs from scalar on full scale noise\n", STR_DETECTOR_BACKEND[b]);
+		}
+	}
+	init_short_training_detector_f(&sdf);
+	n_other_short = detect_short_training_events_f(&sdf, noise_f, FULL_SCALE_SIZE, THRESHOLD, other_short, MAX_EVENTS);
+	printf("full scale noise: %d short training events, %d with the single precision detector\n", n_short,
+	       n_other_short);
+
+	free(noise_s16);
+	free(noise_f);
+	free(stream_s16);
+	free(stream_f);
+	fftw_free(stream);
+	fftw_free(example);
+
+	return 0;
+
+}
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fftw3.h>
+
+#include "index_utils.h"
+#include "mac_utils.h"
+#include "bit_utils.h"
+#include "test_utils.h"
+
+//number of frames of the capture, and frame with a wrong frame check sequence
+#define N_FRAMES 24
+#define CORRUPTED_FRAME 9
+//frame decoded again from its record
+#define SEEK_FRAME 13
+#define CAPTURE_SIZE 100000
+#define MSDU_SIZE 200
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), and builds a capture with copies of it and frames
+ * generated by the framer at every data rate, one of them with a wrong frame
+ * check sequence. The capture is written to a cf32 file, which is decoded by
+ * a decoder pool that writes the frame index while decoding. The index is
+ * then read back, printing its records, decoding a frame again from the
+ * position in its record, and searching frames by data rate and frame check sequence. Finally, it checks
+ * that a partially written record is ignored and that a file which is not an
+ * index is rejected
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	struct OFDM_FRAME_ENCODER enc;
+	struct OFDM_FRAME_DECODER dec;
+	struct DECODER_POOL pool;
+	struct FRAME_INDEX_WRITER writer;
+	struct FRAME_INDEX idx;
+	const struct FRAME_INDEX_RECORD *r;
+	struct CAPTURE c;
+	fftw_complex *frame, *example, *capture, *samples;
+	char msdu[MSDU_SIZE], psdu[RX_MAX_PSDU_SIZE], *sent[N_FRAMES];
+	char filename[64], *capture_filename;
+	FILE *f;
+	long long pos, n;
+	int i, k, n_samples, n_example, length, psdu_size, err;
+	//state of a linear congruential generator, for reproducible noise and data
+	unsigned int lcg = 2468;
+
+	example = fftw_alloc_complex(1000);
+	n_example = read_complex_from_file(argv[1], example, 1000);
+
+	if (n_example == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n_example == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	capture = fftw_alloc_complex(CAPTURE_SIZE);
+	generate_noise(capture, CAPTURE_SIZE, 0.01, &lcg);
+	init_ofdm_frame_encoder(&enc);
+	pos = 500;
+	for (i = 0; i < N_FRAMES; i++) {
+		if (i % 6 == 5) {
+			frame = example;
+			n_samples = n_example;
+			sent[i] = NULL;
+		}
+		else {
+			for (k = 0; k < MSDU_SIZE; k++) {
+				msdu[k] = (char)next_random(&lcg);
+			}
+			generate_mac_data_frame(msdu, MSDU_SIZE, generate_default_mac_header(), &sent[i], &psdu_size);
+			if (i == CORRUPTED_FRAME) {
+				sent[i][30] ^= 0x10;
+			}
+			generate_ofdm_frame(&enc, sent[i], psdu_size, (enum DATA_RATE)(i % (N_DATA_RATES / 2)), &frame,
+			                    &n_samples);
+		}
+		add_frame(capture, pos, frame, n_samples, 1);
+		if (frame != example) {
+			fftw_free(frame);
+		}
+		pos += n_samples + 200 + next_random(&lcg) % 1000;
+	}
+
+	//the index is written while the capture is decoded
+	capture_filename = write_capture(capture, CAPTURE_SIZE, CAPTURE_CF32);
+	open_capture(&c, capture_filename, CAPTURE_CF32);
+	sprintf(filename, "/tmp/frame-index-tester-XXXXXX");
+	close(mkstemp(filename));
+	init_decoder_pool(&pool, 2);
+	create_frame_index(&writer, filename, CAPTURE_CF32);
+	n = decode_capture(&pool, &c, index_decoded_frame, &writer);
+	close_frame_index_writer(&writer);
+	free_decoder_pool(&pool);
+	printf("decoded frames: %lld, records written: %lld, write result: %d\n", n, writer.n_records, writer.err);
+
+	err = open_frame_index(&idx, filename);
+	printf("open: %d, format %s, %lld records\n", err, STR_CAPTURE_FORMAT[idx.format], idx.n_records);
+	for (n = 0; n < idx.n_records; n++) {
+		r = get_frame_index_record(&idx, n);
+		printf("frame %lld: sample %lld, %d samples, %s, %d bytes, result %d, snr above 20 dB: %s\n", n, r->offset,
+		       r->n_samples, STR_DATA_RATE[r->data_rate], r->psdu_size, r->status, r->snr > 20 ? "yes" : "no");
+	}
+	printf("record %d: %s\n", N_FRAMES, get_frame_index_record(&idx, N_FRAMES) == NULL ? "none" : "found");
+
+	//seek to a frame, and decode it again
+	r = get_frame_index_record(&idx, SEEK_FRAME);
+	samples = fftw_alloc_complex(r->n_samples);
+	read_capture_samples(&c, r->offset, r->n_samples, samples);
+	init_ofdm_frame_decoder(&dec);
+	err = ofdm_decode_frame(&dec, samples, r->n_samples, psdu, &length, NULL);
+	printf("frame %d decoded again: result %d, same PSDU: %s\n", SEEK_FRAME, err,
+	       length == r->psdu_size && memcmp(psdu, sent[SEEK_FRAME], length) == 0 ? "yes" : "no");
+	free_ofdm_frame_decoder(&dec);
+	fftw_free(samples);
+	close_capture(&c);
+	unlink(capture_filename);
+	free(capture_filename);
+
+	//search by data rate and frame check sequence
+	printf("36 and 54 Mbps frames:");
+	for (n = find_frame_index_record(&idx, 0, (1 << BW_20_DR_36_MBPS) | (1 << BW_20_DR_54_MBPS), 0); n != -1;
+	        n = find_frame_index_record(&idx, n + 1, (1 << BW_20_DR_36_MBPS) | (1 << BW_20_DR_54_MBPS), 0)) {
+		printf(" %lld", n);
+	}
+	printf("\n");
+	k = 0;
+	for (n = find_frame_index_record(&idx, 0, 0, 1); n != -1; n = find_frame_index_record(&idx, n + 1, 0, 1)) {
+		k++;
+	}
+	printf("frames with a correct FCS: %d\n", k);
+	close_frame_index(&idx);
+
+	//a record being written is ignored
+	f = fopen(filename, "ab");
+	fwrite(capture, 10, 1, f);
+	fclose(f);
+	err = open_frame_index(&idx, filename);
+	printf("partial record: open %d, %lld records\n", err, idx.n_records);
+	close_frame_index(&idx);
+
+	//a file which is not an index
+	f = fopen(filename, "wb");
+	fwrite(capture, sizeof(fftw_complex), 100, f);
+	fclose(f);
+	printf("not an index: %d\n", open_frame_index(&idx, filename));
+	unlink(filename);
+	printf("missing file: %d\n", open_frame_index(&idx, filename));
+
+	for (i = 0; i < N_FRAMES; i++) {
+		free(sent[i]);
+	}
+	free_ofdm_frame_encoder(&enc);
+	fftw_free(example);
+	fftw_free(capture);
+
+	return 0;
+
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <fftw3.h>
+
+#include "receiver_utils.h"
+#include "mac_utils.h"
+#include "bit_utils.h"
+
+//number of noise samples before and after each frame
+#define N_NOISE 200
+//carrier frequency offset applied to the frames of the framer (rad/sample), i.e., about 100 kHz at 20 MHz
+#define CFO 0.03
+//sizes of the MSDUs given to the framer
+#define N_MSDU_SIZES 3
+static const int msdu_sizes[N_MSDU_SIZES] = {0, 100, 1500};
+
+/**
+ * Fill the samples with low level noise
+ */
+void add_noise(fftw_complex *samples, int size, unsigned int *lcg) {
+	int i;
+	for (i = 0; i < size; i++) {
+		*lcg = *lcg * 1103515245 + 12345;
+		samples[i][0] = ((int)(*lcg >> 16) % 201 - 100) / 10000.0;
+		*lcg = *lcg * 1103515245 + 12345;
+		samples[i][1] = ((int)(*lcg >> 16) % 201 - 100) / 10000.0;
+	}
+}
+
+/**
+ * Copies a frame after N_NOISE noise samples, applying a frequency offset
+ * and adding noise, and returns the number of samples of the stream
+ */
+int build_stream(const fftw_complex *frame, int size, double cfo, fftw_complex *stream, unsigned int *lcg) {
+	int i;
+	add_noise(stream, size + 2 * N_NOISE, lcg);
+	for (i = 0; i < size; i++) {
+		stream[N_NOISE + i][0] += frame[i][0] * cos(cfo * i) - frame[i][1] * sin(cfo * i);
+		stream[N_NOISE + i][1] += frame[i][0] * sin(cfo * i) + frame[i][1] * cos(cfo * i);
+	}
+	return size + 2 * N_NOISE;
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), surrounds them with noise and decodes them with
+ * ofdm_decode_frame(), printing the parameters of the frame and the decoded
+ * PSDU. It then generates frames with the framer, at every data rate, for
+ * MSDUs of several sizes, random content and random scrambler seeds, applies
+ * a carrier frequency offset and noise, and checks that the decoded PSDUs
+ * are the transmitted ones. Finally, it checks that two frames in a row are
+ * both found, and that a frame with a wrong frame check sequence, a
+ * truncated frame and noise alone are reported as such
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	struct OFDM_FRAME_ENCODER enc;
+	struct OFDM_FRAME_DECODER dec;
+	struct RX_STATS stats;
+	fftw_complex *frame, *stream;
+	char msdu[1500], decoded[RX_MAX_PSDU_SIZE];
+	char *psdu;
+	int i, j, k, n, size, length, psdu_size, err, errors;
+	//state of a linear congruential generator, for reproducible noise and data
+	unsigned int lcg = 12345;
+
+	frame = fftw_alloc_complex(1000);
+	n = read_complex_from_file(argv[1], frame, 1000);
+
+	if (n == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	//large enough for two of the longest frames of the test
+	stream = fftw_alloc_complex(2 * (FRAME_SIZE(600) + 2 * N_NOISE));
+	init_ofdm_frame_decoder(&dec);
+	init_ofdm_frame_encoder(&enc);
+
+	//example frame
+	size = build_stream(frame, n, 0, stream, &lcg);
+	err = ofdm_decode_frame(&dec, stream, size, decoded, &length, &stats);
+	printf("result: %d\n", err);
+	printf("frame start: %d\n", stats.start);
+	printf("data rate: %s\n", STR_DATA_RATE[stats.tx_params.data_rate]);
+	printf("length: %d\n", length);
+	printf("scrambler seed: 0x%02X\n", stats.scrambler_seed);
+	print_hex_array(decoded, length, '\n');
+	printf("\n");
+	fftw_free(frame);
+
+	//frames generated by the framer
+	for (i = 0; i < N_DATA_RATES / 2; i++) {
+		errors = 0;
+		for (j = 0; j < N_MSDU_SIZES; j++) {
+			for (k = 0; k < msdu_sizes[j]; k++) {
+				lcg = lcg * 1103515245 + 12345;
+				msdu[k] = (char)(lcg >> 16);
+			}
+			generate_mac_data_frame(msdu, msdu_sizes[j], generate_default_mac_header(), &psdu, &psdu_size);
+			lcg = lcg * 1103515245 + 12345;
+			enc.scrambler_seed = (char)(1 + (lcg >> 16) % 127);
+			generate_ofdm_frame(&enc, psdu, psdu_size, (enum DATA_RATE)i, &frame, &n);
+			size = build_stream(frame, n, CFO, stream, &lcg);
+			err = ofdm_decode_frame(&dec, stream, size, decoded, &length, &stats);
+			if (err != 0 || length != psdu_size || memcmp(decoded, psdu, psdu_size) != 0 ||
+			        stats.scrambler_seed != enc.scrambler_seed) {
+				errors++;
+			}
+			fftw_free(frame);
+			free(psdu);
+		}
+		printf("%s: %d frames, %d errors\n", STR_DATA_RATE[i], N_MSDU_SIZES, errors);
+	}
+
+	//two frames in a row: the search for the second one starts where the first one ends
+	for (k = 0; k < 100; k++) {
+		msdu[k] = (char)k;
+	}
+	generate_mac_data_frame(msdu, 100, generate_default_mac_header(), &psdu, &psdu_size);
+	generate_ofdm_frame(&enc, psdu, psdu_size, BW_20_DR_24_MBPS, &frame, &n);
+	size = build_stream(frame, n, CFO, stream, &lcg);
+	size += build_stream(frame, n, -CFO, &stream[size], &lcg);
+	err = ofdm_decode_frame(&dec, stream, size, decoded, &length, &stats);
+	printf("first frame: result %d, start %d\n", err, stats.start);
+	j = stats.end;
+	err = ofdm_decode_frame(&dec, &stream[j], size - j, decoded, &length, &stats);
+	printf("second frame: result %d, start %d\n", err, j + stats.start);
+
+	//truncated frame
+	size = build_stream(frame, n, CFO, stream, &lcg);
+	err = ofdm_decode_frame(&dec, stream, N_NOISE + n - OFDM_SYMBOL_SIZE, decoded, &length, &stats);
+	printf("truncated frame: result %d\n", err);
+	fftw_free(frame);
+
+	//wrong frame check sequence
+	psdu[0] ^= 0x01;
+	generate_ofdm_frame(&enc, psdu, psdu_size, BW_20_DR_24_MBPS, &frame, &n);
+	size = build_stream(frame, n, CFO, stream, &lcg);
+	err = ofdm_decode_frame(&dec, stream, size, decoded, &length, &stats);
+	printf("corrupted frame: result %d, length %d\n", err, length);
+	fftw_free(frame);
+	free(psdu);
+
+	//noise alone
+	add_noise(stream, 10000, &lcg);
+	err = ofdm_decode_frame(&dec, stream, 10000, decoded, &length, &stats);
+	printf("noise: result %d\n", err);
+
+	free_ofdm_frame_encoder(&enc);
+	free_ofdm_frame_decoder(&dec);
+	fftw_free(stream);
+
+	return 0;
+
+}
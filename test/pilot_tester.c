@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <fftw3.h>
+
+#include "channel_utils.h"
+#include "soft_utils.h"
+#include "bit_utils.h"
+
+//the psdu of the example is repeated to get a frame much longer than N_PILOT_POLARITIES symbols
+#define N_REPETITIONS 15
+//residual carrier frequency offset (rad/sample)
+#define CFO 1e-4
+//increase of the phase slope at every symbol (rad/subcarrier), as caused by a sampling clock offset
+#define SLOPE_DRIFT 2e-4
+//first sample of the long training symbols
+#define LTS_START (SHORT_TRAINING_SIZE + 2 * CYCLIC_PREFIX_SIZE)
+//maximum error on the estimated phase slope (rad/subcarrier)
+#define MAX_SLOPE_ERROR 1e-3
+
+/**
+ * Demodulates, equalizes and demaps every DATA symbol of a frame, applying
+ * a phase slope growing by drift at every symbol, and returns the hard
+ * decisions. tracking is 0 for no tracking, 1 for common phase tracking, 2
+ * for common phase and slope tracking
+ */
+void decode_symbols(struct OFDM_DEMODULATOR *d, struct CHANNEL_ESTIMATE *ch, fftw_complex *samples, int n_sym,
+                    double drift, int tracking, char *bits) {
+	fftw_complex symbol[N_TOTAL_SUBCARRIERS], data[N_DATA_SUBCARRIERS];
+	signed char soft[N_DATA_SUBCARRIERS];
+	double slope, a, re, im;
+	int s, k, i;
+
+	memset(bits, 0, n_sym * N_DATA_SUBCARRIERS / 8);
+	for (s = 0; s < n_sym; s++) {
+		demodulate_symbol(d, &samples[(5 + s) * OFDM_SYMBOL_SIZE + CYCLIC_PREFIX_SIZE], symbol);
+		for (k = 0; k < N_TOTAL_SUBCARRIERS; k++) {
+			a = drift * (s + 1) * (k - DC_SUBCARRIER);
+			re = symbol[k][0] * cos(a) - symbol[k][1] * sin(a);
+			im = symbol[k][0] * sin(a) + symbol[k][1] * cos(a);
+			symbol[k][0] = re;
+			symbol[k][1] = im;
+		}
+		if (tracking == 0) {
+			equalize_symbol(ch, symbol, symbol);
+		}
+		else {
+			equalize_symbol_with_pilots(ch, symbol, s + 1, tracking == 2, symbol, NULL, &slope);
+			if (tracking == 2 && fabs(slope - drift * (s + 1)) > MAX_SLOPE_ERROR) {
+				printf("wrong slope estimate at symbol %d: %f instead of %f\n", s, slope, drift * (s + 1));
+			}
+		}
+		extract_data_subcarriers(symbol, data, NULL);
+		demap_soft(data, ch->data_gain, N_DATA_SUBCARRIERS, BPSK, DEMAP_DEFAULT_SCALE, soft);
+		for (i = 0; i < N_DATA_SUBCARRIERS; i++) {
+			set_bit(&bits[(s * N_DATA_SUBCARRIERS + i) / 8], 7 - (s * N_DATA_SUBCARRIERS + i) % 8, soft[i] > 0);
+		}
+	}
+}
+
+/**
+ * This test application takes in input the PSDU of the 802.11-2012 example
+ * (annex L), repeats it to build a long BPSK frame, and applies a residual
+ * frequency offset and a phase slope across subcarriers growing over the
+ * frame. It then decodes the DATA symbols with no phase tracking, with
+ * common phase tracking, and with common phase and slope tracking, and
+ * prints whether the hard decisions differ from the ones of the clean frame
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	char psdu[1000], *long_psdu;
+	struct OFDM_FRAME_ENCODER enc;
+	struct OFDM_DEMODULATOR d;
+	struct CHANNEL_ESTIMATE ch, clean_ch;
+	struct TX_PARAMETERS tx_params;
+	fftw_complex *samples, *clean;
+	char *reference, *bits;
+	const char *modes[] = {"no tracking", "phase tracking", "phase and slope tracking"};
+	int i, n, rb, length, mode;
+
+	rb = read_hex_from_file(argv[1], psdu, 1000);
+
+	if (rb == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (rb == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	length = rb * N_REPETITIONS;
+	long_psdu = (char *)malloc(length);
+	for (i = 0; i < N_REPETITIONS; i++) {
+		memcpy(&long_psdu[i * rb], psdu, rb);
+	}
+	tx_params = get_tx_parameters(BW_20_DR_6_MBPS, length);
+
+	init_ofdm_frame_encoder(&enc);
+	generate_ofdm_frame(&enc, long_psdu, length, BW_20_DR_6_MBPS, &clean, &n);
+	samples = fftw_alloc_complex(n);
+	for (i = 0; i < n; i++) {
+		samples[i][0] = clean[i][0] * cos(CFO * i) - clean[i][1] * sin(CFO * i);
+		samples[i][1] = clean[i][0] * sin(CFO * i) + clean[i][1] * cos(CFO * i);
+	}
+
+	reference = (char *)malloc(tx_params.n_sym * N_DATA_SUBCARRIERS / 8);
+	bits = (char *)malloc(tx_params.n_sym * N_DATA_SUBCARRIERS / 8);
+
+	init_ofdm_demodulator(&d);
+	estimate_channel(&d, &clean[LTS_START], 0, &clean_ch);
+	estimate_channel(&d, &samples[LTS_START], 0, &ch);
+
+	decode_symbols(&d, &clean_ch, clean, tx_params.n_sym, 0, 0, reference);
+	printf("symbols: %d\n", tx_params.n_sym);
+	for (mode = 0; mode < 3; mode++) {
+		decode_symbols(&d, &ch, samples, tx_params.n_sym, SLOPE_DRIFT, mode, bits);
+		printf("%s: %s\n", modes[mode],
+		       memcmp(bits, reference, tx_params.n_sym * N_DATA_SUBCARRIERS / 8) ? "errors" : "no errors");
+	}
+
+	free_ofdm_demodulator(&d);
+	free_ofdm_frame_encoder(&enc);
+	fftw_free(clean);
+	fftw_free(samples);
+	free(long_psdu);
+	free(reference);
+	free(bits);
+
+	return 0;
+
+}
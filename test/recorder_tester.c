@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <fftw3.h>
+
+#include "recorder_utils.h"
+#include "mac_utils.h"
+#include "bit_utils.h"
+#include "test_utils.h"
+
+//number of frames of the stream, and frame following the previous one after a gap shorter than the
+//pre-trigger samples
+#define N_FRAMES 16
+#define CLOSE_FRAME 6
+#define CLOSE_GAP 150
+//noise between the frames, so that the stream is much longer than the ring
+#define GAP_SIZE 30000
+#define STREAM_SIZE (N_FRAMES * (GAP_SIZE + 10000))
+#define MSDU_SIZE 300
+
+/**
+ * A frame of the stream, as transmitted
+ */
+struct SENT_FRAME {
+	long long start;
+	int n_samples;
+	char *psdu;
+	int psdu_size;
+};
+
+/**
+ * Records the stream in the given format, pushing it to the recorder in
+ * chunks of random sizes. Then checks the recording through its index:
+ * positions of the frames and of the pre-trigger samples, and frames
+ * decoded again from the recorded file
+ */
+void record(const fftw_complex *stream, long long size, const struct SENT_FRAME *sent, enum CAPTURE_FORMAT format,
+            int decode) {
+
+	struct TRIGGERED_RECORDER r;
+	struct FRAME_INDEX idx;
+	struct CAPTURE c;
+	struct OFDM_FRAME_DECODER dec;
+	const struct FRAME_INDEX_RECORD *rec;
+	fftw_complex *samples;
+	void *chunk;
+	char filename[64], indexfile[80], psdu[RX_MAX_PSDU_SIZE];
+	const char *name = STR_CAPTURE_FORMAT[format];
+	long long pos, prev_end = 0;
+	int n, n_frames = 0, n_correct = 0, length, err, i;
+	unsigned int lcg = 99;
+
+	sprintf(filename, "/tmp/recorder-tester-XXXXXX");
+	close(mkstemp(filename));
+	sprintf(indexfile, "%s" FRAME_INDEX_EXTENSION, filename);
+	if (init_triggered_recorder(&r, format, filename, indexfile) != 0) {
+		printf("%s: cannot create the recording\n", name);
+		return;
+	}
+	r.decode = decode;
+
+	chunk = malloc(sizeof(sample_cf32_t) * 10000);
+	for (pos = 0; pos < size; pos += n) {
+		n = 1 + next_random(&lcg) % 9999;
+		n = pos + n < size ? n : (int)(size - pos);
+		for (i = 0; i < n; i++) {
+			if (format == CAPTURE_SC16) {
+				((sample_sc16_t *)chunk)[i][0] = (short)lrint(stream[pos + i][0] / SC16_AMPLITUDE * 32767);
+				((sample_sc16_t *)chunk)[i][1] = (short)lrint(stream[pos + i][1] / SC16_AMPLITUDE * 32767);
+			}
+			else {
+				((sample_cf32_t *)chunk)[i][0] = stream[pos + i][0];
+				((sample_cf32_t *)chunk)[i][1] = stream[pos + i][1];
+			}
+		}
+		err = push_recorder_samples(&r, chunk, n);
+		if (err < 0) {
+			printf("%s: write error %d\n", name, err);
+			break;
+		}
+		n_frames += err;
+	}
+	free(chunk);
+	printf("%s: %lld samples, %d frames (%lld recorded), %lld detections dropped\n", name, r.n_samples, n_frames,
+	       r.n_frames, r.n_dropped);
+	printf("%s: %lld samples written, less than 20%% of the stream: %s\n", name, r.n_written,
+	       r.n_written * 5 < r.n_samples ? "yes" : "no");
+	free_triggered_recorder(&r);
+
+	if (open_frame_index(&idx, indexfile) != 0 || open_capture(&c, filename, format) != 0) {
+		printf("%s: cannot open the recording\n", name);
+		return;
+	}
+	printf("%s: %lld records, recording of %lld samples\n", name, idx.n_records, c.n_samples);
+	samples = fftw_alloc_complex(RX_MAX_FRAME_SIZE);
+	init_ofdm_frame_decoder(&dec);
+	for (pos = 0; pos < idx.n_records; pos++) {
+		rec = get_frame_index_record(&idx, pos);
+		//offset of the frame from the end of the previous one in the recording
+		printf("%s: frame %lld: %lld samples after the previous one, %d samples, %s, %d bytes, result %d\n", name,
+		       pos, rec->offset - prev_end, rec->n_samples, STR_DATA_RATE[rec->data_rate], rec->psdu_size,
+		       rec->status);
+		prev_end = rec->offset + rec->n_samples;
+		n = read_capture_samples(&c, rec->offset, rec->n_samples, samples);
+		err = ofdm_decode_frame(&dec, samples, n, psdu, &length, NULL);
+		if (pos < N_FRAMES && err == 0 && length == sent[pos].psdu_size &&
+		        memcmp(psdu, sent[pos].psdu, length) == 0) {
+			n_correct++;
+		}
+	}
+	printf("%s: frames decoded again from the recording: %d of %d\n", name, n_correct, N_FRAMES);
+	free_ofdm_frame_decoder(&dec);
+	fftw_free(samples);
+	close_capture(&c);
+	close_frame_index(&idx);
+	unlink(filename);
+	unlink(indexfile);
+
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), and builds a stream with copies of it and frames
+ * generated by the framer, separated by long noise gaps, except for two
+ * frames closer than the pre-trigger samples. The stream is recorded as cf32
+ * with frames decoded, and as sc16 with SIGNAL fields only, pushing it to
+ * the recorder in chunks of random sizes. The index of each recording is
+ * printed, and the frames are decoded again from the recorded files
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	struct OFDM_FRAME_ENCODER enc;
+	struct OFDM_FRAME_DECODER dec;
+	struct SENT_FRAME sent[N_FRAMES];
+	fftw_complex *frame, *example, *stream;
+	char msdu[MSDU_SIZE], *example_psdu;
+	long long pos;
+	int i, k, n_example, example_psdu_size;
+	//state of a linear congruential generator, for reproducible noise and data
+	unsigned int lcg = 1357;
+
+	example = fftw_alloc_complex(1000);
+	n_example = read_complex_from_file(argv[1], example, 1000);
+
+	if (n_example == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n_example == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	//the PSDU of the example frame, as decoded alone
+	init_ofdm_frame_decoder(&dec);
+	example_psdu = (char *)malloc(sizeof(char) * RX_MAX_PSDU_SIZE);
+	if (ofdm_decode_frame(&dec, example, n_example, example_psdu, &example_psdu_size, NULL) != 0) {
+		printf("cannot decode the example frame\n");
+		return 1;
+	}
+	free_ofdm_frame_decoder(&dec);
+
+	stream = fftw_alloc_complex(STREAM_SIZE);
+	generate_noise(stream, STREAM_SIZE, 0.01, &lcg);
+	init_ofdm_frame_encoder(&enc);
+	pos = 5000;
+	for (i = 0; i < N_FRAMES; i++) {
+		if (i % 5 == 4) {
+			frame = example;
+			sent[i].n_samples = n_example;
+			sent[i].psdu = example_psdu;
+			sent[i].psdu_size = example_psdu_size;
+		}
+		else {
+			for (k = 0; k < MSDU_SIZE; k++) {
+				msdu[k] = (char)next_random(&lcg);
+			}
+			generate_mac_data_frame(msdu, MSDU_SIZE, generate_default_mac_header(), &sent[i].psdu,
+			                        &sent[i].psdu_size);
+			generate_ofdm_frame(&enc, sent[i].psdu, sent[i].psdu_size, (enum DATA_RATE)(i % (N_DATA_RATES / 2)),
+			                    &frame, &sent[i].n_samples);
+		}
+		sent[i].start = pos;
+		add_frame(stream, pos, frame, sent[i].n_samples, 1);
+		if (frame != example) {
+			fftw_free(frame);
+		}
+		pos += sent[i].n_samples + (i + 1 == CLOSE_FRAME ? CLOSE_GAP : GAP_SIZE - next_random(&lcg) % 5000);
+	}
+
+	record(stream, pos, sent, CAPTURE_CF32, 1);
+	record(stream, pos, sent, CAPTURE_SC16, 0);
+
+	for (i = 0; i < N_FRAMES; i++) {
+		if (sent[i].psdu != example_psdu) {
+			free(sent[i].psdu);
+		}
+	}
+	free(example_psdu);
+	free_ofdm_frame_encoder(&enc);
+	fftw_free(example);
+	fftw_free(stream);
+
+	return 0;
+
+}
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fftw3.h>
+
+#include "receiver_utils.h"
+#include "channel_utils.h"
+#include "bit_utils.h"
+
+//first sample of the long training symbols, and of the SIGNAL symbol
+#define LTS_START (SHORT_TRAINING_SIZE + 2 * CYCLIC_PREFIX_SIZE)
+#define SIGNAL_START (4 * OFDM_SYMBOL_SIZE + CYCLIC_PREFIX_SIZE)
+//number of noise symbols given to the decoder
+#define N_NOISE_SYMBOLS 1000
+
+/**
+ * Demodulates and decodes a SIGNAL symbol, given its time samples after the
+ * cyclic prefix
+ */
+int decode_signal(struct OFDM_DEMODULATOR *d, struct CHANNEL_ESTIMATE *ch, const fftw_complex *samples,
+                  int bw_10_mhz, struct TX_PARAMETERS *tx_params) {
+	fftw_complex symbol[N_TOTAL_SUBCARRIERS], data[N_DATA_SUBCARRIERS];
+	demodulate_symbol(d, samples, symbol);
+	equalize_symbol_with_pilots(ch, symbol, 0, 0, symbol, NULL, NULL);
+	extract_data_subcarriers(symbol, data, NULL);
+	return decode_signal_field(data, ch->data_gain, bw_10_mhz, tx_params);
+}
+
+/**
+ * This test application takes in input the time samples of the 802.11-2012
+ * example frame (annex L), decodes its SIGNAL field and prints the
+ * transmission parameters. It then decodes the SIGNAL fields generated for
+ * every data rate and several lengths, reporting wrong results, and counts
+ * how many noise symbols are accepted as valid SIGNAL fields
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	fftw_complex *frame, signal[EXT_SIGNAL_SIZE], noise[FFT_SIZE];
+	struct OFDM_DEMODULATOR d;
+	struct CHANNEL_ESTIMATE ch;
+	struct TX_PARAMETERS tx_params, expected;
+	const int lengths[] = {1, 100, 1500, 4095};
+	int i, r, l, n, res, accepted = 0;
+	//state of a linear congruential generator, for reproducible noise
+	unsigned int lcg = 12345;
+
+	frame = fftw_alloc_complex(1000);
+	n = read_complex_from_file(argv[1], frame, 1000);
+
+	if (n == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (n == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	init_ofdm_demodulator(&d);
+	estimate_channel(&d, &frame[LTS_START], 0, &ch);
+
+	res = decode_signal(&d, &ch, &frame[SIGNAL_START], 0, &tx_params);
+	if (res != 0) {
+		printf("cannot decode the SIGNAL field: error %d\n", res);
+	}
+	else {
+		printf("data rate: %s\n", STR_DATA_RATE[tx_params.data_rate]);
+		printf("psdu size: %d\n", tx_params.psdu_size);
+		printf("symbols: %d\n", tx_params.n_sym);
+		printf("duration: %d\n", tx_params.duration);
+	}
+
+	//every data rate and channel spacing, on an ideal channel
+	for (r = 0; r < N_DATA_RATES; r++) {
+		for (l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+			generate_signal_field(signal, (enum DATA_RATE)r, lengths[l]);
+			res = decode_signal(&d, &ch, &signal[CYCLIC_PREFIX_SIZE], r >= BW_10_DR_3_MBPS, &tx_params);
+			expected = get_tx_parameters((enum DATA_RATE)r, lengths[l]);
+			if (res != 0 || tx_params.data_rate != expected.data_rate || tx_params.psdu_size != expected.psdu_size ||
+			    tx_params.n_sym != expected.n_sym) {
+				printf("wrong SIGNAL field for %s, %d bytes\n", STR_DATA_RATE[r], lengths[l]);
+			}
+		}
+	}
+
+	//noise only symbols, which should be rejected
+	for (i = 0; i < N_NOISE_SYMBOLS; i++) {
+		for (n = 0; n < FFT_SIZE; n++) {
+			lcg = lcg * 1103515245 + 12345;
+			noise[n][0] = ((int)(lcg >> 16) % 2001 - 1000) / 10000.0;
+			lcg = lcg * 1103515245 + 12345;
+			noise[n][1] = ((int)(lcg >> 16) % 2001 - 1000) / 10000.0;
+		}
+		if (decode_signal(&d, &ch, noise, 0, &tx_params) == 0) {
+			accepted++;
+		}
+	}
+	printf("noise symbols accepted: %d out of %d\n", accepted, N_NOISE_SYMBOLS);
+
+	free_ofdm_demodulator(&d);
+	fftw_free(frame);
+
+	return 0;
+
+}
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+
+unsigned int next_random(unsigned int *lcg) {
+	*lcg = *lcg * 1103515245 + 12345;
+	return *lcg >> 16;
+}
+
+double uniform_noise(unsigned int *lcg, double amplitude) {
+	return ((int)next_random(lcg) % 201 - 100) / 100.0 * amplitude;
+}
+
+void generate_noise(fftw_complex *stream, long long size, double amplitude, unsigned int *lcg) {
+	long long i;
+	for (i = 0; i < size; i++) {
+		stream[i][0] = uniform_noise(lcg, amplitude);
+		stream[i][1] = uniform_noise(lcg, amplitude);
+	}
+}
+
+void add_frame(fftw_complex *stream, long long pos, const fftw_complex *frame, int n_samples, double scale) {
+	int k;
+	for (k = 0; k < n_samples; k++) {
+		stream[pos + k][0] += frame[k][0] * scale;
+		stream[pos + k][1] += frame[k][1] * scale;
+	}
+}
+
+char *write_capture(const fftw_complex *stream, long long size, enum CAPTURE_FORMAT format) {
+	char *filename = (char *)malloc(sizeof(char) * 64);
+	FILE *f;
+	sample_cf32_t cf32;
+	sample_sc16_t sc16;
+	long long i;
+	int fd;
+	sprintf(filename, "/tmp/capture-tester-XXXXXX");
+	fd = mkstemp(filename);
+	f = fdopen(fd, "wb");
+	for (i = 0; i < size; i++) {
+		if (format == CAPTURE_SC16) {
+			sc16[0] = (short)lrint(stream[i][0] / SC16_AMPLITUDE * 32767);
+			sc16[1] = (short)lrint(stream[i][1] / SC16_AMPLITUDE * 32767);
+			fwrite(sc16, sizeof(sample_sc16_t), 1, f);
+		}
+		else {
+			cf32[0] = stream[i][0];
+			cf32[1] = stream[i][1];
+			fwrite(cf32, sizeof(sample_cf32_t), 1, f);
+		}
+	}
+	fclose(f);
+	return filename;
+}
@@ -0,0 +1,66 @@
+/*
+ * Helpers shared by the testers: a reproducible random generator, and the
+ * construction of sample streams made of noise and frames
+ */
+
+#ifndef _TEST_UTILS_H_
+#define _TEST_UTILS_H_
+
+#include <fftw3.h>
+
+#include "capture_utils.h"
+
+//sc16 captures are written with full scale at this amplitude
+#define SC16_AMPLITUDE 2.0
+
+/**
+ * Returns a pseudo random number, with a linear congruential generator
+ *
+ * \param lcg state of the generator, updated by the call
+ * \return a random number in [0, 65535]
+ */
+unsigned int next_random(unsigned int *lcg);
+
+/**
+ * Returns a sample of uniform noise in [-amplitude, amplitude], quantized to
+ * steps of amplitude / 100
+ *
+ * \param lcg state of the random generator
+ * \param amplitude amplitude of the noise
+ * \return the noise sample
+ */
+double uniform_noise(unsigned int *lcg, double amplitude);
+
+/**
+ * Fills a stream with uniform noise on both components
+ *
+ * \param stream the samples to fill
+ * \param size number of samples
+ * \param amplitude amplitude of the noise
+ * \param lcg state of the random generator
+ */
+void generate_noise(fftw_complex *stream, long long size, double amplitude, unsigned int *lcg);
+
+/**
+ * Adds a frame, scaled by the given factor, on top of a stream
+ *
+ * \param stream the stream receiving the frame
+ * \param pos position of the first sample of the frame in the stream
+ * \param frame samples of the frame
+ * \param n_samples number of samples of the frame
+ * \param scale amplitude factor applied to the frame
+ */
+void add_frame(fftw_complex *stream, long long pos, const fftw_complex *frame, int n_samples, double scale);
+
+/**
+ * Writes a stream to a temporary capture file in the given format. sc16
+ * samples are scaled so that SC16_AMPLITUDE is full scale
+ *
+ * \param stream the samples to write
+ * \param size number of samples
+ * \param format sample format of the file
+ * \return the name of the file, to be freed by the caller
+ */
+char *write_capture(const fftw_complex *stream, long long size, enum CAPTURE_FORMAT format);
+
+#endif
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fftw3.h>
+
+#include "viterbi_utils.h"
+#include "bit_utils.h"
+
+//number of bytes of the scrambled psdu in the 802.11-2012 example
+#define N_DECODED 108
+//every N_WEAK-th soft bit is made wrong, with a low confidence
+#define N_WEAK 50
+//number of frames given to the batched decoder, more than VITERBI_LANES
+#define N_BATCH 20
+
+/**
+ * This test application takes in input the encoded and punctured (rate 3/4)
+ * sample psdu of the 802.11-2012 standard (annex J), turns it into soft bits
+ * with some weak wrong values, and decodes it with every Viterbi backend
+ * supported by the cpu, feeding the scalar one in chunks of odd size. The
+ * batched decoder is then run on copies of the frame with the weak values at
+ * different positions. It prints the decoded bits, which are the scrambled
+ * psdu, and reports any mismatch between the backends and between the frames
+ * of the batch
+ */
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		printf("error: missing input file\n");
+		return 1;
+	}
+
+	char encoded[1000];
+	signed char *soft;
+	char out[N_DECODED], reference[N_DECODED];
+	struct VITERBI_DECODER v;
+	signed char *batch_soft[N_BATCH];
+	char *batch_out[N_BATCH];
+	int i, n_bits, b, f;
+
+	int rb = read_bits_from_file(argv[1], encoded, 1000);
+
+	if (rb == ERR_CANNOT_READ_FILE) {
+		printf("Cannot read file \"%s\": file not found?\n", argv[1]);
+		return 1;
+	}
+	if (rb == ERR_INVALID_FORMAT) {
+		printf("Invalid file format\n");
+		return 1;
+	}
+
+	n_bits = rb * 8;
+	soft = (signed char *)malloc(n_bits);
+	for (i = 0; i < n_bits; i++) {
+		soft[i] = get_ith_bit(encoded, i) ? 100 : -100;
+		if (i % N_WEAK == N_WEAK - 1) {
+			soft[i] = soft[i] > 0 ? -30 : 30;
+		}
+	}
+
+	//scalar decoder, in chunks
+	set_viterbi_backend(VITERBI_SCALAR);
+	init_viterbi_decoder(&v, RATE_3_4);
+	for (i = 0; i < n_bits; i += 37) {
+		viterbi_decoder_push(&v, &soft[i], n_bits - i < 37 ? n_bits - i : 37, reference);
+	}
+	viterbi_decoder_finish(&v, 0, reference);
+
+	for (b = VITERBI_SSE2; b <= VITERBI_AVX2; b++) {
+		if (set_viterbi_backend(b) != 0) {
+			continue;
+		}
+		memset(out, 0, N_DECODED);
+		viterbi_decode(soft, n_bits, RATE_3_4, 0, out);
+		if (memcmp(out, reference, N_DECODED) != 0) {
+			printf("backend %s differs from scalar\n", STR_VITERBI_BACKEND[b]);
+		}
+	}
+
+	for (f = 0; f < N_BATCH; f++) {
+		batch_soft[f] = (signed char *)malloc(n_bits);
+		batch_out[f] = (char *)malloc(N_DECODED);
+		for (i = 0; i < n_bits; i++) {
+			batch_soft[f][i] = get_ith_bit(encoded, i) ? 100 : -100;
+			if (i % N_WEAK == N_WEAK - 1 - f) {
+				batch_soft[f][i] = batch_soft[f][i] > 0 ? -30 : 30;
+			}
+		}
+	}
+	for (b = VITERBI_SCALAR; b <= VITERBI_AVX2; b++) {
+		if (set_viterbi_backend(b) != 0) {
+			continue;
+		}
+		viterbi_decode_batch((const signed char **)batch_soft, N_BATCH, n_bits, RATE_3_4, 0, batch_out);
+		for (f = 0; f < N_BATCH; f++) {
+			if (memcmp(batch_out[f], reference, N_DECODED) != 0) {
+				printf("backend %s: batched frame %d differs\n", STR_VITERBI_BACKEND[b], f);
+			}
+		}
+	}
+
+	print_bits_array(reference, N_DECODED, '\n');
+
+	free(soft);
+	for (f = 0; f < N_BATCH; f++) {
+		free(batch_soft[f]);
+		free(batch_out[f]);
+	}
+
+	return 0;
+
+}